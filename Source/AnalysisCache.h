@@ -0,0 +1,167 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include "CodecRegistry.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+
+// Process-wide per-file analysis: files are analysed in parallel on the shared job scheduler
+// and the results are kept in a small properties file, so each file is analysed once.
+// Result needs a toString() and a static fromString(text, result) for the store.
+template <typename Result>
+class AnalysisCache
+{
+public:
+    using Callback = std::function<void(const Result&)>;
+
+    // Runs on a scheduler worker; false if the file has no result or the job was asked to stop.
+    using Analyser = std::function<bool(juce::AudioFormatReader&, Result&, const JobScheduler::Context&)>;
+
+    // storeSuffix names the properties file, jobName prefixes the scheduler's job names
+    AnalysisCache(const juce::String& storeSuffix, const juce::String& jobName, Analyser analyserToUse)
+        : jobPrefix(jobName + " "), analyser(std::move(analyserToUse))
+    {
+        juce::PropertiesFile::Options options;
+        options.applicationName = "SimpleAudioPlayer";
+        options.filenameSuffix = storeSuffix;
+        options.folderName = "SimpleAudioPlayer";
+        options.osxLibrarySubFolder = "Application Support";
+        options.storageFormat = juce::PropertiesFile::storeAsXML;
+        options.millisecondsBeforeSaving = 2000;
+
+        store = std::make_unique<juce::PropertiesFile>(options);
+        jobs = JobScheduler::getInstance()->createGroup();
+    }
+
+    virtual ~AnalysisCache()
+    {
+        if (auto* scheduler = JobScheduler::getInstanceWithoutCreating())
+            scheduler->cancelGroup(jobs, true);
+
+        store->saveIfNeeded();
+    }
+
+    bool find(const juce::File& file, Result& result)
+    {
+        auto text = store->getValue(fileCacheKey(file));
+        return text.isNotEmpty() && Result::fromString(text, result);
+    }
+
+    // Queues the file for analysis. The callback, if any, runs on the message thread once
+    // the result is known (at once if it's cached, not at all if the file has no result).
+    // Requesting a queued file again with a more urgent priority moves it ahead.
+    void request(const juce::File& file, const void* owner, Callback onReady = nullptr,
+                 JobScheduler::Priority priority = JobScheduler::Priority::library)
+    {
+        Result cached;
+        if (find(file, cached))
+        {
+            if (onReady != nullptr)
+                onReady(cached);
+            return;
+        }
+
+        const juce::ScopedLock sl(lock);
+
+        auto key = fileCacheKey(file);
+        bool alreadyQueued = pending.find(key) != pending.end();
+        auto& waiting = pending[key];
+
+        if (onReady != nullptr)
+            waiting.requests.push_back({ owner, std::move(onReady) });
+
+        if (alreadyQueued && priority >= waiting.priority)
+            return;
+
+        // Queued jobs can't be moved between priorities, so a more urgent request queues a
+        // second copy; both share a flag and whichever starts first does the analysis.
+        if (!alreadyQueued)
+            waiting.claimed = std::make_shared<std::atomic<bool>>(false);
+
+        waiting.priority = priority;
+
+        juce::WeakReference<AnalysisCache> weakThis(this);
+        auto claimed = waiting.claimed;
+        auto analyse = analyser;
+
+        JobScheduler::getInstance()->schedule(jobPrefix + file.getFileName(), priority, jobs,
+            [weakThis, file, claimed, analyse](const JobScheduler::Context& context)
+            {
+                if (claimed->exchange(true))
+                    return;
+
+                Result result;
+                bool ok = false;
+
+                if (auto reader = CodecRegistry::getInstance()->createReaderFor(file))
+                    ok = analyse(*reader, result, context);
+
+                juce::MessageManager::callAsync([weakThis, file, ok, result]
+                {
+                    if (auto* c = weakThis.get())
+                        c->analysisFinished(file, ok, result);
+                });
+            });
+    }
+
+    void cancelRequests(const void* owner)
+    {
+        const juce::ScopedLock sl(lock);
+
+        for (auto& p : pending)
+            p.second.requests.erase(std::remove_if(p.second.requests.begin(), p.second.requests.end(),
+                                                   [owner](const Request& r) { return r.owner == owner; }),
+                                    p.second.requests.end());
+    }
+
+private:
+    struct Request
+    {
+        const void* owner;
+        Callback callback;
+    };
+
+    struct PendingAnalysis
+    {
+        std::vector<Request> requests;
+        JobScheduler::Priority priority = JobScheduler::Priority::library;
+        std::shared_ptr<std::atomic<bool>> claimed;
+    };
+
+    void analysisFinished(const juce::File& file, bool ok, const Result& result)
+    {
+        std::vector<Request> requests;
+
+        {
+            const juce::ScopedLock sl(lock);
+            auto key = fileCacheKey(file);
+
+            if (ok)
+                store->setValue(key, result.toString());
+
+            auto it = pending.find(key);
+            if (it != pending.end())
+            {
+                requests = std::move(it->second.requests);
+                pending.erase(it);
+            }
+        }
+
+        if (ok)
+            for (auto& r : requests)
+                r.callback(result);
+    }
+
+    const juce::String jobPrefix;
+    const Analyser analyser;
+
+    std::unique_ptr<juce::PropertiesFile> store;
+    juce::CriticalSection lock;
+    std::map<juce::String, PendingAnalysis> pending;
+    JobScheduler::GroupId jobs = JobScheduler::noGroup;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(AnalysisCache)
+    JUCE_DECLARE_NON_COPYABLE(AnalysisCache)
+};
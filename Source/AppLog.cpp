@@ -0,0 +1,280 @@
+#include "AppLog.h"
+
+JUCE_IMPLEMENT_SINGLETON(AppLog)
+
+#if JUCE_DEBUG
+ #define APP_LOG_DEFAULT_LEVEL ((int) AppLog::Level::debug)
+#else
+ #define APP_LOG_DEFAULT_LEVEL ((int) AppLog::Level::info)
+#endif
+
+std::array<std::atomic<int>, (size_t) AppLog::Subsystem::numSubsystems> AppLog::minimumLevels{ {
+    APP_LOG_DEFAULT_LEVEL, APP_LOG_DEFAULT_LEVEL, APP_LOG_DEFAULT_LEVEL, APP_LOG_DEFAULT_LEVEL,
+    APP_LOG_DEFAULT_LEVEL, APP_LOG_DEFAULT_LEVEL, APP_LOG_DEFAULT_LEVEL, APP_LOG_DEFAULT_LEVEL } };
+
+AppLog::AppLog()
+    : juce::Thread("Log writer")
+{
+    for (size_t i = 0; i < capacity; ++i)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+
+    logFile = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("SimpleAudioPlayer")
+        .getChildFile("Logs")
+        .getChildFile("SimpleAudioPlayer.log");
+
+    applyEnvironmentFilters();
+    startThread(juce::Thread::Priority::low);
+}
+
+AppLog::~AppLog()
+{
+    // run() writes out whatever is still queued
+    clearSingletonInstance();
+    stopThread(4000);
+}
+
+void AppLog::Record::addText(const char* s)
+{
+    auto& arg = args[(size_t) numArgs++];
+    arg.type = Arg::Type::text;
+
+    // out of room: the argument points at the terminator and prints as nothing
+    const int room = textCapacity - 1 - textUsed;
+    if (room <= 0 || s == nullptr)
+    {
+        arg.integer = textCapacity - 1;
+        return;
+    }
+
+    int length = 0;
+    while (length < room && s[length] != 0)
+        ++length;
+
+    arg.integer = textUsed;
+    std::memcpy(text + textUsed, s, (size_t) length);
+    text[textUsed + length] = 0;
+    textUsed += length + 1;
+}
+
+// Any thread. The slot is claimed with a compare-and-swap on the tail, filled, then
+// published through its sequence number, so the writer never sees a half-copied record.
+void AppLog::push(Record& record)
+{
+    auto* log = getInstanceWithoutCreating();
+    if (log == nullptr)
+        return;
+
+    record.timeMs = juce::Time::getMillisecondCounterHiRes();
+
+    auto position = log->tail.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        auto& slot = log->slots[position & (capacity - 1)];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto difference = (std::ptrdiff_t) sequence - (std::ptrdiff_t) position;
+
+        if (difference == 0)
+        {
+            if (log->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.record = record;
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return;
+            }
+        }
+        else if (difference < 0)
+        {
+            // full: the writer is behind
+            ++log->dropped;
+            return;
+        }
+        else
+        {
+            position = log->tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// log writer thread only
+bool AppLog::pop(Record& record)
+{
+    const auto position = head.load(std::memory_order_relaxed);
+    auto& slot = slots[position & (capacity - 1)];
+
+    if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+        return false;
+
+    record = slot.record;
+    slot.sequence.store(position + capacity, std::memory_order_release);
+    head.store(position + 1, std::memory_order_relaxed);
+    return true;
+}
+
+void AppLog::run()
+{
+    openFile();
+
+    auto drain = [this]
+    {
+        Record record;
+        while (pop(record))
+            writeRecord(record);
+
+        if (const auto lost = dropped.exchange(0))
+        {
+            Record note;
+            note.level = Level::warning;
+            note.format = "{} log records dropped: the queue was full";
+            note.timeMs = juce::Time::getMillisecondCounterHiRes();
+            note.add(lost);
+            writeRecord(note);
+        }
+
+        if (out != nullptr)
+            out->flush();
+    };
+
+    // producers never wake this thread (signalling isn't realtime-safe), so poll
+    while (!threadShouldExit())
+    {
+        wait(50);
+        drain();
+    }
+
+    drain();
+}
+
+void AppLog::writeRecord(const Record& record)
+{
+    const auto line = format(record);
+
+   #if JUCE_DEBUG
+    juce::Logger::outputDebugString(line);
+   #endif
+
+    if (out == nullptr)
+        return;
+
+    *out << line << juce::newLine;
+
+    if (out->getPosition() > maxFileBytes)
+        rotate();
+}
+
+juce::String AppLog::format(const Record& record) const
+{
+    // the hi-res counter starts at boot; shift it onto the wall clock
+    static const double counterToWallMs = (double) juce::Time::currentTimeMillis() - juce::Time::getMillisecondCounterHiRes();
+    const juce::Time time((juce::int64) (record.timeMs + counterToWallMs));
+
+    juce::String message;
+    int nextArg = 0;
+    auto* runStart = record.format;
+
+    for (auto* p = record.format; *p != 0; ++p)
+    {
+        if (p[0] != '{' || p[1] != '}' || nextArg >= record.numArgs)
+            continue;
+
+        message << juce::String::fromUTF8(runStart, (int) (p - runStart));
+
+        auto& arg = record.args[(size_t) nextArg++];
+        switch (arg.type)
+        {
+            case Arg::Type::integer: message << arg.integer; break;
+            case Arg::Type::real:    message << juce::String(arg.real, 3); break;
+            case Arg::Type::text:    message << juce::String::fromUTF8(record.text + arg.integer); break;
+        }
+
+        runStart = ++p + 1;
+    }
+
+    message << juce::String::fromUTF8(runStart);
+
+    return time.formatted("%Y-%m-%d %H:%M:%S") + "." + juce::String(time.getMilliseconds()).paddedLeft('0', 3)
+         + " " + getLevelName(record.level).paddedRight(' ', 5)
+         + " [" + getSubsystemName(record.subsystem) + "] " + message;
+}
+
+void AppLog::openFile()
+{
+    logFile.getParentDirectory().createDirectory();
+
+    // FileOutputStream appends to an existing file
+    out = std::make_unique<juce::FileOutputStream>(logFile);
+    if (!out->openedOk())
+        out = nullptr;
+}
+
+// SimpleAudioPlayer.log -> .1.log -> .2.log ..., oldest dropped
+void AppLog::rotate()
+{
+    out = nullptr;
+
+    auto numbered = [this](int n) { return logFile.getSiblingFile(logFile.getFileNameWithoutExtension() + "." + juce::String(n) + ".log"); };
+
+    numbered(numOldFiles).deleteFile();
+    for (int n = numOldFiles - 1; n >= 1; --n)
+        numbered(n).moveFileTo(numbered(n + 1));
+
+    logFile.moveFileTo(numbered(1));
+    openFile();
+}
+
+void AppLog::applyEnvironmentFilters()
+{
+    const auto spec = juce::SystemStats::getEnvironmentVariable("SIMPLEAUDIOPLAYER_LOG", {});
+
+    for (auto& token : juce::StringArray::fromTokens(spec, ",; ", {}))
+    {
+        const auto name = token.upToFirstOccurrenceOf("=", false, false).trim().toLowerCase();
+        const auto levelName = token.fromFirstOccurrenceOf("=", false, false).trim().toUpperCase();
+
+        int level = -1;
+        for (int l = (int) Level::trace; l <= (int) Level::off; ++l)
+            if (getLevelName((Level) l) == levelName || (levelName == "WARNING" && (Level) l == Level::warning))
+                level = l;
+
+        if (level < 0)
+            continue;
+
+        for (int s = 0; s < (int) Subsystem::numSubsystems; ++s)
+            if (name == "all" || name == getSubsystemName((Subsystem) s))
+                setLevel((Subsystem) s, (Level) level);
+    }
+}
+
+juce::String AppLog::getSubsystemName(Subsystem subsystem)
+{
+    switch (subsystem)
+    {
+        case Subsystem::general:       return "general";
+        case Subsystem::audio:         return "audio";
+        case Subsystem::deck:          return "deck";
+        case Subsystem::midi:          return "midi";
+        case Subsystem::plugins:       return "plugins";
+        case Subsystem::session:       return "session";
+        case Subsystem::device:        return "device";
+        case Subsystem::control:       return "control";
+        case Subsystem::numSubsystems: break;
+    }
+
+    return {};
+}
+
+juce::String AppLog::getLevelName(Level level)
+{
+    switch (level)
+    {
+        case Level::trace:   return "TRACE";
+        case Level::debug:   return "DEBUG";
+        case Level::info:    return "INFO";
+        case Level::warning: return "WARN";
+        case Level::error:   return "ERROR";
+        case Level::off:     return "OFF";
+    }
+
+    return {};
+}
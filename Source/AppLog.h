@@ -0,0 +1,127 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// Structured log that any thread may write to, the audio thread included. A record is a
+// fixed-size struct (format literal, up to six numbers or short strings, time, level,
+// subsystem) pushed into a bounded lock-free queue; a background thread formats records
+// and appends them to a rotating file in SimpleAudioPlayer/Logs, and to the debugger
+// output in debug builds. When the queue is full, records are dropped and counted.
+//
+// Use APP_LOG(subsystem, level, "format with {} placeholders", args...): the level check
+// comes first, so a filtered-out call costs one relaxed atomic load and its arguments are
+// never evaluated. Levels per subsystem come from SIMPLEAUDIOPLAYER_LOG, e.g.
+// "audio=debug,midi=trace" or "all=warning".
+class AppLog : public juce::DeletedAtShutdown,
+               private juce::Thread
+{
+public:
+    enum class Level { trace, debug, info, warning, error, off };
+    enum class Subsystem { general, audio, deck, midi, plugins, session, device, control, numSubsystems };
+
+    static constexpr int maxArgs = 6;
+    static constexpr int textCapacity = 96; // bytes shared by a record's string arguments
+
+    AppLog();
+    ~AppLog() override;
+
+    static bool isEnabled(Subsystem subsystem, Level level)
+    {
+        return (int) level >= minimumLevels[(size_t) subsystem].load(std::memory_order_relaxed);
+    }
+
+    static void setLevel(Subsystem subsystem, Level level) { minimumLevels[(size_t) subsystem] = (int) level; }
+
+    // Any thread, never blocks or allocates. format must be a string literal (only the
+    // pointer is kept); longer string arguments are cut short.
+    template <typename... Args>
+    static void write(Subsystem subsystem, Level level, const char* format, const Args&... args)
+    {
+        static_assert(sizeof...(Args) <= maxArgs, "too many log arguments");
+
+        Record record;
+        record.subsystem = subsystem;
+        record.level = level;
+        record.format = format;
+        (record.add(args), ...);
+        push(record);
+    }
+
+    static juce::String getSubsystemName(Subsystem subsystem);
+    static juce::String getLevelName(Level level);
+
+    JUCE_DECLARE_SINGLETON(AppLog, false)
+
+private:
+    struct Arg
+    {
+        enum class Type { integer, real, text };
+
+        Type type = Type::integer;
+        juce::int64 integer = 0;
+        double real = 0.0;
+    };
+
+    struct Record
+    {
+        double timeMs = 0.0;
+        Subsystem subsystem = Subsystem::general;
+        Level level = Level::info;
+        const char* format = "";
+        std::array<Arg, maxArgs> args;
+        int numArgs = 0;
+        char text[textCapacity] = {};
+        int textUsed = 0;
+
+        void add(const juce::String& s) { addText(s.toRawUTF8()); }
+        void add(const char* s) { addText(s); }
+        void add(bool b) { addInteger(b ? 1 : 0); }
+        void add(double d) { args[(size_t) numArgs].type = Arg::Type::real; args[(size_t) numArgs++].real = d; }
+        void add(float f) { add((double) f); }
+
+        template <typename Int, std::enable_if_t<std::is_integral_v<Int>, int> = 0>
+        void add(Int i) { addInteger((juce::int64) i); }
+
+        void addInteger(juce::int64 i) { args[(size_t) numArgs].type = Arg::Type::integer; args[(size_t) numArgs++].integer = i; }
+        void addText(const char* s);
+    };
+
+    // bounded multi-producer queue: each slot's sequence number says whose turn it is
+    struct Slot
+    {
+        std::atomic<size_t> sequence{ 0 };
+        Record record;
+    };
+
+    static constexpr size_t capacity = 1024; // records; a power of two
+    static constexpr juce::int64 maxFileBytes = 2 * 1024 * 1024;
+    static constexpr int numOldFiles = 3;
+
+    static void push(Record& record);
+    bool pop(Record& record);
+
+    void run() override;
+    void writeRecord(const Record& record);
+    juce::String format(const Record& record) const;
+    void openFile();
+    void rotate();
+    static void applyEnvironmentFilters();
+
+    static std::array<std::atomic<int>, (size_t) Subsystem::numSubsystems> minimumLevels;
+
+    std::array<Slot, capacity> slots;
+    std::atomic<size_t> head{ 0 }, tail{ 0 };
+    std::atomic<juce::uint32> dropped{ 0 };
+
+    juce::File logFile;
+    std::unique_ptr<juce::FileOutputStream> out;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AppLog)
+};
+
+#define APP_LOG(subsystem, level, ...) \
+    do { \
+        if (AppLog::isEnabled(AppLog::Subsystem::subsystem, AppLog::Level::level)) \
+            AppLog::write(AppLog::Subsystem::subsystem, AppLog::Level::level, __VA_ARGS__); \
+    } while (false)
@@ -0,0 +1,25 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+
+// Sample counter of the mixer's output stream: the shared timeline decks schedule against.
+// Only the audio thread advances it; anyone may read it.
+class AudioClock
+{
+public:
+    // output sample at which the next block starts
+    juce::int64 getSampleTime() const { return sampleTime.load(std::memory_order_acquire); }
+    double getSampleRate() const { return sampleRate.load(std::memory_order_relaxed); }
+
+    juce::int64 getSampleTimeAfter(double seconds) const
+    {
+        return getSampleTime() + (juce::int64) std::llround(seconds * getSampleRate());
+    }
+
+    void setSampleRate(double newRate) { sampleRate.store(newRate, std::memory_order_relaxed); }
+    void advance(int numSamples) { sampleTime.fetch_add(numSamples, std::memory_order_release); }
+
+private:
+    std::atomic<juce::int64> sampleTime{ 0 };
+    std::atomic<double> sampleRate{ 44100.0 };
+};
@@ -0,0 +1,202 @@
+#include "AudioDiagnostics.h"
+#include "AppLog.h"
+
+void CallbackMonitor::blockStarted()
+{
+    startMs = juce::Time::getMillisecondCounterHiRes();
+}
+
+void CallbackMonitor::blockFinished(int numSamples, double sampleRate)
+{
+    const double expectedMs = 1000.0 * numSamples / sampleRate;
+    const double loadNow = (juce::Time::getMillisecondCounterHiRes() - startMs) / expectedMs;
+
+    if (resetRequested.exchange(false))
+    {
+        callbacks = 0;
+        lateCallbacks = 0;
+        sumDeviation = 0.0;
+        sumDeviationSquared = 0.0;
+        worstIntervalMs = 0.0;
+        peakLoad = 0.0;
+        lastStartMs = 0.0;
+    }
+
+    blockMs = expectedMs;
+    peakLoad = juce::jmax(peakLoad.load(), loadNow);
+
+    // the first callback after a reset has nothing to be compared with
+    if (lastStartMs > 0.0)
+    {
+        const double interval = startMs - lastStartMs;
+        const double deviation = interval - expectedMs;
+
+        sumDeviation = sumDeviation.load() + deviation;
+        sumDeviationSquared = sumDeviationSquared.load() + deviation * deviation;
+        worstIntervalMs = juce::jmax(worstIntervalMs.load(), interval);
+
+        if (interval > 1.5 * expectedMs)
+        {
+            ++lateCallbacks;
+            APP_LOG(audio, warning, "Audio callback {} ms after the previous one; the block is {} ms", interval, expectedMs);
+        }
+
+        ++callbacks;
+    }
+
+    lastStartMs = startMs;
+}
+
+CallbackMonitor::Report CallbackMonitor::getReport() const
+{
+    Report report;
+    report.callbacks = callbacks.load();
+    report.blockMs = blockMs.load();
+    report.worstIntervalMs = worstIntervalMs.load();
+    report.peakLoad = peakLoad.load();
+    report.lateCallbacks = lateCallbacks.load();
+
+    if (report.callbacks > 0)
+    {
+        const double mean = sumDeviation.load() / report.callbacks;
+        report.jitterMs = std::sqrt(juce::jmax(0.0, sumDeviationSquared.load() / report.callbacks - mean * mean));
+    }
+
+    return report;
+}
+
+//==============================================================================
+LatencyTester::LatencyTester()
+{
+    jobs = JobScheduler::getInstance()->createGroup();
+}
+
+LatencyTester::~LatencyTester()
+{
+    if (auto* scheduler = JobScheduler::getInstanceWithoutCreating())
+        scheduler->cancelGroup(jobs, true);
+
+    cancelPendingUpdate();
+}
+
+void LatencyTester::start(double sampleRate, int reportedLatencySamples, Callback onDone)
+{
+    if (isRunning())
+        return;
+
+    // white noise correlates sharply with itself and with nothing else
+    juce::Random random;
+    burst.setSize(1, burstLength);
+    for (int i = 0; i < burstLength; ++i)
+        burst.setSample(0, i, 0.25f * (2.0f * random.nextFloat() - 1.0f));
+
+    // a second is more round trip than any usable setup has
+    recorded.setSize(1, (int) sampleRate + burstLength);
+    recorded.clear();
+    recordedSamples = 0;
+
+    pending = {};
+    pending.sampleRate = sampleRate;
+    pending.reportedSamples = reportedLatencySamples;
+    callback = std::move(onDone);
+
+    state = recording;
+}
+
+void LatencyTester::cancel()
+{
+    int expected = recording;
+    state.compare_exchange_strong(expected, idle);
+}
+
+bool LatencyTester::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (state.load() != recording)
+        return false;
+
+    const int n = juce::jmin(numSamples, recorded.getNumSamples() - recordedSamples);
+    recorded.copyFrom(0, recordedSamples, buffer, 0, startSample, n);
+
+    buffer.clear(startSample, numSamples);
+
+    // the burst goes out at the very start of the recording
+    const int burstSamples = juce::jmin(numSamples, burstLength - recordedSamples);
+    for (int ch = 0; ch < buffer.getNumChannels() && burstSamples > 0; ++ch)
+        buffer.copyFrom(ch, startSample, burst, 0, recordedSamples, burstSamples);
+
+    recordedSamples += n;
+
+    if (recordedSamples >= recorded.getNumSamples())
+    {
+        state = analysing;
+        triggerAsyncUpdate();
+    }
+
+    return true;
+}
+
+void LatencyTester::handleAsyncUpdate()
+{
+    juce::WeakReference<LatencyTester> weakThis(this);
+
+    JobScheduler::getInstance()->schedule("Latency analysis", JobScheduler::Priority::loadedTrack, jobs,
+        [weakThis, burstCopy = burst, recordedCopy = recorded, pendingCopy = pending](const JobScheduler::Context& context)
+        {
+            auto result = analyse(burstCopy, recordedCopy);
+            result.sampleRate = pendingCopy.sampleRate;
+            result.reportedSamples = pendingCopy.reportedSamples;
+
+            if (context.shouldStop())
+                return;
+
+            juce::MessageManager::callAsync([weakThis, result]
+            {
+                if (auto* tester = weakThis.get())
+                {
+                    tester->state = idle;
+                    APP_LOG(device, info, "Latency test: found {}, round trip {} samples, driver reports {}",
+                            result.found, result.roundTripSamples, result.reportedSamples);
+
+                    if (tester->callback != nullptr)
+                        tester->callback(result);
+                }
+            });
+        });
+}
+
+LatencyTester::Result LatencyTester::analyse(const juce::AudioBuffer<float>& burst, const juce::AudioBuffer<float>& recorded)
+{
+    const auto* b = burst.getReadPointer(0);
+    const auto* r = recorded.getReadPointer(0);
+    const int length = burst.getNumSamples();
+    const int numLags = recorded.getNumSamples() - length;
+
+    double burstEnergy = 0.0;
+    for (int i = 0; i < length; ++i)
+        burstEnergy += b[i] * b[i];
+
+    Result result;
+    double best = 0.0;
+
+    for (int lag = 0; lag < numLags; ++lag)
+    {
+        double sum = 0.0, energy = 0.0;
+        for (int i = 0; i < length; ++i)
+        {
+            sum += b[i] * r[lag + i];
+            energy += r[lag + i] * r[lag + i];
+        }
+
+        // normalised, so a loud noise floor can't win over a quiet but exact match
+        const double score = energy > 0.0 ? sum / std::sqrt(burstEnergy * energy) : 0.0;
+        if (score > best)
+        {
+            best = score;
+            result.roundTripSamples = lag;
+        }
+    }
+
+    // anything below this is the noise floor: nothing came back
+    result.found = best > 0.5;
+    return result;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include <atomic>
+
+// Timing of the audio callback: how regularly the device calls it and how much of each
+// block's time the mix takes. The audio thread records, anyone may read the report.
+class CallbackMonitor
+{
+public:
+    struct Report
+    {
+        int callbacks = 0;
+        double blockMs = 0.0;          // expected time between callbacks, last block size
+        double jitterMs = 0.0;         // standard deviation of the interval
+        double worstIntervalMs = 0.0;
+        double peakLoad = 0.0;         // callback duration / block duration
+        int lateCallbacks = 0;         // intervals over 1.5 blocks: likely dropouts
+    };
+
+    // audio thread, around the whole callback
+    void blockStarted();
+    void blockFinished(int numSamples, double sampleRate);
+
+    Report getReport() const;
+
+    // any thread; the audio thread clears the statistics at its next callback
+    void reset() { resetRequested = true; }
+
+private:
+    double startMs = 0.0, lastStartMs = 0.0; // audio thread only
+
+    std::atomic<bool> resetRequested{ true };
+    std::atomic<int> callbacks{ 0 }, lateCallbacks{ 0 };
+    std::atomic<double> blockMs{ 0.0 };
+    std::atomic<double> sumDeviation{ 0.0 }, sumDeviationSquared{ 0.0 };
+    std::atomic<double> worstIntervalMs{ 0.0 }, peakLoad{ 0.0 };
+};
+
+// Round-trip latency through a physical loopback (an output cabled to an input). While it
+// runs, the output is a noise burst instead of the mix and the first input is recorded;
+// the delay is where the recording correlates best with the burst, found by a
+// background job.
+class LatencyTester : private juce::AsyncUpdater
+{
+public:
+    struct Result
+    {
+        bool found = false;
+        int roundTripSamples = 0;
+        double sampleRate = 0.0;
+        int reportedSamples = 0; // what the driver claims (input + output latency)
+    };
+
+    using Callback = std::function<void(const Result&)>;
+
+    LatencyTester();
+    ~LatencyTester() override;
+
+    // message thread; onDone is called on the message thread
+    void start(double sampleRate, int reportedLatencySamples, Callback onDone);
+    bool isRunning() const { return state.load() != idle; }
+
+    // when the device stops mid-measurement; the audio thread must not be running
+    void cancel();
+
+    // Audio thread: records input channel 0 of the buffer (which holds the device input
+    // on entry) and replaces every channel with the test signal. False when not running,
+    // leaving the buffer alone.
+    bool process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+private:
+    enum State { idle, recording, analysing };
+
+    static constexpr int burstLength = 1024;
+
+    void handleAsyncUpdate() override;
+    static Result analyse(const juce::AudioBuffer<float>& burst, const juce::AudioBuffer<float>& recorded);
+
+    std::atomic<int> state{ idle };
+    juce::AudioBuffer<float> burst, recorded;
+    int recordedSamples = 0; // audio thread while recording
+    Result pending;
+    Callback callback;
+    JobScheduler::GroupId jobs = JobScheduler::noGroup;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(LatencyTester)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LatencyTester)
+};
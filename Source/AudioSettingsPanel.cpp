@@ -0,0 +1,104 @@
+#include "AudioSettingsPanel.h"
+
+AudioSettingsPanel::AudioSettingsPanel(juce::AudioDeviceManager& manager, CallbackMonitor& monitor, LatencyTester& tester)
+    : deviceManager(manager), callbackMonitor(monitor), latencyTester(tester)
+{
+    addAndMakeVisible(selector);
+
+    timingLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    addAndMakeVisible(timingLabel);
+
+    resetButton.setTooltip("Start the timing statistics again, e.g. after changing the buffer size");
+    resetButton.onClick = [this] { callbackMonitor.reset(); };
+    addAndMakeVisible(resetButton);
+
+    latencyLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    latencyLabel.setText("Cable output 1 to an enabled input, then measure. The output is a burst of noise for a second.",
+                         juce::dontSendNotification);
+    addAndMakeVisible(latencyLabel);
+
+    measureButton.onClick = [this] { measureLatency(); };
+    addAndMakeVisible(measureButton);
+
+    setSize(520, 560);
+    startTimerHz(4);
+}
+
+AudioSettingsPanel::~AudioSettingsPanel()
+{
+    stopTimer();
+}
+
+void AudioSettingsPanel::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::darkgrey);
+}
+
+void AudioSettingsPanel::resized()
+{
+    auto area = getLocalBounds().reduced(10);
+
+    auto latencyRow = area.removeFromBottom(44);
+    measureButton.setBounds(latencyRow.removeFromRight(130).withSizeKeepingCentre(130, 26));
+    latencyLabel.setBounds(latencyRow);
+
+    area.removeFromBottom(6);
+    auto timingRow = area.removeFromBottom(44);
+    resetButton.setBounds(timingRow.removeFromRight(130).withSizeKeepingCentre(130, 26));
+    timingLabel.setBounds(timingRow);
+
+    selector.setBounds(area);
+}
+
+void AudioSettingsPanel::timerCallback()
+{
+    const auto report = callbackMonitor.getReport();
+
+    juce::String text;
+    text << "Block " << juce::String(report.blockMs, 2) << " ms, jitter " << juce::String(report.jitterMs, 2)
+         << " ms, worst gap " << juce::String(report.worstIntervalMs, 2) << " ms\n"
+         << "Peak load " << juce::roundToInt(report.peakLoad * 100.0) << "%, late callbacks "
+         << report.lateCallbacks << " of " << report.callbacks;
+
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+    {
+        const int xruns = device->getXRunCount();
+        if (xruns >= 0)
+            text << ", driver xruns " << xruns;
+    }
+
+    timingLabel.setText(text, juce::dontSendNotification);
+    measureButton.setEnabled(!latencyTester.isRunning());
+}
+
+void AudioSettingsPanel::measureLatency()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr || device->getActiveInputChannels().isZero())
+    {
+        latencyLabel.setText("Enable an input channel above first.", juce::dontSendNotification);
+        return;
+    }
+
+    latencyLabel.setText("Measuring...", juce::dontSendNotification);
+    measureButton.setEnabled(false);
+
+    juce::WeakReference<AudioSettingsPanel> weakThis(this);
+    latencyTester.start(device->getCurrentSampleRate(),
+                        device->getInputLatencyInSamples() + device->getOutputLatencyInSamples(),
+                        [weakThis](const LatencyTester::Result& result)
+    {
+        auto* panel = weakThis.get();
+        if (panel == nullptr)
+            return;
+
+        auto toMs = [&result](int samples) { return juce::String(1000.0 * samples / result.sampleRate, 2) + " ms"; };
+
+        juce::String text = "Nothing came back: check the loopback cable and the input level.";
+        if (result.found)
+            text = "Round trip " + toMs(result.roundTripSamples) + " (" + juce::String(result.roundTripSamples)
+                 + " samples); the driver reports " + toMs(result.reportedSamples) + ".";
+
+        panel->latencyLabel.setText(text, juce::dontSendNotification);
+    });
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AudioDiagnostics.h"
+
+// Device, sample rate and buffer size (ALSA or JACK on Linux, whatever the platform
+// offers elsewhere), with the callback timing report and a loopback latency test, for
+// finding the smallest buffer that plays without dropouts on this machine.
+class AudioSettingsPanel : public juce::Component,
+                           private juce::Timer
+{
+public:
+    AudioSettingsPanel(juce::AudioDeviceManager& manager, CallbackMonitor& monitor, LatencyTester& tester);
+    ~AudioSettingsPanel() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    void measureLatency();
+
+    juce::AudioDeviceManager& deviceManager;
+    CallbackMonitor& callbackMonitor;
+    LatencyTester& latencyTester;
+
+    // inputs are only needed for the latency test; outputs 3/4 are the headphones
+    juce::AudioDeviceSelectorComponent selector{ deviceManager, 0, 2, 2, 4, false, false, false, false };
+    juce::Label timingLabel;
+    juce::TextButton resetButton{ "Reset" };
+    juce::Label latencyLabel;
+    juce::TextButton measureButton{ "Measure latency" };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(AudioSettingsPanel)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioSettingsPanel)
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+// Read-only tap on an audio stream for the GUI. The audio thread measures peak/RMS per
+// block and copies a mono mix into a lock-free FIFO; the GUI polls the levels and drains
+// the FIFO for its spectrum. Nothing here ever blocks or allocates on the audio thread,
+// and if the GUI falls behind the newest samples are simply dropped.
+class AudioTap
+{
+public:
+    static constexpr int maxChannels = 2;
+
+    AudioTap();
+
+    void prepare(double sampleRate);
+
+    // audio thread
+    void push(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // GUI thread
+    float takePeak(int channel);          // highest sample magnitude since the last call
+    float getRms(int channel) const;      // ~300 ms RMS
+    int readSamples(float* dest, int maxSamples);
+    double getSampleRate() const { return sampleRate.load(); }
+
+private:
+    static constexpr int fifoSize = 1 << 14;
+
+    juce::AbstractFifo fifo{ fifoSize };
+    std::vector<float> ring;
+
+    std::atomic<float> peaks[maxChannels];
+    std::atomic<float> meanSquares[maxChannels];
+    std::atomic<double> sampleRate{ 44100.0 };
+    std::atomic<bool> resetRequested{ false }; // set by prepare(), carried out by the reader
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioTap)
+};
@@ -0,0 +1,522 @@
+#include "BandWaveform.h"
+#include "CodecRegistry.h"
+#include "AppLog.h"
+
+namespace
+{
+    constexpr int preRollSamples = 4096;
+    constexpr int fileMagic = 0x57504153; // "SAPW"
+    constexpr int fileVersion = 1;
+
+    static_assert(sizeof(BandWaveform::Bucket) == 4, "buckets are written to disk as they are");
+
+    // The two crossovers as four biquads in lock-step: lanes 0 and 1 are the first stages of
+    // the low-pass and the high-pass, lanes 2 and 3 their second stages (a Linkwitz-Riley
+    // filter is two Butterworths in series), fed with the first stages' output from the
+    // previous sample. No lane waits on another within a sample, so the compiler keeps all
+    // four in one SIMD register; a sample of delay on the second stage doesn't show in a level.
+    struct CrossoverBank
+    {
+        static constexpr int numLanes = 4;
+
+        alignas(16) float b0[numLanes], b1[numLanes], b2[numLanes], a1[numLanes], a2[numLanes];
+        alignas(16) float z1[numLanes] = {}, z2[numLanes] = {}, out[numLanes] = {};
+
+        explicit CrossoverBank(double sampleRate)
+        {
+            const auto lowPass = juce::IIRCoefficients::makeLowPass(sampleRate, BandSplitter::lowCrossoverHz);
+            const auto highPass = juce::IIRCoefficients::makeHighPass(sampleRate, BandSplitter::highCrossoverHz);
+            const juce::IIRCoefficients* lanes[numLanes] = { &lowPass, &highPass, &lowPass, &highPass };
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                const auto* c = lanes[lane]->coefficients;
+                b0[lane] = c[0];
+                b1[lane] = c[1];
+                b2[lane] = c[2];
+                a1[lane] = c[3];
+                a2[lane] = c[4];
+            }
+        }
+
+        void process(float x, float& low, float& high)
+        {
+            alignas(16) const float in[numLanes] = { x, x, out[0], out[1] };
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                const float y = b0[lane] * in[lane] + z1[lane];
+                z1[lane] = b1[lane] * in[lane] - a1[lane] * y + z2[lane];
+                z2[lane] = b2[lane] * in[lane] - a2[lane] * y;
+                out[lane] = y;
+            }
+
+            low = out[2];
+            high = out[3];
+        }
+    };
+
+    juce::uint8 toByte(float level)
+    {
+        return (juce::uint8) juce::jlimit(0, 255, juce::roundToInt(level * 255.0f));
+    }
+}
+
+//==============================================================================
+void BandWaveform::draw(juce::Graphics& g, juce::Rectangle<int> area) const
+{
+    if (!isValid() || area.isEmpty())
+        return;
+
+    const float centreY = area.toFloat().getCentreY();
+    const float halfHeight = (float) area.getHeight() * 0.5f;
+    const double bucketsPerPixel = (double) buckets.size() / area.getWidth();
+
+    for (int x = 0; x < area.getWidth(); ++x)
+    {
+        // loudest of the buckets under this pixel
+        const auto first = (size_t) (x * bucketsPerPixel);
+        const auto last = juce::jmin(buckets.size(), juce::jmax(first + 1, (size_t) ((x + 1) * bucketsPerPixel)));
+
+        Bucket column;
+        for (auto i = first; i < last; ++i)
+        {
+            column.peak = juce::jmax(column.peak, buckets[i].peak);
+            column.low = juce::jmax(column.low, buckets[i].low);
+            column.mid = juce::jmax(column.mid, buckets[i].mid);
+            column.high = juce::jmax(column.high, buckets[i].high);
+        }
+
+        if (column.peak == 0)
+            continue;
+
+        // hue from the band balance at full brightness, so quiet passages keep their colour
+        const int brightest = juce::jmax(1, (int) column.low, (int) column.mid, (int) column.high);
+        g.setColour(juce::Colour((juce::uint8) (column.low * 255 / brightest),
+                                 (juce::uint8) (column.mid * 255 / brightest),
+                                 (juce::uint8) (column.high * 255 / brightest)));
+
+        const float height = juce::jmax(1.0f, 2.0f * halfHeight * column.peak / 255.0f);
+        g.fillRect((float) (area.getX() + x), centreY - height * 0.5f, 1.0f, height);
+    }
+}
+
+bool BandWaveform::writeTo(juce::OutputStream& out) const
+{
+    out.writeInt(fileMagic);
+    out.writeInt(fileVersion);
+    out.writeDouble(sampleRate);
+    out.writeInt64(lengthInSamples);
+    out.writeInt((int) buckets.size());
+
+    return out.write(buckets.data(), buckets.size() * sizeof(Bucket));
+}
+
+bool BandWaveform::readFrom(juce::InputStream& in, BandWaveform& waveform)
+{
+    if (in.readInt() != fileMagic || in.readInt() != fileVersion)
+        return false;
+
+    waveform.sampleRate = in.readDouble();
+    waveform.lengthInSamples = in.readInt64();
+    const int numBuckets = in.readInt();
+
+    if (waveform.sampleRate <= 0.0 || numBuckets <= 0
+        || numBuckets != (waveform.lengthInSamples + samplesPerBucket - 1) / samplesPerBucket)
+        return false;
+
+    waveform.buckets.resize((size_t) numBuckets);
+    const auto numBytes = (int) (waveform.buckets.size() * sizeof(Bucket));
+    return in.read(waveform.buckets.data(), numBytes) == numBytes;
+}
+
+//==============================================================================
+bool BandSplitter::analyse(juce::AudioFormatReader& reader, juce::int64 firstBucket, juce::int64 numBuckets,
+                           Levels* levels, const std::function<bool()>& shouldStop)
+{
+    constexpr int bucketSize = BandWaveform::samplesPerBucket;
+    constexpr int chunk = bucketSize * 64;
+    const int numChannels = juce::jmax(1, (int) reader.numChannels);
+
+    juce::AudioBuffer<float> buffer(numChannels, chunk);
+    juce::HeapBlock<float> mono(chunk), squares(bucketSize);
+    CrossoverBank crossovers(reader.sampleRate);
+
+    const juce::int64 start = firstBucket * bucketSize;
+    const juce::int64 end = juce::jmin(reader.lengthInSamples, (firstBucket + numBuckets) * bucketSize);
+
+    // the filters run over a little of what comes before, so the first bucket isn't a transient
+    juce::int64 pos = juce::jmax((juce::int64) 0, start - preRollSamples);
+
+    while (pos < end)
+    {
+        if (shouldStop())
+            return false;
+
+        const bool preRoll = pos < start;
+        const auto n = (int) juce::jmin((juce::int64) chunk, (preRoll ? start : end) - pos);
+        reader.read(&buffer, 0, n, pos, true, true);
+
+        juce::FloatVectorOperations::copy(mono, buffer.getReadPointer(0), n);
+        for (int ch = 1; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::add(mono, buffer.getReadPointer(ch), n);
+        if (numChannels > 1)
+            juce::FloatVectorOperations::multiply(mono, 1.0f / (float) numChannels, n);
+
+        float low, high;
+
+        if (preRoll)
+        {
+            for (int i = 0; i < n; ++i)
+                crossovers.process(mono[i], low, high);
+
+            pos += n;
+            continue;
+        }
+
+        for (int offset = 0; offset < n; offset += bucketSize)
+        {
+            const int count = juce::jmin(bucketSize, n - offset);
+            const float* x = mono + offset;
+
+            const auto range = juce::FloatVectorOperations::findMinAndMax(x, count);
+            juce::FloatVectorOperations::multiply(squares, x, x, count);
+
+            float total = 0.0f, lowTotal = 0.0f, highTotal = 0.0f;
+            for (int i = 0; i < count; ++i)
+            {
+                crossovers.process(x[i], low, high);
+                total += squares[i];
+                lowTotal += low * low;
+                highTotal += high * high;
+            }
+
+            auto& level = levels[(pos + offset) / bucketSize - firstBucket];
+            level.peak = juce::jmax(-range.getStart(), range.getEnd());
+            level.low = std::sqrt(lowTotal / (float) count);
+            level.high = std::sqrt(highTotal / (float) count);
+
+            // the crossover's bands add up in energy, near enough for a display
+            level.mid = std::sqrt(juce::jmax(0.0f, total - lowTotal - highTotal) / (float) count);
+        }
+
+        pos += n;
+    }
+
+    return true;
+}
+
+BandWaveform BandSplitter::makeWaveform(double sampleRate, juce::int64 lengthInSamples, const std::vector<Levels>& levels)
+{
+    // each band is scaled to its own loudest bucket, so the colour shows the balance of the
+    // track rather than the bass always winning
+    Levels loudest{ 0.0f, 1.0e-4f, 1.0e-4f, 1.0e-4f };
+    for (auto& level : levels)
+    {
+        loudest.low = juce::jmax(loudest.low, level.low);
+        loudest.mid = juce::jmax(loudest.mid, level.mid);
+        loudest.high = juce::jmax(loudest.high, level.high);
+    }
+
+    BandWaveform waveform;
+    waveform.sampleRate = sampleRate;
+    waveform.lengthInSamples = lengthInSamples;
+    waveform.buckets.reserve(levels.size());
+
+    for (auto& level : levels)
+        waveform.buckets.push_back({ toByte(level.peak), toByte(level.low / loudest.low),
+                                     toByte(level.mid / loudest.mid), toByte(level.high / loudest.high) });
+
+    return waveform;
+}
+
+//==============================================================================
+// Shared by the jobs analysing the segments of one track; the last one to finish puts
+// the waveform together.
+struct BandWaveformCache::Analysis
+{
+    juce::WeakReference<BandWaveformCache> cache;
+    juce::File file;
+    juce::String key;
+    double sampleRate = 0.0;
+    juce::int64 lengthInSamples = 0;
+    juce::int64 bucketsPerSegment = 0;
+    std::vector<BandSplitter::Levels> levels;
+    std::atomic<int> remaining{ 0 };
+    std::atomic<bool> failed{ false };
+};
+
+JUCE_IMPLEMENT_SINGLETON(BandWaveformCache)
+
+BandWaveformCache::BandWaveformCache()
+{
+    jobs = JobScheduler::getInstance()->createGroup();
+}
+
+BandWaveformCache::~BandWaveformCache()
+{
+    if (auto* scheduler = JobScheduler::getInstanceWithoutCreating())
+        scheduler->cancelGroup(jobs, true);
+
+    clearSingletonInstance();
+}
+
+juce::File BandWaveformCache::getCacheDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("SimpleAudioPlayer")
+        .getChildFile("Waveforms");
+}
+
+void BandWaveformCache::request(const juce::File& file, const void* owner, Callback onReady, JobScheduler::Priority priority)
+{
+    const auto key = fileCacheKey(file);
+    Waveform inMemory;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        auto found = recent.find(key);
+        if (found != recent.end())
+        {
+            inMemory = found->second;
+        }
+        else
+        {
+            const bool alreadyQueued = pending.find(key) != pending.end();
+            auto& waiting = pending[key];
+
+            if (onReady != nullptr)
+                waiting.push_back({ owner, std::move(onReady) });
+
+            if (!alreadyQueued)
+            {
+                juce::WeakReference<BandWaveformCache> weakThis(this);
+                const auto group = jobs;
+
+                JobScheduler::getInstance()->schedule("Waveform " + file.getFileName(), priority, jobs,
+                    [weakThis, file, key, priority, group](const JobScheduler::Context& context)
+                    {
+                        load(weakThis, file, key, priority, group, context);
+                    });
+            }
+
+            return;
+        }
+    }
+
+    if (onReady != nullptr)
+        onReady(inMemory);
+}
+
+void BandWaveformCache::cancelRequests(const void* owner)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (auto& p : pending)
+        p.second.erase(std::remove_if(p.second.begin(), p.second.end(),
+                                      [owner](const Request& r) { return r.owner == owner; }),
+                       p.second.end());
+}
+
+// Runs on a scheduler worker: reads the waveform from disk, or splits the track into
+// segments and analyses them in parallel (this job takes the first).
+void BandWaveformCache::load(juce::WeakReference<BandWaveformCache> cache, const juce::File& file, const juce::String& key,
+                             JobScheduler::Priority priority, JobScheduler::GroupId group, const JobScheduler::Context& context)
+{
+    auto finish = [cache, key](Waveform waveform)
+    {
+        juce::MessageManager::callAsync([cache, key, waveform]
+        {
+            if (auto* c = cache.get())
+                c->loadFinished(key, waveform);
+        });
+    };
+
+    const auto cacheFile = getCacheDirectory().getChildFile(key + ".wave");
+    if (auto in = cacheFile.createInputStream())
+    {
+        auto waveform = std::make_shared<BandWaveform>();
+        if (BandWaveform::readFrom(*in, *waveform))
+        {
+            // the least recently used are the first to go when the directory is pruned
+            cacheFile.setLastModificationTime(juce::Time::getCurrentTime());
+            finish(waveform);
+            return;
+        }
+    }
+
+    auto reader = CodecRegistry::getInstance()->createReaderFor(file);
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0)
+    {
+        APP_LOG(deck, warning, "No waveform for {}: it can't be read", file.getFullPathName());
+        finish(nullptr);
+        return;
+    }
+
+    auto analysis = std::make_shared<Analysis>();
+    analysis->cache = cache;
+    analysis->file = file;
+    analysis->key = key;
+    analysis->sampleRate = reader->sampleRate;
+    analysis->lengthInSamples = reader->lengthInSamples;
+
+    const auto numBuckets = (reader->lengthInSamples + BandWaveform::samplesPerBucket - 1) / BandWaveform::samplesPerBucket;
+    analysis->levels.resize((size_t) numBuckets);
+
+    // a segment per worker, but none so short that its pre-roll is a noticeable share of the work
+    auto* scheduler = JobScheduler::getInstance();
+    const auto longEnough = juce::jmax((juce::int64) 1, (juce::int64) (reader->lengthInSamples / (minSegmentSeconds * reader->sampleRate)));
+    const auto wanted = juce::jmin((juce::int64) scheduler->getNumWorkers(), longEnough);
+
+    analysis->bucketsPerSegment = (numBuckets + wanted - 1) / wanted;
+    const auto numSegments = (int) ((numBuckets + analysis->bucketsPerSegment - 1) / analysis->bucketsPerSegment);
+    analysis->remaining = numSegments;
+
+    for (int segment = 1; segment < numSegments; ++segment)
+        scheduler->schedule("Waveform " + file.getFileName() + " part " + juce::String(segment + 1), priority, group,
+            [analysis, segment](const JobScheduler::Context& segmentContext)
+            {
+                analyseSegment(analysis, segment, nullptr, segmentContext);
+            });
+
+    analyseSegment(analysis, 0, std::move(reader), context);
+}
+
+// Runs on a scheduler worker.
+void BandWaveformCache::analyseSegment(std::shared_ptr<Analysis> analysis, int segment,
+                                       std::unique_ptr<juce::AudioFormatReader> reader, const JobScheduler::Context& context)
+{
+    if (reader == nullptr)
+        reader = CodecRegistry::getInstance()->createReaderFor(analysis->file);
+
+    const auto numBuckets = (juce::int64) analysis->levels.size();
+    const auto first = segment * analysis->bucketsPerSegment;
+    const auto count = juce::jmin(analysis->bucketsPerSegment, numBuckets - first);
+
+    const bool ok = reader != nullptr && !analysis->failed
+                 && BandSplitter::analyse(*reader, first, count, analysis->levels.data() + first,
+                                          [&context] { return context.shouldStop(); });
+    if (!ok)
+        analysis->failed = true;
+
+    if (--analysis->remaining > 0)
+        return;
+
+    Waveform waveform;
+    if (!analysis->failed)
+    {
+        auto result = std::make_shared<BandWaveform>(BandSplitter::makeWaveform(analysis->sampleRate, analysis->lengthInSamples,
+                                                                               analysis->levels));
+        store(analysis->key, *result);
+        waveform = result;
+    }
+
+    juce::MessageManager::callAsync([cache = analysis->cache, key = analysis->key, waveform]
+    {
+        if (auto* c = cache.get())
+            c->loadFinished(key, waveform);
+    });
+}
+
+// Runs on a scheduler worker. Written beside the old file and swapped in, so a reader
+// never sees half a waveform.
+void BandWaveformCache::store(const juce::String& key, const BandWaveform& waveform)
+{
+    const auto directory = getCacheDirectory();
+    directory.createDirectory();
+
+    juce::TemporaryFile temp(directory.getChildFile(key + ".wave"));
+
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk() || !waveform.writeTo(out))
+        {
+            APP_LOG(deck, warning, "Couldn't write the waveform cache {}", temp.getTargetFile().getFullPathName());
+            return;
+        }
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary())
+        return;
+
+    auto files = directory.findChildFiles(juce::File::findFiles, false, "*.wave");
+    if (files.size() <= maxOnDisk)
+        return;
+
+    std::sort(files.begin(), files.end(), [](const juce::File& a, const juce::File& b)
+    {
+        return a.getLastModificationTime() < b.getLastModificationTime();
+    });
+
+    for (int i = 0; i < files.size() - maxOnDisk; ++i)
+        files.getReference(i).deleteFile();
+}
+
+void BandWaveformCache::setBudgetBytes(size_t newBudget)
+{
+    const juce::ScopedLock sl(lock);
+    budgetBytes = newBudget;
+    evictOverBudget();
+}
+
+size_t BandWaveformCache::getBudgetBytes() const
+{
+    const juce::ScopedLock sl(lock);
+    return budgetBytes;
+}
+
+size_t BandWaveformCache::getBytesUsed() const
+{
+    const juce::ScopedLock sl(lock);
+    return bytesUsed;
+}
+
+// Called with the lock held. A deck showing an evicted waveform keeps its own reference.
+void BandWaveformCache::evictOverBudget()
+{
+    while ((recentOrder.size() > maxInMemory || bytesUsed > budgetBytes) && recentOrder.size() > 1)
+    {
+        auto oldest = recent.find(recentOrder[0]);
+        if (oldest != recent.end())
+        {
+            bytesUsed -= oldest->second->getSizeInBytes();
+            recent.erase(oldest);
+        }
+
+        recentOrder.remove(0);
+    }
+}
+
+void BandWaveformCache::loadFinished(const juce::String& key, Waveform waveform)
+{
+    std::vector<Request> requests;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        if (waveform != nullptr)
+        {
+            auto& slot = recent[key];
+            if (slot != nullptr)
+                bytesUsed -= slot->getSizeInBytes();
+
+            slot = waveform;
+            bytesUsed += waveform->getSizeInBytes();
+            recentOrder.removeString(key);
+            recentOrder.add(key);
+            evictOverBudget();
+        }
+
+        auto it = pending.find(key);
+        if (it != pending.end())
+        {
+            requests = std::move(it->second);
+            pending.erase(it);
+        }
+    }
+
+    if (waveform != nullptr)
+        for (auto& r : requests)
+            r.callback(waveform);
+}
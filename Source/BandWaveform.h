@@ -0,0 +1,120 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include <functional>
+#include <map>
+#include <memory>
+
+// Overview waveform of one track with its frequency content: for every bucket of
+// samplesPerBucket samples, the peak level and how loud the low (< 200 Hz), mid and high
+// (> 2 kHz) bands are, each relative to that band's loudest bucket in the track.
+struct BandWaveform
+{
+    static constexpr int samplesPerBucket = 512;
+
+    struct Bucket
+    {
+        juce::uint8 peak = 0, low = 0, mid = 0, high = 0;
+    };
+
+    double sampleRate = 0.0;
+    juce::int64 lengthInSamples = 0;
+    std::vector<Bucket> buckets;
+
+    bool isValid() const { return sampleRate > 0.0 && !buckets.empty(); }
+    double getLengthInSeconds() const { return (double) lengthInSamples / sampleRate; }
+    size_t getSizeInBytes() const { return sizeof(BandWaveform) + buckets.size() * sizeof(Bucket); }
+
+    // Draws the whole track into area, one column per pixel: height from the peak, colour
+    // from the bands (red low, green mid, blue high). Meant to be drawn once into an image.
+    void draw(juce::Graphics& g, juce::Rectangle<int> area) const;
+
+    bool writeTo(juce::OutputStream& out) const;
+    static bool readFrom(juce::InputStream& in, BandWaveform& waveform);
+};
+
+// Band levels for a stretch of a track, from a Linkwitz-Riley crossover pair run as four
+// biquads in lock-step (see CrossoverBank in the .cpp). Tracks are cut into bucket-aligned
+// segments analysed on separate workers; each starts a little early so its filters have
+// settled by the time its first bucket begins.
+class BandSplitter
+{
+public:
+    static constexpr float lowCrossoverHz = 200.0f;
+    static constexpr float highCrossoverHz = 2000.0f;
+
+    // raw levels, before they are scaled per band into BandWaveform::Bucket
+    struct Levels
+    {
+        float peak = 0.0f, low = 0.0f, mid = 0.0f, high = 0.0f;
+    };
+
+    // Fills one Levels per bucket from firstBucket to the end of the segment; false if
+    // shouldStop() asked it to bail out.
+    static bool analyse(juce::AudioFormatReader& reader, juce::int64 firstBucket, juce::int64 numBuckets,
+                        Levels* levels, const std::function<bool()>& shouldStop);
+
+    static BandWaveform makeWaveform(double sampleRate, juce::int64 lengthInSamples, const std::vector<Levels>& levels);
+};
+
+// Process-wide RGB waveforms. Tracks are analysed on the shared job scheduler, split
+// across as many workers as there are, and the result is written to
+// SimpleAudioPlayer/Waveforms so a track is only ever analysed once; the last eight are
+// also kept in memory, fewer if they would go over the byte budget.
+class BandWaveformCache : public juce::DeletedAtShutdown
+{
+public:
+    using Waveform = std::shared_ptr<const BandWaveform>;
+    using Callback = std::function<void(Waveform)>;
+
+    BandWaveformCache();
+    ~BandWaveformCache() override;
+
+    // The callback runs on the message thread once the waveform is ready: at once if it
+    // is in memory, otherwise after it's read from disk or analysed (not at all if the
+    // file can't be read).
+    void request(const juce::File& file, const void* owner, Callback onReady,
+                 JobScheduler::Priority priority = JobScheduler::Priority::loadedTrack);
+    void cancelRequests(const void* owner);
+
+    // caps the last-eight set by size too; the newest waveform is always kept, however big
+    void setBudgetBytes(size_t newBudget);
+    size_t getBudgetBytes() const;
+    size_t getBytesUsed() const;
+
+    JUCE_DECLARE_SINGLETON(BandWaveformCache, false)
+
+private:
+    struct Request
+    {
+        const void* owner;
+        Callback callback;
+    };
+
+    struct Analysis;
+
+    static constexpr int maxOnDisk = 500;
+    static constexpr int maxInMemory = 8;
+    static constexpr double minSegmentSeconds = 20.0;
+
+    static juce::File getCacheDirectory();
+
+    static void load(juce::WeakReference<BandWaveformCache> cache, const juce::File& file, const juce::String& key,
+                     JobScheduler::Priority priority, JobScheduler::GroupId group, const JobScheduler::Context& context);
+    static void analyseSegment(std::shared_ptr<Analysis> analysis, int segment, std::unique_ptr<juce::AudioFormatReader> reader,
+                               const JobScheduler::Context& context);
+    static void store(const juce::String& key, const BandWaveform& waveform);
+    void loadFinished(const juce::String& key, Waveform waveform);
+    void evictOverBudget();
+
+    juce::CriticalSection lock;
+    std::map<juce::String, std::vector<Request>> pending;
+    std::map<juce::String, Waveform> recent;
+    juce::StringArray recentOrder; // oldest first
+    size_t budgetBytes = (size_t) 4 * 1024 * 1024;
+    size_t bytesUsed = 0;
+    JobScheduler::GroupId jobs = JobScheduler::noGroup;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(BandWaveformCache)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BandWaveformCache)
+};
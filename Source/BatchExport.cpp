@@ -0,0 +1,425 @@
+#include "BatchExport.h"
+#include "CodecRegistry.h"
+#include "AppLog.h"
+
+namespace
+{
+    constexpr double exportRates[] = { 0.0, 44100.0, 48000.0, 96000.0 };
+}
+
+BatchExport::BatchExport(const juce::Array<juce::File>& files, const Settings& exportSettings)
+    : settings(exportSettings)
+{
+    settings.destination.createDirectory();
+
+    const auto extension = getFileExtension(settings.format);
+    auto* loudnessCache = LoudnessCache::getInstance();
+    juce::StringArray taken;
+
+    for (auto& file : files)
+    {
+        auto* track = tracks.add(new Track());
+        track->source = file;
+        track->loudnessKnown = settings.normalize && loudnessCache->find(file, track->loudness);
+
+        // names are chosen here rather than in the jobs, so two tracks can't pick the same one
+        const auto name = file.getFileNameWithoutExtension();
+        auto target = settings.destination.getChildFile(name + extension);
+
+        for (int n = 2; target.exists() || taken.contains(target.getFullPathName()); ++n)
+            target = settings.destination.getChildFile(name + " (" + juce::String(n) + ")" + extension);
+
+        taken.add(target.getFullPathName());
+        track->target = target;
+    }
+
+    auto* scheduler = JobScheduler::getInstance();
+    jobs = scheduler->createGroup();
+
+    APP_LOG(general, info, "Exporting {} tracks as {} to {}", tracks.size(), getFormatName(settings.format),
+            settings.destination.getFullPathName());
+
+    for (auto* track : tracks)
+        scheduler->schedule("Export " + track->source.getFileName(), JobScheduler::Priority::library, jobs,
+            [this, track](const JobScheduler::Context& context) { exportTrack(*track, settings, context); });
+}
+
+BatchExport::~BatchExport()
+{
+    if (auto* scheduler = JobScheduler::getInstanceWithoutCreating())
+        scheduler->cancelGroup(jobs, true);
+}
+
+void BatchExport::cancel()
+{
+    JobScheduler::getInstance()->cancelGroup(jobs);
+
+    // queued jobs are skipped, so they never get to mark their tracks
+    for (auto* track : tracks)
+    {
+        auto expected = State::queued;
+        track->state.compare_exchange_strong(expected, State::cancelled);
+    }
+}
+
+juce::String BatchExport::getError(int index) const
+{
+    return getState(index) == State::failed ? tracks[index]->error : juce::String();
+}
+
+double BatchExport::getProgress() const
+{
+    if (tracks.isEmpty())
+        return 1.0;
+
+    double total = 0.0;
+    for (auto* track : tracks)
+        total += track->state == State::running ? (double) track->progress.load()
+               : track->state == State::queued ? 0.0 : 1.0;
+
+    return total / tracks.size();
+}
+
+bool BatchExport::isFinished() const
+{
+    return countTracks(State::queued) == 0 && countTracks(State::running) == 0;
+}
+
+int BatchExport::countTracks(State state) const
+{
+    int count = 0;
+    for (auto* track : tracks)
+        if (track->state == state)
+            ++count;
+
+    return count;
+}
+
+juce::String BatchExport::getFormatName(Format format)
+{
+    switch (format)
+    {
+        case Format::wav16:  return "WAV 16-bit";
+        case Format::wav24:  return "WAV 24-bit";
+        case Format::aiff16: return "AIFF 16-bit";
+        case Format::flac16: return "FLAC 16-bit";
+        case Format::flac24: return "FLAC 24-bit";
+    }
+
+    return {};
+}
+
+juce::String BatchExport::getFileExtension(Format format)
+{
+    switch (format)
+    {
+        case Format::wav16:
+        case Format::wav24:  return ".wav";
+        case Format::aiff16: return ".aiff";
+        case Format::flac16:
+        case Format::flac24: return ".flac";
+    }
+
+    return {};
+}
+
+int BatchExport::getBitDepth(Format format)
+{
+    return format == Format::wav24 || format == Format::flac24 ? 24 : 16;
+}
+
+std::unique_ptr<juce::AudioFormat> BatchExport::createFormat(Format format)
+{
+    switch (format)
+    {
+        case Format::wav16:
+        case Format::wav24:  return std::make_unique<juce::WavAudioFormat>();
+        case Format::aiff16: return std::make_unique<juce::AiffAudioFormat>();
+        case Format::flac16:
+        case Format::flac24: return std::make_unique<juce::FlacAudioFormat>();
+    }
+
+    return {};
+}
+
+// Runs on a scheduler worker.
+void BatchExport::exportTrack(Track& track, const Settings& settings, const JobScheduler::Context& context)
+{
+    // cancel() may have got to it first
+    auto expected = State::queued;
+    if (!track.state.compare_exchange_strong(expected, State::running))
+        return;
+
+    auto fail = [&track](const juce::String& message)
+    {
+        APP_LOG(general, warning, "Couldn't export {}: {}", track.source.getFullPathName(), message);
+        track.error = message;
+        track.state = State::failed;
+    };
+
+    auto reader = CodecRegistry::getInstance()->createReaderFor(track.source);
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0)
+    {
+        fail("the file can't be read");
+        return;
+    }
+
+    // a track the playlist hasn't measured yet is measured here, as the first half of the work
+    float gain = 1.0f;
+    const float measuredShare = settings.normalize && !track.loudnessKnown ? 0.5f : 0.0f;
+
+    if (settings.normalize)
+    {
+        auto loudness = track.loudness;
+        if (!track.loudnessKnown && !LoudnessMeter::measure(*reader, loudness, [&context] { return context.shouldStop(); }))
+        {
+            track.state = State::cancelled;
+            return;
+        }
+
+        gain = loudness.getNormalizationGain(settings.targetLufs);
+        track.progress = measuredShare;
+    }
+
+    const double sourceRate = reader->sampleRate;
+    const double targetRate = settings.sampleRate > 0.0 ? settings.sampleRate : sourceRate;
+    const int numChannels = (int) reader->numChannels;
+    const auto numOutputSamples = (juce::int64) std::ceil((double) reader->lengthInSamples * targetRate / sourceRate);
+
+    auto format = createFormat(settings.format);
+    juce::TemporaryFile temp(track.target);
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (auto stream = temp.getFile().createOutputStream())
+    {
+        writer.reset(format->createWriterFor(stream.get(), targetRate, (unsigned int) numChannels,
+                                             getBitDepth(settings.format), {}, 0));
+        if (writer != nullptr)
+            stream.release(); // the writer owns it now
+    }
+
+    if (writer == nullptr)
+    {
+        fail(getFormatName(settings.format) + " can't be written at " + juce::String(targetRate, 0) + " Hz with "
+             + juce::String(numChannels) + " channels");
+        return;
+    }
+
+    // the same resampler the decks play through
+    juce::AudioFormatReaderSource readerSource(reader.get(), false);
+    juce::ResamplingAudioSource resampler(&readerSource, false, numChannels);
+    resampler.setResamplingRatio(sourceRate / targetRate);
+    resampler.prepareToPlay(blockSize, targetRate);
+
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+
+    for (juce::int64 written = 0; written < numOutputSamples;)
+    {
+        // the temporary file is deleted on the way out
+        if (context.shouldStop())
+        {
+            track.state = State::cancelled;
+            return;
+        }
+
+        const auto n = (int) juce::jmin((juce::int64) blockSize, numOutputSamples - written);
+
+        if (targetRate == sourceRate)
+            reader->read(&buffer, 0, n, written, true, true);
+        else
+            resampler.getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, n));
+
+        buffer.applyGain(0, n, gain);
+
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, n))
+        {
+            fail("writing failed (is the disk full?)");
+            return;
+        }
+
+        written += n;
+        track.progress = measuredShare + (1.0f - measuredShare) * (float) ((double) written / (double) numOutputSamples);
+    }
+
+    resampler.releaseResources();
+    writer.reset(); // finishes the header and closes the file
+
+    if (!temp.overwriteTargetFileWithTemporary())
+    {
+        fail("the file couldn't be moved into place");
+        return;
+    }
+
+    track.state = State::done;
+}
+
+//==============================================================================
+BatchExportPanel::BatchExportPanel(const juce::Array<juce::File>& filesToExport)
+    : files(filesToExport),
+      destination(juce::File::getSpecialLocation(juce::File::userMusicDirectory).getChildFile("SimpleAudioPlayer Exports"))
+{
+    for (auto* label : { &formatLabel, &rateLabel, &destinationLabel, &statusLabel })
+    {
+        label->setColour(juce::Label::textColourId, juce::Colours::white);
+        addAndMakeVisible(label);
+    }
+
+    for (int i = 0; i < BatchExport::numFormats; ++i)
+        formatBox.addItem(BatchExport::getFormatName((BatchExport::Format) i), i + 1);
+    formatBox.setSelectedId(1, juce::dontSendNotification);
+    addAndMakeVisible(formatBox);
+
+    for (int i = 0; i < juce::numElementsInArray(exportRates); ++i)
+        rateBox.addItem(exportRates[i] > 0.0 ? juce::String(exportRates[i], 0) + " Hz" : "Same as the track", i + 1);
+    rateBox.setSelectedId(1, juce::dontSendNotification);
+    addAndMakeVisible(rateBox);
+
+    normalizeButton.setButtonText("Normalize to " + juce::String(LoudnessCache::getInstance()->getTargetLufs(), 0) + " LUFS");
+    addAndMakeVisible(normalizeButton);
+
+    destinationButton.onClick = [this] { chooseDestination(); };
+    addAndMakeVisible(destinationButton);
+
+    startButton.onClick = [this] { startOrCancel(); };
+    addAndMakeVisible(startButton);
+
+    addAndMakeVisible(progressBar);
+
+    statusLabel.setText(juce::String(files.size()) + " tracks in the playlist", juce::dontSendNotification);
+    updateControls();
+
+    setSize(460, 250);
+}
+
+BatchExportPanel::~BatchExportPanel()
+{
+    stopTimer();
+    exporter = nullptr;
+}
+
+void BatchExportPanel::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::darkgrey);
+}
+
+void BatchExportPanel::resized()
+{
+    auto area = getLocalBounds().reduced(10);
+
+    auto row = [&area]
+    {
+        auto r = area.removeFromTop(26);
+        area.removeFromTop(8);
+        return r;
+    };
+
+    auto formatRow = row();
+    formatLabel.setBounds(formatRow.removeFromLeft(100));
+    formatBox.setBounds(formatRow);
+
+    auto rateRow = row();
+    rateLabel.setBounds(rateRow.removeFromLeft(100));
+    rateBox.setBounds(rateRow);
+
+    normalizeButton.setBounds(row());
+
+    auto destinationRow = row();
+    destinationButton.setBounds(destinationRow.removeFromRight(90));
+    destinationLabel.setBounds(destinationRow);
+
+    auto startRow = row();
+    startButton.setBounds(startRow.removeFromRight(90));
+    startRow.removeFromRight(8);
+    progressBar.setBounds(startRow);
+
+    statusLabel.setBounds(area);
+}
+
+void BatchExportPanel::chooseDestination()
+{
+    chooser = std::make_unique<juce::FileChooser>("Export to...", destination);
+    chooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories,
+        [safeThis = juce::Component::SafePointer<BatchExportPanel>(this)](const juce::FileChooser& fc)
+        {
+            if (safeThis == nullptr || fc.getResult() == juce::File())
+                return;
+
+            safeThis->destination = fc.getResult();
+            safeThis->updateControls();
+        });
+}
+
+void BatchExportPanel::startOrCancel()
+{
+    if (exporter != nullptr && !exporter->isFinished())
+    {
+        exporter->cancel();
+        return;
+    }
+
+    if (files.isEmpty())
+        return;
+
+    BatchExport::Settings settings;
+    settings.format = (BatchExport::Format) (formatBox.getSelectedId() - 1);
+    settings.sampleRate = exportRates[juce::jlimit(0, juce::numElementsInArray(exportRates) - 1, rateBox.getSelectedId() - 1)];
+    settings.normalize = normalizeButton.getToggleState();
+    settings.targetLufs = LoudnessCache::getInstance()->getTargetLufs();
+    settings.destination = destination;
+
+    exporter = std::make_unique<BatchExport>(files, settings);
+    progress = 0.0;
+    startTimerHz(10);
+    updateControls();
+}
+
+void BatchExportPanel::updateControls()
+{
+    const bool running = exporter != nullptr && !exporter->isFinished();
+
+    for (auto* c : std::initializer_list<juce::Component*>{ &formatBox, &rateBox, &normalizeButton, &destinationButton })
+        c->setEnabled(!running);
+
+    startButton.setButtonText(running ? "Cancel" : "Export");
+    startButton.setEnabled(running || !files.isEmpty());
+    destinationLabel.setText(destination.getFullPathName(), juce::dontSendNotification);
+}
+
+void BatchExportPanel::timerCallback()
+{
+    if (exporter == nullptr)
+        return;
+
+    using State = BatchExport::State;
+
+    progress = exporter->getProgress();
+
+    const int done = exporter->countTracks(State::done);
+    const int failed = exporter->countTracks(State::failed);
+    const int cancelled = exporter->countTracks(State::cancelled);
+
+    juce::String text;
+    text << done << " of " << exporter->getNumTracks() << " exported";
+    if (failed > 0)
+        text << ", " << failed << " failed";
+    if (cancelled > 0)
+        text << ", " << cancelled << " cancelled";
+
+    if (exporter->isFinished())
+    {
+        stopTimer();
+
+        for (int i = 0; i < exporter->getNumTracks(); ++i)
+        {
+            if (exporter->getState(i) == State::failed)
+            {
+                text << "\n" << exporter->getTarget(i).getFileNameWithoutExtension() << ": " << exporter->getError(i);
+                break;
+            }
+        }
+
+        updateControls();
+    }
+
+    statusLabel.setText(text, juce::dontSendNotification);
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include "Loudness.h"
+#include <atomic>
+
+// Converts a list of tracks to one format and sample rate for use elsewhere. Each track is
+// a job on the shared scheduler, so as many convert at once as there are workers, and each
+// streams through fixed-size blocks (decode, resample, gain, encode): memory use doesn't
+// grow with the length of the tracks or of the list. Files are written beside their final
+// name and renamed once complete, so a failed or cancelled track leaves nothing behind;
+// existing files are never overwritten.
+class BatchExport
+{
+public:
+    enum class Format { wav16, wav24, aiff16, flac16, flac24 };
+    static constexpr int numFormats = 5;
+
+    struct Settings
+    {
+        Format format = Format::wav16;
+        double sampleRate = 0.0; // 0 keeps each track's own
+        bool normalize = false;  // to targetLufs, as the decks' Normalize does
+        double targetLufs = -18.0;
+        juce::File destination;
+    };
+
+    enum class State { queued, running, done, failed, cancelled };
+
+    // message thread; the jobs start straight away
+    BatchExport(const juce::Array<juce::File>& files, const Settings& exportSettings);
+
+    // cancels, and waits for the tracks being converted to stop
+    ~BatchExport();
+
+    void cancel();
+
+    int getNumTracks() const { return tracks.size(); }
+    State getState(int index) const { return tracks[index]->state.load(); }
+    juce::File getTarget(int index) const { return tracks[index]->target; }
+    juce::String getError(int index) const; // empty unless the track failed
+
+    // 0..1 over all tracks
+    double getProgress() const;
+    bool isFinished() const;
+    int countTracks(State state) const;
+
+    static juce::String getFormatName(Format format);
+    static juce::String getFileExtension(Format format);
+
+private:
+    struct Track
+    {
+        juce::File source, target;
+        bool loudnessKnown = false;
+        LoudnessResult loudness; // from LoudnessCache, if it had measured the track already
+        std::atomic<State> state{ State::queued };
+        std::atomic<float> progress{ 0.0f };
+        juce::String error; // written before state becomes failed
+    };
+
+    static constexpr int blockSize = 16384;
+
+    static void exportTrack(Track& track, const Settings& settings, const JobScheduler::Context& context);
+    static std::unique_ptr<juce::AudioFormat> createFormat(Format format);
+    static int getBitDepth(Format format);
+
+    Settings settings;
+    juce::OwnedArray<Track> tracks;
+    JobScheduler::GroupId jobs = JobScheduler::noGroup;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BatchExport)
+};
+
+// Export settings and progress for the playlist, in its own window. Closing the window
+// cancels an export that is still running.
+class BatchExportPanel : public juce::Component,
+                         private juce::Timer
+{
+public:
+    explicit BatchExportPanel(const juce::Array<juce::File>& filesToExport);
+    ~BatchExportPanel() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    void chooseDestination();
+    void startOrCancel();
+    void updateControls();
+
+    juce::Array<juce::File> files;
+    juce::File destination;
+
+    juce::Label formatLabel{ {}, "Format" };
+    juce::ComboBox formatBox;
+    juce::Label rateLabel{ {}, "Sample rate" };
+    juce::ComboBox rateBox;
+    juce::ToggleButton normalizeButton;
+    juce::Label destinationLabel;
+    juce::TextButton destinationButton{ "Folder..." };
+    juce::TextButton startButton{ "Export" };
+
+    double progress = 0.0;
+    juce::ProgressBar progressBar{ progress };
+    juce::Label statusLabel;
+
+    std::unique_ptr<juce::FileChooser> chooser;
+    std::unique_ptr<BatchExport> exporter;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BatchExportPanel)
+};
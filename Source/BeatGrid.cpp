@@ -0,0 +1,270 @@
+#include "BeatGrid.h"
+
+namespace
+{
+    constexpr double kMinBpm = 70.0;
+    constexpr double kMaxBpm = 180.0;
+
+    // mean of x^2 over one hop; the squaring is vectorised, the sum is a plain loop the compiler unrolls
+    float meanSquare(const float* samples, float* scratch, int numSamples)
+    {
+        juce::FloatVectorOperations::multiply(scratch, samples, samples, numSamples);
+
+        float sum = 0.0f;
+        for (int i = 0; i < numSamples; ++i)
+            sum += scratch[i];
+
+        return sum / (float) numSamples;
+    }
+
+    float rise(float now, float before)
+    {
+        return juce::jmax(0.0f, std::log1p(1000.0f * now) - std::log1p(1000.0f * before));
+    }
+}
+
+//==============================================================================
+double BeatGrid::getBeatPhase(double seconds) const
+{
+    auto beats = (seconds - firstBeatSeconds) / getBeatLength();
+    return beats - std::floor(beats);
+}
+
+double BeatGrid::snap(double seconds) const
+{
+    auto beat = firstBeatSeconds + std::round((seconds - firstBeatSeconds) / getBeatLength()) * getBeatLength();
+    return beat < 0.0 ? beat + getBeatLength() : beat;
+}
+
+juce::String BeatGrid::toString() const
+{
+    return juce::String(bpm, 3) + ";" + juce::String(firstBeatSeconds, 4);
+}
+
+bool BeatGrid::fromString(const juce::String& text, BeatGrid& grid)
+{
+    auto parts = juce::StringArray::fromTokens(text, ";", "");
+    if (parts.size() != 2)
+        return false;
+
+    grid.bpm = parts[0].getDoubleValue();
+    grid.firstBeatSeconds = parts[1].getDoubleValue();
+    return grid.isValid();
+}
+
+//==============================================================================
+// One value per hop: how sharply the energy (and the energy of the first difference,
+// which favours hi-hats and snares) rose since the previous hop.
+std::vector<float> BeatDetector::computeOnsetEnvelope(juce::AudioFormatReader& reader, const std::function<bool()>& shouldStop)
+{
+    const int chunk = hopSize * 128;
+    const int numChannels = juce::jmax(1, (int) reader.numChannels);
+
+    juce::AudioBuffer<float> buffer(numChannels, chunk);
+    juce::HeapBlock<float> mono(chunk + 1), diff(chunk), scratch(hopSize);
+    mono[0] = 0.0f;
+
+    std::vector<float> fullEnergy, highEnergy;
+    fullEnergy.reserve((size_t) (reader.lengthInSamples / hopSize + 1));
+    highEnergy.reserve(fullEnergy.capacity());
+
+    for (juce::int64 pos = 0; pos < reader.lengthInSamples; pos += chunk)
+    {
+        if (shouldStop != nullptr && shouldStop())
+            return {};
+
+        auto n = (int) juce::jmin((juce::int64) chunk, reader.lengthInSamples - pos);
+        reader.read(&buffer, 0, n, pos, true, true);
+
+        // mono[0] holds the last sample of the previous chunk so the difference is continuous
+        float* m = mono + 1;
+        juce::FloatVectorOperations::copy(m, buffer.getReadPointer(0), n);
+        for (int ch = 1; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::add(m, buffer.getReadPointer(ch), n);
+        if (numChannels > 1)
+            juce::FloatVectorOperations::multiply(m, 1.0f / (float) numChannels, n);
+
+        juce::FloatVectorOperations::subtract(diff, m, mono, n);
+        mono[0] = m[n - 1];
+
+        for (int h = 0; h + hopSize <= n; h += hopSize)
+        {
+            fullEnergy.push_back(meanSquare(m + h, scratch, hopSize));
+            highEnergy.push_back(meanSquare(diff + h, scratch, hopSize));
+        }
+    }
+
+    std::vector<float> envelope(fullEnergy.size(), 0.0f);
+    for (size_t i = 1; i < envelope.size(); ++i)
+        envelope[i] = rise(fullEnergy[i], fullEnergy[i - 1]) + rise(highEnergy[i], highEnergy[i - 1]);
+
+    // subtract a moving average so only peaks above the local level count
+    const int radius = 8;
+    std::vector<float> flattened(envelope.size(), 0.0f);
+    double runningSum = 0.0;
+    int lo = 0, hi = 0;
+
+    for (int i = 0; i < (int) envelope.size(); ++i)
+    {
+        while (hi < (int) envelope.size() && hi <= i + radius)
+            runningSum += envelope[(size_t) hi++];
+        while (lo < i - radius)
+            runningSum -= envelope[(size_t) lo++];
+
+        auto mean = (float) (runningSum / (double) (hi - lo));
+        flattened[(size_t) i] = juce::jmax(0.0f, envelope[(size_t) i] - mean);
+    }
+
+    return flattened;
+}
+
+// Beat period in hops from the envelope's autocorrelation, weighted towards ~120 BPM
+// and rewarding lags whose double is also strong. Returns 0 if the track is too short.
+double BeatDetector::estimatePeriod(const std::vector<float>& envelope, double framesPerSecond)
+{
+    const int minLag = juce::jmax(1, (int) std::floor(framesPerSecond * 60.0 / 200.0));
+    const int maxLag = (int) std::ceil(framesPerSecond * 60.0 / 60.0);
+    const int n = (int) envelope.size();
+
+    if (n < maxLag * 8)
+        return 0.0;
+
+    std::vector<double> ac((size_t) (2 * maxLag + 2), 0.0);
+    for (int lag = minLag; lag <= 2 * maxLag + 1; ++lag)
+    {
+        double sum = 0.0;
+        for (int i = 0; i + lag < n; ++i)
+            sum += (double) envelope[(size_t) i] * (double) envelope[(size_t) (i + lag)];
+
+        ac[(size_t) lag] = sum / (double) (n - lag);
+    }
+
+    auto score = [&](int lag)
+    {
+        auto bpm = 60.0 * framesPerSecond / lag;
+        auto octaves = std::log2(bpm / 120.0) / 0.9;
+        return std::exp(-0.5 * octaves * octaves) * (ac[(size_t) lag] + 0.5 * ac[(size_t) (2 * lag)]);
+    };
+
+    int best = minLag;
+    for (int lag = minLag + 1; lag <= maxLag; ++lag)
+        if (score(lag) > score(best))
+            best = lag;
+
+    if (ac[(size_t) best] <= 0.0)
+        return 0.0;
+
+    // parabolic interpolation between neighbouring lags
+    if (best > minLag && best < maxLag)
+    {
+        auto a = score(best - 1), b = score(best), c = score(best + 1);
+        auto denom = a - 2.0 * b + c;
+        if (denom < 0.0)
+            return best + 0.5 * (a - c) / denom;
+    }
+
+    return best;
+}
+
+double BeatDetector::combScore(const std::vector<float>& envelope, double period, double phase)
+{
+    double sum = 0.0;
+    int count = 0;
+
+    for (double pos = phase; pos < (double) envelope.size() - 1.0; pos += period)
+    {
+        auto i = (size_t) pos;
+        auto frac = (float) (pos - (double) i);
+        sum += envelope[i] + (envelope[i + 1] - envelope[i]) * frac;
+        ++count;
+    }
+
+    return count > 0 ? sum / count : 0.0;
+}
+
+bool BeatDetector::analyse(juce::AudioFormatReader& reader, BeatGrid& grid, std::function<bool()> shouldStop)
+{
+    if (reader.sampleRate <= 0.0)
+        return false;
+
+    auto envelope = computeOnsetEnvelope(reader, shouldStop);
+    if (envelope.empty())
+        return false;
+
+    const double framesPerSecond = reader.sampleRate / hopSize;
+    auto period = estimatePeriod(envelope, framesPerSecond);
+    if (period <= 0.0)
+        return false;
+
+    auto bpm = 60.0 * framesPerSecond / period;
+    while (bpm < kMinBpm) bpm *= 2.0;
+    while (bpm >= kMaxBpm) bpm /= 2.0;
+    period = 60.0 * framesPerSecond / bpm;
+
+    // refine tempo and phase together with a comb over the whole envelope
+    auto searchPhase = [&](double p, double& bestPhase)
+    {
+        double best = -1.0;
+        for (double phase = 0.0; phase < p; phase += 0.5)
+        {
+            auto s = combScore(envelope, p, phase);
+            if (s > best)
+            {
+                best = s;
+                bestPhase = phase;
+            }
+        }
+        return best;
+    };
+
+    double bestScore = -1.0, bestPeriod = period, bestPhase = 0.0;
+    for (double p = period * 0.98; p <= period * 1.02; p += 0.01)
+    {
+        if (shouldStop != nullptr && shouldStop())
+            return false;
+
+        double phase = 0.0;
+        auto s = searchPhase(p, phase);
+        if (s > bestScore)
+        {
+            bestScore = s;
+            bestPeriod = p;
+            bestPhase = phase;
+        }
+    }
+
+    bpm = 60.0 * framesPerSecond / bestPeriod;
+
+    // most dance music is produced at whole BPMs; take it when we're that close
+    if (std::abs(bpm - std::round(bpm)) < 0.05)
+    {
+        bpm = std::round(bpm);
+        bestPeriod = 60.0 * framesPerSecond / bpm;
+        searchPhase(bestPeriod, bestPhase);
+    }
+
+    grid.bpm = bpm;
+    grid.firstBeatSeconds = (bestPhase + 0.5) * hopSize / reader.sampleRate; // onset lies inside its hop
+
+    if (grid.firstBeatSeconds >= grid.getBeatLength())
+        grid.firstBeatSeconds -= grid.getBeatLength();
+
+    return true;
+}
+
+//==============================================================================
+JUCE_IMPLEMENT_SINGLETON(BeatGridCache)
+
+BeatGridCache::BeatGridCache()
+    : AnalysisCache("beatgrid", "Beat grid",
+                    [](juce::AudioFormatReader& reader, BeatGrid& grid, const JobScheduler::Context& context)
+                    {
+                        return BeatDetector::analyse(reader, grid, [&context] { return context.shouldStop(); });
+                    })
+{
+}
+
+BeatGridCache::~BeatGridCache()
+{
+    clearSingletonInstance();
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AnalysisCache.h"
+#include <functional>
+
+// Constant-tempo beat grid for one track: beats fall at firstBeat + n * 60 / bpm.
+struct BeatGrid
+{
+    double bpm = 0.0;
+    double firstBeatSeconds = 0.0;
+
+    bool isValid() const { return bpm > 0.0; }
+    double getBeatLength() const { return 60.0 / bpm; }
+
+    // 0..1 position inside the current beat
+    double getBeatPhase(double seconds) const;
+
+    // nearest beat to the given time
+    double snap(double seconds) const;
+
+    juce::String toString() const;
+    static bool fromString(const juce::String& text, BeatGrid& grid);
+};
+
+// Tempo and downbeat-phase estimation from an onset envelope. The per-sample work
+// (mixdown, first difference, squaring) uses JUCE's SIMD FloatVectorOperations; the
+// envelope is then autocorrelated for the tempo and comb-filtered for the phase.
+class BeatDetector
+{
+public:
+    static constexpr int hopSize = 512;
+
+    // Analyses the whole reader; returns false if no tempo was found or shouldStop() asked it to bail out.
+    static bool analyse(juce::AudioFormatReader& reader, BeatGrid& grid, std::function<bool()> shouldStop);
+
+private:
+    static std::vector<float> computeOnsetEnvelope(juce::AudioFormatReader& reader, const std::function<bool()>& shouldStop);
+    static double estimatePeriod(const std::vector<float>& envelope, double framesPerSecond);
+    static double combScore(const std::vector<float>& envelope, double period, double phase);
+};
+
+// Process-wide beat grid analysis (see AnalysisCache); tracks with no detectable tempo get
+// no grid and their callbacks never run.
+class BeatGridCache : public AnalysisCache<BeatGrid>,
+                      public juce::DeletedAtShutdown
+{
+public:
+    BeatGridCache();
+    ~BeatGridCache() override;
+
+    JUCE_DECLARE_SINGLETON(BeatGridCache, false)
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BeatGridCache)
+};
@@ -0,0 +1,151 @@
+#include "CodecRegistry.h"
+
+juce::String fileCacheKey(const juce::File& file)
+{
+    return juce::String::toHexString(file.getFullPathName().hashCode64())
+         + "_" + juce::String(file.getSize())
+         + "_" + juce::String(file.getLastModificationTime().toMilliseconds());
+}
+
+//==============================================================================
+// Hands reads straight to a decoder from the pool, and gives it back when deleted.
+class CodecRegistry::PooledReader : public juce::AudioFormatReader
+{
+public:
+    PooledReader(std::shared_ptr<Pool> owningPool, const juce::String& poolKey,
+                 std::unique_ptr<juce::AudioFormatReader> readerToWrap)
+        : juce::AudioFormatReader(nullptr, readerToWrap->getFormatName()),
+          pool(std::move(owningPool)),
+          key(poolKey),
+          inner(std::move(readerToWrap))
+    {
+        sampleRate = inner->sampleRate;
+        bitsPerSample = inner->bitsPerSample;
+        lengthInSamples = inner->lengthInSamples;
+        numChannels = inner->numChannels;
+        usesFloatingPointData = inner->usesFloatingPointData;
+        metadataValues = inner->metadataValues;
+    }
+
+    ~PooledReader() override
+    {
+        pool->give(key, std::move(inner));
+    }
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override
+    {
+        return inner->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+    }
+
+    juce::AudioChannelSet getChannelLayout() override
+    {
+        return inner->getChannelLayout();
+    }
+
+private:
+    std::shared_ptr<Pool> pool;
+    const juce::String key;
+    std::unique_ptr<juce::AudioFormatReader> inner;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PooledReader)
+};
+
+//==============================================================================
+std::unique_ptr<juce::AudioFormatReader> CodecRegistry::Pool::take(const juce::String& key)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (auto it = idle.begin(); it != idle.end(); ++it)
+    {
+        if (it->key == key)
+        {
+            auto reader = std::move(it->reader);
+            idle.erase(it);
+            return reader;
+        }
+    }
+
+    return {};
+}
+
+void CodecRegistry::Pool::give(const juce::String& key, std::unique_ptr<juce::AudioFormatReader> reader)
+{
+    std::list<Entry> closed;
+
+    {
+        const juce::ScopedLock sl(lock);
+        idle.push_front({ key, std::move(reader) });
+        trim(closed);
+    }
+
+    // decoders are closed outside the lock: that can touch the disk
+}
+
+void CodecRegistry::Pool::trim(std::list<Entry>& closed)
+{
+    while ((int) idle.size() > limit)
+        closed.splice(closed.end(), idle, std::prev(idle.end()));
+}
+
+//==============================================================================
+JUCE_IMPLEMENT_SINGLETON(CodecRegistry)
+
+CodecRegistry::CodecRegistry()
+{
+    formats.registerBasicFormats();
+}
+
+CodecRegistry::~CodecRegistry()
+{
+    clearPool();
+    clearSingletonInstance();
+}
+
+juce::AudioFormat* CodecRegistry::findFormatFor(const juce::File& file) const
+{
+    return formats.findFormatForFileExtension(file.getFileExtension());
+}
+
+std::unique_ptr<juce::AudioFormatReader> CodecRegistry::createReaderFor(const juce::File& file)
+{
+    const auto key = fileCacheKey(file);
+    auto reader = pool->take(key);
+
+    if (reader == nullptr)
+        reader.reset(formats.createReaderFor(file));
+
+    if (reader == nullptr)
+        return {};
+
+    return std::make_unique<PooledReader>(pool, key, std::move(reader));
+}
+
+void CodecRegistry::setPoolLimit(int maxIdleReaders)
+{
+    std::list<Pool::Entry> closed;
+
+    const juce::ScopedLock sl(pool->lock);
+    pool->limit = juce::jmax(0, maxIdleReaders);
+    pool->trim(closed);
+}
+
+int CodecRegistry::getPoolLimit() const
+{
+    const juce::ScopedLock sl(pool->lock);
+    return pool->limit;
+}
+
+int CodecRegistry::getNumPooledReaders() const
+{
+    const juce::ScopedLock sl(pool->lock);
+    return (int) pool->idle.size();
+}
+
+void CodecRegistry::clearPool()
+{
+    std::list<Pool::Entry> closed;
+
+    const juce::ScopedLock sl(pool->lock);
+    closed.swap(pool->idle);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <JuceHeader.h>
+#include <list>
+#include <memory>
+
+// Names a file's current contents for caches: a changed file gets a new key, so nothing
+// worked out from its old contents is reused.
+juce::String fileCacheKey(const juce::File& file);
+
+// The one set of codecs for the whole process: decks, caches and background jobs all open
+// files through here instead of each registering its own AudioFormatManager. Readers it
+// hands out go back to a small pool when they are deleted, so the next job on the same
+// file (hot cues, scrubbing, waveform segments, analysis) skips opening and parsing it
+// again. Safe to use from any thread.
+class CodecRegistry : public juce::DeletedAtShutdown
+{
+public:
+    CodecRegistry();
+    ~CodecRegistry() override;
+
+    // the codec for this file's extension, or nullptr
+    juce::AudioFormat* findFormatFor(const juce::File& file) const;
+
+    // A reader for the file, reusing an idle decoder for it if the pool has one; nullptr
+    // if it can't be read. Deleting the reader returns its decoder to the pool.
+    std::unique_ptr<juce::AudioFormatReader> createReaderFor(const juce::File& file);
+
+    // idle decoders kept for reuse; the least recently returned are closed first
+    void setPoolLimit(int maxIdleReaders);
+    int getPoolLimit() const;
+    int getNumPooledReaders() const;
+
+    // drops every idle decoder
+    void clearPool();
+
+    JUCE_DECLARE_SINGLETON(CodecRegistry, false)
+
+private:
+    class PooledReader;
+
+    // shared with the readers handed out, so one can outlive the registry at shutdown
+    struct Pool
+    {
+        struct Entry
+        {
+            juce::String key;
+            std::unique_ptr<juce::AudioFormatReader> reader;
+        };
+
+        std::unique_ptr<juce::AudioFormatReader> take(const juce::String& key);
+        void give(const juce::String& key, std::unique_ptr<juce::AudioFormatReader> reader);
+        void trim(std::list<Entry>& closed); // with the lock held; closed keeps what it drops
+
+        juce::CriticalSection lock;
+        std::list<Entry> idle; // front = most recently returned
+        int limit = 8;
+    };
+
+    juce::AudioFormatManager formats;
+    std::shared_ptr<Pool> pool = std::make_shared<Pool>();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CodecRegistry)
+};
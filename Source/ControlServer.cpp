@@ -0,0 +1,617 @@
+#include "ControlServer.h"
+#include "AppLog.h"
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <sys/un.h>
+ #include <poll.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <cerrno>
+ #include <cstring>
+ #define SIMPLEAUDIOPLAYER_CONTROL_SOCKET 1
+#else
+ #define SIMPLEAUDIOPLAYER_CONTROL_SOCKET 0
+#endif
+
+namespace
+{
+   #if SIMPLEAUDIOPLAYER_CONTROL_SOCKET
+    // a client that hangs up mustn't take the whole process down with SIGPIPE
+   #ifdef MSG_NOSIGNAL
+    constexpr int sendFlags = MSG_NOSIGNAL;
+   #else
+    constexpr int sendFlags = 0;
+   #endif
+
+    void setNonBlocking(int fd)
+    {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    bool wouldBlock()
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+   #endif
+
+    bool isNumber(const juce::var& v)
+    {
+        return v.isInt() || v.isInt64() || v.isDouble();
+    }
+
+    juce::var makeReply(const juce::var& id, const juce::String& error = {})
+    {
+        auto* reply = new juce::DynamicObject();
+        if (!id.isVoid())
+            reply->setProperty("id", id);
+
+        reply->setProperty("ok", error.isEmpty());
+        if (error.isNotEmpty())
+            reply->setProperty("error", error);
+
+        return juce::var(reply);
+    }
+}
+
+ControlServer::ControlServer(PlayerAudio& deckA, PlayerAudio& deckB, std::atomic<float>& crossfaderValue)
+    : juce::Thread("Control server"),
+      decks{ &deckA, &deckB },
+      crossfader(crossfaderValue),
+      socketFile(getSocketFile())
+{
+    latestState = makeState();
+    startTimerHz(20);
+    startThread(juce::Thread::Priority::low);
+}
+
+ControlServer::~ControlServer()
+{
+    stopThread(2000);
+    stopTimer();
+    cancelPendingUpdate();
+}
+
+juce::File ControlServer::getSocketFile()
+{
+    auto path = juce::SystemStats::getEnvironmentVariable("SIMPLEAUDIOPLAYER_SOCKET", {});
+    if (juce::File::isAbsolutePath(path))
+        return juce::File(path);
+
+    // the runtime directory is private to the user; the temp directory may not be
+    auto runtimeDir = juce::SystemStats::getEnvironmentVariable("XDG_RUNTIME_DIR", {});
+    if (juce::File::isAbsolutePath(runtimeDir))
+        return juce::File(runtimeDir).getChildFile("SimpleAudioPlayer.sock");
+
+    return juce::File::getSpecialLocation(juce::File::tempDirectory)
+        .getChildFile("SimpleAudioPlayer-" + juce::SystemStats::getLogonName() + ".sock");
+}
+
+void ControlServer::run()
+{
+   #if SIMPLEAUDIOPLAYER_CONTROL_SOCKET
+    if (!openSocket())
+        return;
+
+    std::vector<pollfd> fds;
+
+    while (!threadShouldExit())
+    {
+        fds.clear();
+        fds.push_back({ listenFd, POLLIN, 0 });
+
+        for (auto& client : clients)
+            fds.push_back({ client.fd, (short) (client.output.empty() ? POLLIN : (POLLIN | POLLOUT)), 0 });
+
+        // the timeout bounds how late a state update or the exit check can be
+        const int ready = ::poll(fds.data(), (nfds_t) fds.size(), 20);
+
+        if (ready < 0 && errno != EINTR)
+        {
+            APP_LOG(control, error, "Control socket poll failed: {}", juce::String(std::strerror(errno)));
+            break;
+        }
+
+        if (ready > 0)
+        {
+            for (size_t i = 0; i < clients.size(); ++i)
+            {
+                const auto events = fds[i + 1].revents;
+
+                if ((events & (POLLIN | POLLHUP | POLLERR)) != 0)
+                    readFrom(clients[i]);
+
+                if ((events & POLLOUT) != 0)
+                    writeTo(clients[i]);
+            }
+
+            if ((fds[0].revents & POLLIN) != 0)
+                acceptClient();
+        }
+
+        const double now = juce::Time::getMillisecondCounterHiRes();
+        juce::var state;
+
+        for (auto& client : clients)
+        {
+            if (client.stateIntervalMs <= 0.0 || now < client.nextStateMs)
+                continue;
+
+            if (state.isVoid())
+            {
+                auto* event = new juce::DynamicObject();
+                event->setProperty("event", "state");
+
+                const juce::ScopedLock sl(stateLock);
+                event->setProperty("state", latestState);
+                state = juce::var(event);
+            }
+
+            client.nextStateMs = juce::jmax(client.nextStateMs + client.stateIntervalMs, now);
+            send(client, state);
+        }
+
+        for (auto& client : clients)
+            if (client.closed)
+                ::close(client.fd);
+
+        clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client& c) { return c.closed; }),
+                      clients.end());
+    }
+
+    for (auto& client : clients)
+        ::close(client.fd);
+
+    clients.clear();
+    closeSocket();
+   #else
+    APP_LOG(control, warning, "The control socket isn't available on this platform");
+   #endif
+}
+
+bool ControlServer::openSocket()
+{
+   #if SIMPLEAUDIOPLAYER_CONTROL_SOCKET
+    const auto path = socketFile.getFullPathName();
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if ((size_t) path.getNumBytesAsUTF8() >= sizeof(address.sun_path))
+    {
+        APP_LOG(control, error, "Control socket path is too long: {}", path);
+        return false;
+    }
+
+    std::memcpy(address.sun_path, path.toRawUTF8(), path.getNumBytesAsUTF8() + 1);
+
+    // a socket file left behind by a crash is replaced; one that answers belongs to
+    // another instance, which keeps it
+    if (socketFile.exists())
+    {
+        const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        const bool inUse = probe >= 0 && ::connect(probe, (const sockaddr*) &address, sizeof(address)) == 0;
+
+        if (probe >= 0)
+            ::close(probe);
+
+        if (inUse)
+        {
+            APP_LOG(control, warning, "{} is in use by another instance; the control API is off", path);
+            return false;
+        }
+
+        ::unlink(path.toRawUTF8());
+    }
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listenFd < 0
+        || ::bind(listenFd, (const sockaddr*) &address, sizeof(address)) != 0
+        || ::listen(listenFd, 8) != 0)
+    {
+        APP_LOG(control, error, "Couldn't listen on {}: {}", path, juce::String(std::strerror(errno)));
+
+        if (listenFd >= 0)
+            ::close(listenFd);
+
+        listenFd = -1;
+        return false;
+    }
+
+    // the API can load any file the user can read: keep it to the user
+    ::chmod(path.toRawUTF8(), S_IRUSR | S_IWUSR);
+    setNonBlocking(listenFd);
+
+    listening = true;
+    APP_LOG(control, info, "Control API listening on {}", path);
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+void ControlServer::closeSocket()
+{
+   #if SIMPLEAUDIOPLAYER_CONTROL_SOCKET
+    if (listenFd >= 0)
+    {
+        ::close(listenFd);
+        ::unlink(socketFile.getFullPathName().toRawUTF8());
+        listenFd = -1;
+    }
+   #endif
+
+    listening = false;
+}
+
+void ControlServer::acceptClient()
+{
+   #if SIMPLEAUDIOPLAYER_CONTROL_SOCKET
+    const int fd = ::accept(listenFd, nullptr, nullptr);
+    if (fd < 0)
+        return;
+
+    if ((int) clients.size() >= maxClients)
+    {
+        APP_LOG(control, warning, "Refused a control client: {} already connected", maxClients);
+        ::close(fd);
+        return;
+    }
+
+    setNonBlocking(fd);
+
+   #ifdef SO_NOSIGPIPE
+    int noSigPipe = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+   #endif
+
+    Client client;
+    client.fd = fd;
+    clients.push_back(std::move(client));
+
+    APP_LOG(control, debug, "Control client connected ({} now)", (int) clients.size());
+   #endif
+}
+
+void ControlServer::readFrom(Client& client)
+{
+   #if SIMPLEAUDIOPLAYER_CONTROL_SOCKET
+    char buffer[4096];
+
+    for (;;)
+    {
+        const auto numRead = ::recv(client.fd, buffer, sizeof(buffer), 0);
+
+        if (numRead > 0)
+        {
+            client.input.append(buffer, (size_t) numRead);
+            continue;
+        }
+
+        // the lines already received are still answered before it's closed
+        if (numRead == 0 || !wouldBlock())
+            client.closed = true;
+
+        break;
+    }
+
+    size_t start = 0;
+
+    for (auto end = client.input.find('\n'); end != std::string::npos; end = client.input.find('\n', start))
+    {
+        handleLine(client, juce::String::fromUTF8(client.input.data() + start, (int) (end - start)).trim());
+        start = end + 1;
+    }
+
+    client.input.erase(0, start);
+
+    if (client.input.size() > maxLineBytes)
+    {
+        send(client, makeReply({}, "line too long"));
+        client.closed = true;
+    }
+   #else
+    client.closed = true;
+   #endif
+}
+
+void ControlServer::writeTo(Client& client)
+{
+   #if SIMPLEAUDIOPLAYER_CONTROL_SOCKET
+    while (!client.output.empty())
+    {
+        const auto numWritten = ::send(client.fd, client.output.data(), client.output.size(), sendFlags);
+
+        if (numWritten > 0)
+        {
+            client.output.erase(0, (size_t) numWritten);
+            continue;
+        }
+
+        if (numWritten < 0 && wouldBlock())
+            break;
+
+        client.closed = true;
+        break;
+    }
+   #else
+    client.closed = true;
+   #endif
+}
+
+void ControlServer::send(Client& client, const juce::var& message)
+{
+    client.output += juce::JSON::toString(message, true).toStdString();
+    client.output += '\n';
+
+    if (client.output.size() > maxPendingOutput)
+    {
+        APP_LOG(control, warning, "Dropped a control client that stopped reading");
+        client.closed = true;
+        return;
+    }
+
+    writeTo(client);
+}
+
+void ControlServer::handleLine(Client& client, const juce::String& line)
+{
+    if (line.isEmpty())
+        return;
+
+    juce::var parsed;
+    const auto result = juce::JSON::parse(line, parsed);
+
+    if (result.failed())
+    {
+        send(client, makeReply({}, "invalid JSON: " + result.getErrorMessage()));
+        return;
+    }
+
+    Batch batch;
+
+    if (auto* commands = parsed.getArray())
+    {
+        juce::Array<juce::var> replies;
+        for (auto& command : *commands)
+            replies.add(handleCommand(client, command, batch));
+
+        apply(batch);
+        send(client, replies);
+    }
+    else
+    {
+        auto reply = handleCommand(client, parsed, batch);
+        apply(batch);
+        send(client, reply);
+    }
+}
+
+// Server thread: checks one command and adds what it does to the batch.
+juce::var ControlServer::handleCommand(Client& client, const juce::var& command, Batch& batch)
+{
+    using Action = PlayerAudio::ControlAction;
+
+    const auto id = command["id"];
+
+    if (!command.isObject())
+        return makeReply(id, "expected a command object");
+
+    const auto cmd = command["cmd"].toString();
+
+    if (cmd == "state")
+    {
+        auto reply = makeReply(id);
+        const juce::ScopedLock sl(stateLock);
+        reply.getDynamicObject()->setProperty("state", latestState);
+        return reply;
+    }
+
+    if (cmd == "subscribe")
+    {
+        const double interval = isNumber(command["interval"]) ? (double) command["interval"] : 100.0;
+        client.stateIntervalMs = juce::jlimit(50.0, 10000.0, interval);
+        client.nextStateMs = 0.0;
+        return makeReply(id);
+    }
+
+    if (cmd == "unsubscribe")
+    {
+        client.stateIntervalMs = 0.0;
+        return makeReply(id);
+    }
+
+    if (cmd == "crossfade")
+    {
+        if (!isNumber(command["value"]))
+            return makeReply(id, "crossfade needs a value from 0 (deck A) to 1 (deck B)");
+
+        batch.crossfade = (float) juce::jlimit(0.0, 1.0, (double) command["value"]);
+        return makeReply(id);
+    }
+
+    const int deck = parseDeck(command["deck"]);
+
+    if (cmd != "load" && cmd != "play" && cmd != "pause" && cmd != "stop" && cmd != "seek"
+        && cmd != "loop" && cmd != "gain" && cmd != "speed")
+        return makeReply(id, "unknown command: " + cmd);
+
+    if (deck < 0)
+        return makeReply(id, "deck must be 0, 1, \"A\" or \"B\"");
+
+    auto& events = batch.deckEvents[(size_t) deck];
+
+    if (cmd == "load")
+    {
+        const auto path = command["path"].toString();
+        if (!juce::File::isAbsolutePath(path))
+            return makeReply(id, "load needs an absolute path");
+
+        const juce::File file(path);
+        if (!file.existsAsFile())
+            return makeReply(id, "no such file: " + path);
+
+        batch.messageThreadWork.push_back([this, deck, file] { if (onLoad != nullptr) onLoad(deck, file); });
+    }
+    else if (cmd == "play")
+    {
+        events.push_back({ Action::play });
+    }
+    else if (cmd == "pause")
+    {
+        events.push_back({ Action::pause });
+    }
+    else if (cmd == "stop")
+    {
+        events.push_back({ Action::stop });
+    }
+    else if (cmd == "seek")
+    {
+        if (!isNumber(command["position"]))
+            return makeReply(id, "seek needs a position in seconds");
+
+        events.push_back({ Action::seek, 0.0f, (double) command["position"] });
+    }
+    else if (cmd == "loop")
+    {
+        const auto start = command["start"], end = command["end"], enabled = command["enabled"];
+        if (!isNumber(start) && !isNumber(end) && !enabled.isBool())
+            return makeReply(id, "loop needs a start, end (seconds) and/or enabled");
+
+        if (isNumber(start))
+            events.push_back({ Action::loopIn, 0.0f, (double) start });
+
+        if (isNumber(end))
+            events.push_back({ Action::loopOut, 0.0f, (double) end });
+
+        if (enabled.isBool())
+            events.push_back({ Action::loopEnabled, (bool) enabled ? 1.0f : 0.0f });
+    }
+    else if (cmd == "gain")
+    {
+        if (!isNumber(command["value"]))
+            return makeReply(id, "gain needs a value from 0 to 1");
+
+        events.push_back({ Action::gain, (float) juce::jlimit(0.0, 1.0, (double) command["value"]) });
+    }
+    else if (cmd == "speed")
+    {
+        if (!isNumber(command["value"]))
+            return makeReply(id, "speed needs a value from 0.5 to 2");
+
+        const double speed = juce::jlimit(0.5, 2.0, (double) command["value"]);
+        batch.messageThreadWork.push_back([this, deck, speed] { if (onSpeed != nullptr) onSpeed(deck, speed); });
+    }
+
+    return makeReply(id);
+}
+
+void ControlServer::apply(Batch& batch)
+{
+    auto queue = [this, deckEvents = std::move(batch.deckEvents), crossfade = batch.crossfade]
+    {
+        if (crossfade >= 0.0f)
+            crossfader = crossfade;
+
+        for (int deck = 0; deck < numDecks; ++deck)
+        {
+            auto& events = deckEvents[(size_t) deck];
+
+            if (!events.empty() && !decks[(size_t) deck]->pushControls(events.data(), (int) events.size()))
+                APP_LOG(control, warning, "Deck {} control queue is full: dropped {} commands", deck, (int) events.size());
+        }
+    };
+
+    if (batch.messageThreadWork.empty())
+    {
+        queue();
+        return;
+    }
+
+    callOnMessageThread([work = std::move(batch.messageThreadWork), queue]
+    {
+        for (auto& fn : work)
+            fn();
+
+        queue();
+    });
+}
+
+void ControlServer::callOnMessageThread(std::function<void()> fn)
+{
+    {
+        const juce::ScopedLock sl(pendingLock);
+        pending.push_back(std::move(fn));
+    }
+
+    triggerAsyncUpdate();
+}
+
+void ControlServer::handleAsyncUpdate()
+{
+    std::vector<std::function<void()>> work;
+    {
+        const juce::ScopedLock sl(pendingLock);
+        work.swap(pending);
+    }
+
+    for (auto& fn : work)
+        fn();
+}
+
+void ControlServer::timerCallback()
+{
+    auto state = makeState();
+
+    const juce::ScopedLock sl(stateLock);
+    latestState = state;
+}
+
+int ControlServer::parseDeck(const juce::var& deck)
+{
+    if (isNumber(deck))
+    {
+        const int index = (int) deck;
+        return index >= 0 && index < numDecks ? index : -1;
+    }
+
+    const auto name = deck.toString().trim().toUpperCase();
+    if (name.length() == 1 && name[0] >= 'A' && name[0] < 'A' + numDecks)
+        return (int) (name[0] - 'A');
+
+    return -1;
+}
+
+// Message thread: what subscribers and the state command see.
+juce::var ControlServer::makeState() const
+{
+    juce::Array<juce::var> deckStates;
+
+    for (int deck = 0; deck < numDecks; ++deck)
+    {
+        auto& player = *decks[(size_t) deck];
+
+        auto* loop = new juce::DynamicObject();
+        loop->setProperty("enabled", player.isLoopABEnable());
+        loop->setProperty("start", player.getPointA());
+        loop->setProperty("end", player.getPointB());
+
+        auto* state = new juce::DynamicObject();
+        state->setProperty("deck", juce::String::charToString((juce::juce_wchar) ('A' + deck)));
+        state->setProperty("file", player.isFileLoaded() ? player.getLoadedFile().getFullPathName() : juce::String());
+        state->setProperty("playing", player.isPlaying());
+        state->setProperty("position", player.getDisplayPosition());
+        state->setProperty("length", player.getLengthInSecond());
+        state->setProperty("gain", player.getGain());
+        state->setProperty("speed", player.getResamplingRatio());
+        state->setProperty("loop", juce::var(loop));
+        deckStates.add(juce::var(state));
+    }
+
+    auto* state = new juce::DynamicObject();
+    state->setProperty("decks", deckStates);
+    state->setProperty("crossfader", crossfader.load());
+    return juce::var(state);
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlayerAudio.h"
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Local automation API: newline-delimited JSON over a Unix domain socket (see
+// getSocketFile()). Each line is one command object, or an array of them applied as a
+// batch, and gets one reply line back:
+//
+//   {"id": 1, "cmd": "load", "deck": "A", "path": "/music/track.wav"}
+//   [{"cmd": "seek", "deck": 0, "position": 32.5}, {"cmd": "play", "deck": 0}]
+//   {"cmd": "subscribe", "interval": 100}
+//
+// Commands: load, play, pause, stop, seek, loop (start/end/enabled), gain, speed,
+// crossfade, state, subscribe, unsubscribe. Transport, loop and gain commands go through
+// the decks' lock-free control queues, so they take effect in the next audio block
+// without the message thread; a batch's commands for one deck land in the same block.
+// load and speed run on the message thread (through the GUI, so it stays in step); in a
+// batch that has either, the rest is queued from there once they are done. Subscribers
+// get a {"event": "state", ...} line every interval.
+class ControlServer : private juce::Thread,
+                      private juce::Timer,
+                      private juce::AsyncUpdater
+{
+public:
+    static constexpr int numDecks = 2;
+
+    ControlServer(PlayerAudio& deckA, PlayerAudio& deckB, std::atomic<float>& crossfaderValue);
+    ~ControlServer() override;
+
+    // $SIMPLEAUDIOPLAYER_SOCKET if set, else in $XDG_RUNTIME_DIR or the temp directory
+    static juce::File getSocketFile();
+
+    bool isListening() const { return listening.load(); }
+
+    // message thread
+    std::function<void(int deck, const juce::File& file)> onLoad;
+    std::function<void(int deck, double speed)> onSpeed;
+
+private:
+    struct Client
+    {
+        int fd = -1;
+        std::string input, output;
+        double stateIntervalMs = 0.0; // 0 unless subscribed
+        double nextStateMs = 0.0;
+        bool closed = false;
+    };
+
+    // what a line asks for, sorted by the thread that has to do it
+    struct Batch
+    {
+        std::array<std::vector<PlayerAudio::ControlEvent>, numDecks> deckEvents;
+        std::vector<std::function<void()>> messageThreadWork;
+        float crossfade = -1.0f;
+    };
+
+    static constexpr int maxClients = 16;
+    static constexpr size_t maxLineBytes = 64 * 1024;
+    static constexpr size_t maxPendingOutput = 1024 * 1024; // a subscriber this far behind is dropped
+
+    void run() override;
+    void timerCallback() override;
+    void handleAsyncUpdate() override;
+
+    bool openSocket();
+    void closeSocket();
+    void acceptClient();
+    void readFrom(Client& client);
+    void writeTo(Client& client);
+    void send(Client& client, const juce::var& message);
+
+    void handleLine(Client& client, const juce::String& line);
+    juce::var handleCommand(Client& client, const juce::var& command, Batch& batch);
+    void apply(Batch& batch);
+    void callOnMessageThread(std::function<void()> fn);
+
+    static int parseDeck(const juce::var& deck);
+    juce::var makeState() const;
+
+    std::array<PlayerAudio*, numDecks> decks;
+    std::atomic<float>& crossfader;
+
+    juce::File socketFile;
+    int listenFd = -1;
+    std::vector<Client> clients; // server thread only
+    std::atomic<bool> listening{ false };
+
+    // both decks as of the message thread's last look; replaced whole, never modified
+    juce::CriticalSection stateLock;
+    juce::var latestState;
+
+    juce::CriticalSection pendingLock;
+    std::vector<std::function<void()>> pending;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ControlServer)
+};
@@ -0,0 +1,279 @@
+#include "DeckEq.h"
+
+#if JUCE_INTEL && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+ #include <emmintrin.h>
+ #define SAP_EQ_SSE2 1
+#elif JUCE_ARM && defined(__ARM_NEON) && (defined(__GNUC__) || defined(__clang__))
+ #include <arm_neon.h>
+ #define SAP_EQ_NEON 1
+#endif
+
+namespace
+{
+    // four floats, one channel per lane; gather() builds one from sample i of four channels
+    // in registers, since four scalar stores and a vector load would stall on store forwarding
+   #if SAP_EQ_SSE2
+    using Vec = __m128;
+    inline Vec splat(float v)                  { return _mm_set1_ps(v); }
+    inline Vec gather(float* const* x, int i)  { return _mm_setr_ps(x[0][i], x[1][i], x[2][i], x[3][i]); }
+    inline Vec load(const float* p)            { return _mm_load_ps(p); }
+    inline void store(float* p, Vec v)         { _mm_store_ps(p, v); }
+    inline Vec add(Vec a, Vec b)               { return _mm_add_ps(a, b); }
+    inline Vec sub(Vec a, Vec b)               { return _mm_sub_ps(a, b); }
+    inline Vec mul(Vec a, Vec b)               { return _mm_mul_ps(a, b); }
+   #elif SAP_EQ_NEON
+    using Vec = float32x4_t;
+    inline Vec splat(float v)                  { return vdupq_n_f32(v); }
+    inline Vec gather(float* const* x, int i)
+    {
+        Vec v = vdupq_n_f32(x[0][i]);
+        v = vsetq_lane_f32(x[1][i], v, 1);
+        v = vsetq_lane_f32(x[2][i], v, 2);
+        return vsetq_lane_f32(x[3][i], v, 3);
+    }
+    inline Vec load(const float* p)            { return vld1q_f32(p); }
+    inline void store(float* p, Vec v)         { vst1q_f32(p, v); }
+    inline Vec add(Vec a, Vec b)               { return vaddq_f32(a, b); }
+    inline Vec sub(Vec a, Vec b)               { return vsubq_f32(a, b); }
+    inline Vec mul(Vec a, Vec b)               { return vmulq_f32(a, b); }
+   #else
+    struct Vec { float v[4]; };
+    inline Vec splat(float x)                  { return { { x, x, x, x } }; }
+    inline Vec gather(float* const* x, int i)  { return { { x[0][i], x[1][i], x[2][i], x[3][i] } }; }
+    inline Vec load(const float* p)            { return { { p[0], p[1], p[2], p[3] } }; }
+    inline void store(float* p, Vec a)         { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+    inline Vec add(Vec a, Vec b)               { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    inline Vec sub(Vec a, Vec b)               { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    inline Vec mul(Vec a, Vec b)               { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+   #endif
+
+    constexpr double kLowShelfHz = 250.0;
+    constexpr double kMidHz = 1000.0;
+    constexpr double kHighShelfHz = 4000.0;
+    constexpr double kMidQ = 0.7;
+    constexpr double kFilterQ = 0.8; // a touch of resonance, as on a mixer's filter knob
+
+    enum Section { lowShelf = 0, midPeak, highShelf, lowPass, highPass };
+
+    struct Coefficients
+    {
+        double b0, b1, b2, a0, a1, a2;
+    };
+
+    // RBJ audio EQ cookbook
+    Coefficients makeShelf(bool high, double sampleRate, double frequency, double gainDb)
+    {
+        const double A = std::pow(10.0, gainDb / 40.0);
+        const double w0 = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        const double cosw = std::cos(w0);
+        const double alpha = std::sin(w0) / 2.0 * std::sqrt(2.0); // shelf slope S = 1
+        const double twoSqrtAAlpha = 2.0 * std::sqrt(A) * alpha;
+        const double sign = high ? -1.0 : 1.0;
+
+        return { A * ((A + 1) - sign * (A - 1) * cosw + twoSqrtAAlpha),
+                 sign * 2.0 * A * ((A - 1) - sign * (A + 1) * cosw),
+                 A * ((A + 1) - sign * (A - 1) * cosw - twoSqrtAAlpha),
+                 (A + 1) + sign * (A - 1) * cosw + twoSqrtAAlpha,
+                 -sign * 2.0 * ((A - 1) + sign * (A + 1) * cosw),
+                 (A + 1) + sign * (A - 1) * cosw - twoSqrtAAlpha };
+    }
+
+    Coefficients makePeak(double sampleRate, double frequency, double q, double gainDb)
+    {
+        const double A = std::pow(10.0, gainDb / 40.0);
+        const double w0 = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        const double alpha = std::sin(w0) / (2.0 * q);
+        const double cosw = std::cos(w0);
+
+        return { 1.0 + alpha * A, -2.0 * cosw, 1.0 - alpha * A,
+                 1.0 + alpha / A, -2.0 * cosw, 1.0 - alpha / A };
+    }
+
+    Coefficients makePass(bool high, double sampleRate, double frequency, double q)
+    {
+        const double w0 = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        const double alpha = std::sin(w0) / (2.0 * q);
+        const double cosw = std::cos(w0);
+        const double b = high ? (1.0 + cosw) : (1.0 - cosw);
+
+        return { b / 2.0, high ? -b : b, b / 2.0,
+                 1.0 + alpha, -2.0 * cosw, 1.0 - alpha };
+    }
+}
+
+//==============================================================================
+void DeckEq::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    for (int b = 0; b < 3; ++b)
+    {
+        gainDb[b].reset(sampleRate, 0.05);
+        gainDb[b].setCurrentAndTargetValue(targetGainDb[b].load());
+    }
+
+    filter.reset(sampleRate, 0.05);
+    filter.setCurrentAndTargetValue(targetFilter.load());
+
+    updateCoefficients();
+    reset();
+}
+
+void DeckEq::reset()
+{
+    for (int s = 0; s < numSections; ++s)
+    {
+        std::fill(std::begin(z1[s]), std::end(z1[s]), 0.0f);
+        std::fill(std::begin(z2[s]), std::end(z2[s]), 0.0f);
+    }
+}
+
+void DeckEq::setBandGain(Band band, float newGainDb)
+{
+    targetGainDb[band] = juce::jlimit(minGainDb, maxGainDb, newGainDb);
+}
+
+void DeckEq::setFilter(float position)
+{
+    targetFilter = juce::jlimit(-1.0f, 1.0f, position);
+}
+
+void DeckEq::updateCoefficients()
+{
+    Coefficients c[numSections];
+    bool active[numSections];
+
+    c[lowShelf] = makeShelf(false, sampleRate, kLowShelfHz, gainDb[low].getCurrentValue());
+    c[midPeak] = makePeak(sampleRate, kMidHz, kMidQ, gainDb[mid].getCurrentValue());
+    c[highShelf] = makeShelf(true, sampleRate, kHighShelfHz, gainDb[high].getCurrentValue());
+
+    active[lowShelf] = std::abs(gainDb[low].getCurrentValue()) > 0.01f;
+    active[midPeak] = std::abs(gainDb[mid].getCurrentValue()) > 0.01f;
+    active[highShelf] = std::abs(gainDb[high].getCurrentValue()) > 0.01f;
+
+    // exponential sweeps: low-pass 20 kHz -> 100 Hz, high-pass 20 Hz -> 10 kHz
+    const double position = filter.getCurrentValue();
+    const double nyquistLimit = sampleRate * 0.45;
+    const double lowPassHz = juce::jmin(nyquistLimit, 20000.0 * std::pow(100.0 / 20000.0, juce::jmax(0.0, -position)));
+    const double highPassHz = juce::jmin(nyquistLimit, 20.0 * std::pow(10000.0 / 20.0, juce::jmax(0.0, position)));
+
+    c[lowPass] = makePass(false, sampleRate, lowPassHz, kFilterQ);
+    c[highPass] = makePass(true, sampleRate, highPassHz, kFilterQ);
+    active[lowPass] = position < -0.01;
+    active[highPass] = position > 0.01;
+
+    for (int s = 0; s < numSections; ++s)
+    {
+        // a section switching in or out starts from silence rather than a stale state
+        if (active[s] != sections[s].active)
+        {
+            std::fill(std::begin(z1[s]), std::end(z1[s]), 0.0f);
+            std::fill(std::begin(z2[s]), std::end(z2[s]), 0.0f);
+        }
+
+        sections[s].b0 = (float) (c[s].b0 / c[s].a0);
+        sections[s].b1 = (float) (c[s].b1 / c[s].a0);
+        sections[s].b2 = (float) (c[s].b2 / c[s].a0);
+        sections[s].a1 = (float) (c[s].a1 / c[s].a0);
+        sections[s].a2 = (float) (c[s].a2 / c[s].a0);
+        sections[s].active = active[s];
+    }
+}
+
+void DeckEq::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const juce::ScopedNoDenormals noDenormals;
+
+    for (int b = 0; b < 3; ++b)
+        if (gainDb[b].getTargetValue() != targetGainDb[b].load())
+            gainDb[b].setTargetValue(targetGainDb[b].load());
+
+    if (filter.getTargetValue() != targetFilter.load())
+        filter.setTargetValue(targetFilter.load());
+
+    const int numChannels = juce::jmin(buffer.getNumChannels(), maxChannels);
+
+    for (int pos = 0; pos < numSamples;)
+    {
+        int n = numSamples - pos;
+
+        if (gainDb[low].isSmoothing() || gainDb[mid].isSmoothing() || gainDb[high].isSmoothing() || filter.isSmoothing())
+        {
+            n = juce::jmin(n, coefficientInterval);
+
+            for (auto& g : gainDb)
+                g.skip(n);
+            filter.skip(n);
+
+            updateCoefficients();
+        }
+
+        // gather the active sections so the per-sample loop has no branches
+        int active[numSections];
+        int numActive = 0;
+        for (int s = 0; s < numSections; ++s)
+            if (sections[s].active)
+                active[numActive++] = s;
+
+        if (numActive > 0)
+        {
+            Vec b0[numSections], b1[numSections], b2[numSections], a1[numSections], a2[numSections];
+
+            for (int k = 0; k < numActive; ++k)
+            {
+                const auto& c = sections[active[k]];
+                b0[k] = splat(c.b0);
+                b1[k] = splat(c.b1);
+                b2[k] = splat(c.b2);
+                a1[k] = splat(c.a1);
+                a2[k] = splat(c.a2);
+            }
+
+            // channels go through in groups of four, one per lane; unused lanes repeat the
+            // group's first channel and their results are dropped
+            for (int firstChannel = 0; firstChannel < numChannels; firstChannel += lanes)
+            {
+                const int numLanes = juce::jmin(lanes, numChannels - firstChannel);
+                float* x[lanes];
+                for (int l = 0; l < lanes; ++l)
+                    x[l] = buffer.getWritePointer(firstChannel + (l < numLanes ? l : 0), startSample + pos);
+
+                Vec s1[numSections], s2[numSections];
+                for (int k = 0; k < numActive; ++k)
+                {
+                    s1[k] = load(&z1[active[k]][firstChannel]);
+                    s2[k] = load(&z2[active[k]][firstChannel]);
+                }
+
+                alignas(16) float frame[lanes];
+
+                for (int i = 0; i < n; ++i)
+                {
+                    Vec v = gather(x, i);
+
+                    for (int k = 0; k < numActive; ++k)
+                    {
+                        // transposed direct form II
+                        const Vec y = add(mul(b0[k], v), s1[k]);
+                        s1[k] = add(sub(mul(b1[k], v), mul(a1[k], y)), s2[k]);
+                        s2[k] = sub(mul(b2[k], v), mul(a2[k], y));
+                        v = y;
+                    }
+
+                    store(frame, v);
+
+                    for (int l = 0; l < numLanes; ++l)
+                        x[l][i] = frame[l];
+                }
+
+                for (int k = 0; k < numActive; ++k)
+                {
+                    store(&z1[active[k]][firstChannel], s1[k]);
+                    store(&z2[active[k]][firstChannel], s2[k]);
+                }
+            }
+        }
+
+        pos += n;
+    }
+}
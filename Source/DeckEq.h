@@ -0,0 +1,60 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+
+// DJ-style tone control for one deck: low shelf, mid peak and high shelf (-24..+6 dB)
+// followed by a bipolar filter knob (left = low-pass sweep, right = high-pass sweep).
+//
+// Parameters are set from any thread; the audio thread smooths them and refreshes the
+// coefficients every few samples while they move. All five biquads are run as one fused
+// cascade per sample with four channels side by side in one SIMD register (so a stereo
+// deck's L and R go through each section together), and sections at unity are skipped,
+// so a flat EQ costs nothing.
+class DeckEq
+{
+public:
+    enum Band { low = 0, mid, high };
+
+    static constexpr float minGainDb = -24.0f;
+    static constexpr float maxGainDb = 6.0f;
+
+    void prepare(double sampleRate);
+    void reset();
+
+    void setBandGain(Band band, float gainDb);
+    float getBandGain(Band band) const { return targetGainDb[band].load(); }
+
+    // -1..0 sweeps a low-pass down from 20 kHz, 0..1 sweeps a high-pass up from 20 Hz
+    void setFilter(float position);
+    float getFilter() const { return targetFilter.load(); }
+
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+private:
+    static constexpr int numSections = 5;
+    static constexpr int maxChannels = 8;
+    static constexpr int lanes = 4; // channels per SIMD register
+    static constexpr int coefficientInterval = 32; // samples between coefficient updates while smoothing
+
+    struct Biquad
+    {
+        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+        bool active = false;
+    };
+
+    void updateCoefficients();
+
+    double sampleRate = 44100.0;
+
+    std::atomic<float> targetGainDb[3] = { { 0.0f }, { 0.0f }, { 0.0f } };
+    std::atomic<float> targetFilter{ 0.0f };
+
+    juce::SmoothedValue<float> gainDb[3];
+    juce::SmoothedValue<float> filter;
+
+    Biquad sections[numSections];
+    alignas(16) float z1[numSections][maxChannels] = {};
+    alignas(16) float z2[numSections][maxChannels] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckEq)
+};
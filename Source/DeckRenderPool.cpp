@@ -0,0 +1,159 @@
+#include "DeckRenderPool.h"
+#include <thread>
+
+namespace
+{
+    // a worker spins from this long before the next block is due until this long after,
+    // in block periods, then parks
+    constexpr double kSpinWindowBlocks = 0.15;
+
+    void pause(int spin)
+    {
+        if ((spin & 63) == 63)
+            std::this_thread::yield();
+    }
+}
+
+class DeckRenderPool::Worker : public juce::Thread
+{
+public:
+    Worker(DeckRenderPool& ownerPool, int index)
+        : juce::Thread("Deck render " + juce::String(index)), pool(ownerPool)
+    {
+    }
+
+    void run() override
+    {
+        auto seen = pool.generation.load();
+
+        while (!threadShouldExit())
+        {
+            if (waitForBlock(seen))
+                pool.runPendingTasks();
+        }
+    }
+
+    std::atomic<bool> parked{ false };
+
+private:
+    bool waitForBlock(juce::uint32& seen)
+    {
+        const auto period = pool.blockPeriodMs.load(std::memory_order_relaxed);
+        const auto due = pool.lastRenderMs.load(std::memory_order_relaxed) + period;
+        const auto window = kSpinWindowBlocks * period;
+
+        // sleep through most of the gap; a block that comes early wakes us
+        const auto sleepMs = (int) (due - window - juce::Time::getMillisecondCounterHiRes());
+        if (sleepMs > 0 && park(seen, sleepMs))
+            return true;
+
+        for (int spin = 0; juce::Time::getMillisecondCounterHiRes() < due + window; ++spin)
+        {
+            if (hasNewBlock(seen))
+                return true;
+
+            pause(spin);
+        }
+
+        return park(seen, 100);
+    }
+
+    bool hasNewBlock(juce::uint32& seen)
+    {
+        const auto current = pool.generation.load();
+        if (current == seen)
+            return false;
+
+        seen = current;
+        return true;
+    }
+
+    bool park(juce::uint32& seen, int timeoutMs)
+    {
+        // re-check after announcing ourselves, so a block published in between isn't missed
+        parked = true;
+        if (!hasNewBlock(seen))
+            wait(timeoutMs);
+        parked = false;
+
+        return hasNewBlock(seen);
+    }
+
+    DeckRenderPool& pool;
+};
+
+DeckRenderPool::DeckRenderPool(int numTasksToRun, Task taskToRun)
+    : numTasks(numTasksToRun), task(std::move(taskToRun))
+{
+    // the device thread renders too, so one worker fewer than there are tasks
+    const int numWorkers = juce::jmin(numTasks - 1, juce::SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto* w = workers.add(new Worker(*this, i + 1));
+        w->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(8));
+    }
+}
+
+DeckRenderPool::~DeckRenderPool()
+{
+    for (auto* w : workers)
+        w->signalThreadShouldExit();
+
+    for (auto* w : workers)
+    {
+        w->notify();
+        w->stopThread(2000);
+    }
+}
+
+void DeckRenderPool::render(int numSamples, bool anythingPlaying)
+{
+    // stopped decks render next to nothing, and the workers stay parked
+    if (workers.isEmpty() || !enabled.load() || !anythingPlaying || numSamples < minimumParallelBlockSize.load())
+    {
+        juce::ScopedNoDenormals noDenormals;
+
+        for (int t = 0; t < numTasks; ++t)
+            task(t, numSamples);
+
+        return;
+    }
+
+    const auto now = juce::Time::getMillisecondCounterHiRes();
+    const auto last = lastRenderMs.load(std::memory_order_relaxed);
+    if (last > 0.0)
+        blockPeriodMs.store(juce::jlimit(0.5, 50.0, now - last), std::memory_order_relaxed);
+    lastRenderMs.store(now, std::memory_order_relaxed);
+
+    // every task of the previous block has finished, so nobody can claim from it any more
+    blockSize.store(numSamples, std::memory_order_relaxed);
+    remaining.store(numTasks, std::memory_order_relaxed);
+    nextTask.store(0, std::memory_order_release);
+    generation.fetch_add(1);
+
+    for (auto* w : workers)
+        if (w->parked.load())
+            w->notify();
+
+    runPendingTasks();
+
+    // barrier: wait for tasks a worker claimed but hasn't finished yet
+    for (int spin = 0; remaining.load(std::memory_order_acquire) > 0; ++spin)
+        pause(spin);
+}
+
+void DeckRenderPool::runPendingTasks()
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    for (;;)
+    {
+        const int t = nextTask.fetch_add(1, std::memory_order_acq_rel);
+        if (t >= numTasks)
+            return;
+
+        task(t, blockSize.load(std::memory_order_relaxed));
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+
+// Renders one task per deck for each audio block, spread over a few realtime worker
+// threads. The device thread publishes a block by bumping a generation counter, claims
+// tasks alongside the workers and then spins until the last one has finished, so the
+// per-block hand-off takes no locks and allocates nothing. Between blocks a worker sleeps
+// until shortly before the next block is due (from the device's measured callback period)
+// and spins only across that short window, capped at a fraction of the period; if the
+// block hasn't come by then it parks until the device thread wakes it. Workers never
+// spin while nothing is playing.
+//
+// When the pool is disabled (the default), there is a single CPU, nothing is playing, or
+// the block is too small for the hand-off to pay for itself, the tasks simply run one
+// after the other on the caller.
+class DeckRenderPool
+{
+public:
+    // renders task taskIndex (0 .. numTasks - 1) for a block of numSamples
+    using Task = std::function<void(int taskIndex, int numSamples)>;
+
+    DeckRenderPool(int numTasks, Task taskToRun);
+    ~DeckRenderPool();
+
+    void setEnabled(bool shouldBeEnabled) { enabled = shouldBeEnabled; }
+    bool isEnabled() const { return enabled.load(); }
+    bool canRunInParallel() const { return !workers.isEmpty(); }
+
+    void setMinimumParallelBlockSize(int numSamples) { minimumParallelBlockSize = numSamples; }
+
+    // audio thread: returns once every task has rendered this block
+    void render(int numSamples, bool anythingPlaying);
+
+private:
+    class Worker;
+
+    void runPendingTasks();
+
+    const int numTasks;
+    const Task task;
+
+    std::atomic<bool> enabled{ false };
+    std::atomic<int> minimumParallelBlockSize{ 64 };
+
+    // per-block hand-off
+    std::atomic<juce::uint32> generation{ 0 };
+    std::atomic<int> blockSize{ 0 };
+    std::atomic<int> nextTask{ 0 };
+    std::atomic<int> remaining{ 0 };
+
+    // when the last block was published and the time between them, for the workers' spin
+    std::atomic<double> blockPeriodMs{ 10.0 };
+    std::atomic<double> lastRenderMs{ 0.0 };
+
+    juce::OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckRenderPool)
+};
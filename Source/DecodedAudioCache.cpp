@@ -0,0 +1,243 @@
+#include "DecodedAudioCache.h"
+#include "CodecRegistry.h"
+
+//==============================================================================
+RamAudioReader::RamAudioReader(std::shared_ptr<const DecodedTrack> decodedTrack)
+    : juce::AudioFormatReader(nullptr, "RAM"),
+      track(std::move(decodedTrack))
+{
+    sampleRate = track->sampleRate;
+    bitsPerSample = 32;
+    usesFloatingPointData = true;
+    lengthInSamples = track->audio.getNumSamples();
+    numChannels = (unsigned int) track->audio.getNumChannels();
+}
+
+bool RamAudioReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                 juce::int64 startSampleInFile, int numSamples)
+{
+    clearSamplesBeyondAvailableLength(destChannels, numDestChannels, startOffsetInDestBuffer,
+                                      startSampleInFile, numSamples, lengthInSamples);
+
+    if (numSamples <= 0)
+        return true;
+
+    // usesFloatingPointData is set, so the destination channels are really float*
+    for (int ch = 0; ch < numDestChannels; ++ch)
+    {
+        if (auto* dest = reinterpret_cast<float*>(destChannels[ch]))
+        {
+            dest += startOffsetInDestBuffer;
+
+            if (ch < track->audio.getNumChannels())
+                juce::FloatVectorOperations::copy(dest, track->audio.getReadPointer(ch, (int) startSampleInFile), numSamples);
+            else
+                juce::FloatVectorOperations::clear(dest, numSamples);
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
+JUCE_IMPLEMENT_SINGLETON(DecodedAudioCache)
+
+DecodedAudioCache::DecodedAudioCache() {}
+
+DecodedAudioCache::~DecodedAudioCache()
+{
+    if (auto* scheduler = JobScheduler::getInstanceWithoutCreating())
+        for (auto& p : pending)
+            scheduler->cancelGroup(p.job, true);
+
+    clearSingletonInstance();
+}
+
+// Runs on a scheduler worker.
+void DecodedAudioCache::decode(juce::WeakReference<DecodedAudioCache> cache, const juce::File& file,
+                               JobScheduler::GroupId job, const JobScheduler::Context& context)
+{
+    std::shared_ptr<DecodedTrack> track;
+    size_t reservedBytes = 0;
+
+    auto reader = CodecRegistry::getInstance()->createReaderFor(file);
+
+    if (reader != nullptr && reader->lengthInSamples > 0 && reader->lengthInSamples < std::numeric_limits<int>::max())
+    {
+        auto numSamples = (int) reader->lengthInSamples;
+        auto bytes = (size_t) reader->numChannels * (size_t) numSamples * sizeof(float);
+
+        if (cache != nullptr && cache->reserve(bytes))
+        {
+            reservedBytes = bytes;
+            track = std::make_shared<DecodedTrack>();
+            track->file = file;
+            track->sampleRate = reader->sampleRate;
+            track->audio.setSize((int) reader->numChannels, numSamples);
+
+            // decode in chunks so a cancelled job stops promptly
+            const int chunk = 65536;
+            for (int pos = 0; pos < numSamples; pos += chunk)
+            {
+                if (context.shouldStop())
+                {
+                    track.reset();
+                    break;
+                }
+
+                reader->read(&track->audio, pos, juce::jmin(chunk, numSamples - pos), pos, true, true);
+            }
+        }
+    }
+
+    juce::MessageManager::callAsync([cache, file, job, track, reservedBytes]
+    {
+        if (auto* c = cache.get())
+            c->decodeFinished(file, job, track, reservedBytes);
+    });
+}
+
+DecodedAudioCache::Track DecodedAudioCache::find(const juce::File& file)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (auto it = lru.begin(); it != lru.end(); ++it)
+    {
+        if ((*it)->file == file)
+        {
+            lru.splice(lru.begin(), lru, it);
+            return lru.front();
+        }
+    }
+
+    return nullptr;
+}
+
+void DecodedAudioCache::requestDecode(const juce::File& file, const void* owner, Callback onReady)
+{
+    if (auto track = find(file))
+    {
+        onReady(track);
+        return;
+    }
+
+    const juce::ScopedLock sl(lock);
+
+    // already being decoded for another deck: just wait for the same result
+    for (auto& p : pending)
+    {
+        if (p.file == file)
+        {
+            p.requests.push_back({ owner, std::move(onReady) });
+            return;
+        }
+    }
+
+    auto* scheduler = JobScheduler::getInstance();
+    auto job = scheduler->createGroup();
+    pending.push_back({ file, job, { { owner, std::move(onReady) } } });
+
+    juce::WeakReference<DecodedAudioCache> weakThis(this);
+    scheduler->schedule("Decode " + file.getFileName(), JobScheduler::Priority::loadedTrack, job,
+                        [weakThis, file, job](const JobScheduler::Context& context) { decode(weakThis, file, job, context); });
+}
+
+void DecodedAudioCache::cancelRequests(const void* owner)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (auto it = pending.begin(); it != pending.end();)
+    {
+        it->requests.erase(std::remove_if(it->requests.begin(), it->requests.end(),
+                                          [owner](const Request& r) { return r.owner == owner; }),
+                           it->requests.end());
+
+        // the track was unloaded from every deck that wanted it
+        if (it->requests.empty())
+        {
+            JobScheduler::getInstance()->cancelGroup(it->job);
+            it = pending.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void DecodedAudioCache::setBudgetBytes(size_t newBudget)
+{
+    const juce::ScopedLock sl(lock);
+    budgetBytes = newBudget;
+    evictUnusedUntil(0);
+}
+
+size_t DecodedAudioCache::getBudgetBytes() const
+{
+    const juce::ScopedLock sl(lock);
+    return budgetBytes;
+}
+
+size_t DecodedAudioCache::getBytesUsed() const
+{
+    const juce::ScopedLock sl(lock);
+    return bytesUsed;
+}
+
+// Called from a decode thread before allocating the buffer.
+bool DecodedAudioCache::reserve(size_t bytes)
+{
+    const juce::ScopedLock sl(lock);
+    evictUnusedUntil(bytes);
+
+    if (bytesUsed + bytesReserved + bytes > budgetBytes)
+        return false;
+
+    bytesReserved += bytes;
+    return true;
+}
+
+void DecodedAudioCache::decodeFinished(const juce::File& file, JobScheduler::GroupId job,
+                                       std::shared_ptr<DecodedTrack> track, size_t reservedBytes)
+{
+    std::vector<Request> requests;
+
+    {
+        const juce::ScopedLock sl(lock);
+        bytesReserved -= reservedBytes;
+
+        if (track != nullptr)
+        {
+            lru.push_front(track);
+            bytesUsed += track->getSizeInBytes();
+        }
+
+        for (auto it = pending.begin(); it != pending.end(); ++it)
+        {
+            if (it->file == file && it->job == job)
+            {
+                requests = std::move(it->requests);
+                pending.erase(it);
+                break;
+            }
+        }
+    }
+
+    for (auto& r : requests)
+        r.callback(track);
+}
+
+// Lock must be held. Drops least recently used tracks that no deck is playing.
+void DecodedAudioCache::evictUnusedUntil(size_t bytesNeeded)
+{
+    for (auto it = lru.end(); it != lru.begin() && bytesUsed + bytesReserved + bytesNeeded > budgetBytes;)
+    {
+        --it;
+
+        if (it->use_count() == 1)
+        {
+            bytesUsed -= (*it)->getSizeInBytes();
+            it = lru.erase(it);
+        }
+    }
+}
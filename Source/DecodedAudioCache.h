@@ -0,0 +1,97 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include <functional>
+#include <list>
+#include <memory>
+
+// A whole track decoded to float PCM, shared by every deck that has it loaded.
+struct DecodedTrack
+{
+    juce::File file;
+    double sampleRate = 44100.0;
+    juce::AudioBuffer<float> audio;
+
+    size_t getSizeInBytes() const
+    {
+        return (size_t) audio.getNumChannels() * (size_t) audio.getNumSamples() * sizeof(float);
+    }
+};
+
+// AudioFormatReader that plays a DecodedTrack out of RAM, so seeks cost nothing.
+class RamAudioReader : public juce::AudioFormatReader
+{
+public:
+    explicit RamAudioReader(std::shared_ptr<const DecodedTrack> decodedTrack);
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    std::shared_ptr<const DecodedTrack> track;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RamAudioReader)
+};
+
+// Process-wide cache of fully decoded tracks with a memory budget and LRU eviction.
+// Decoding runs on background threads; a file requested by two decks is decoded once.
+// Tracks still referenced by a deck are never evicted, they just stop counting as free space.
+class DecodedAudioCache : public juce::DeletedAtShutdown
+{
+public:
+    using Track = std::shared_ptr<const DecodedTrack>;
+    using Callback = std::function<void(Track)>;
+
+    DecodedAudioCache();
+    ~DecodedAudioCache() override;
+
+    // Returns the resident track for this file (and marks it most recently used), or nullptr.
+    Track find(const juce::File& file);
+
+    // Decodes the file in the background. The callback runs on the message thread with the
+    // decoded track, or nullptr if the file can't be read or doesn't fit in the budget.
+    void requestDecode(const juce::File& file, const void* owner, Callback onReady);
+
+    // Drops any pending callbacks registered by this owner (call before it is destroyed);
+    // a decode nobody is waiting for any more is cancelled.
+    void cancelRequests(const void* owner);
+
+    void setBudgetBytes(size_t newBudget);
+    size_t getBudgetBytes() const;
+    size_t getBytesUsed() const;
+
+    JUCE_DECLARE_SINGLETON(DecodedAudioCache, false)
+
+private:
+    struct Request
+    {
+        const void* owner;
+        Callback callback;
+    };
+
+    struct PendingDecode
+    {
+        juce::File file;
+        JobScheduler::GroupId job;
+        std::vector<Request> requests;
+    };
+
+    static void decode(juce::WeakReference<DecodedAudioCache> cache, const juce::File& file,
+                       JobScheduler::GroupId job, const JobScheduler::Context& context);
+
+    bool reserve(size_t bytes);
+    void decodeFinished(const juce::File& file, JobScheduler::GroupId job,
+                        std::shared_ptr<DecodedTrack> track, size_t reservedBytes);
+    void evictUnusedUntil(size_t bytesNeeded);
+
+    juce::CriticalSection lock;
+    std::list<Track> lru; // front = most recently used
+    std::vector<PendingDecode> pending;
+
+    size_t budgetBytes = (size_t) 1024 * 1024 * 1024;
+    size_t bytesUsed = 0;
+    size_t bytesReserved = 0;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(DecodedAudioCache)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedAudioCache)
+};
@@ -0,0 +1,158 @@
+#include "DownmixMatrix.h"
+
+namespace
+{
+    // NumInputs is a constant, so the inner loop unrolls and stereo or 5.1 pay nothing for
+    // the general case
+    template <int NumInputs>
+    void mixToStereo(const float* const* in, float* left, float* right,
+                     const float (&gains)[DownmixMatrix::numOutputs][DownmixMatrix::maxInputs], int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float l = 0.0f, r = 0.0f;
+
+            for (int ch = 0; ch < NumInputs; ++ch)
+            {
+                l += gains[0][ch] * in[ch][i];
+                r += gains[1][ch] * in[ch][i];
+            }
+
+            left[i] = l;
+            right[i] = r;
+        }
+    }
+
+    void mixToStereo(int numInputs, const float* const* in, float* left, float* right,
+                     const float (&gains)[DownmixMatrix::numOutputs][DownmixMatrix::maxInputs], int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float l = 0.0f, r = 0.0f;
+
+            for (int ch = 0; ch < numInputs; ++ch)
+            {
+                l += gains[0][ch] * in[ch][i];
+                r += gains[1][ch] * in[ch][i];
+            }
+
+            left[i] = l;
+            right[i] = r;
+        }
+    }
+}
+
+DownmixMatrix DownmixMatrix::forLayout(int numInputChannels, Preset preset)
+{
+    DownmixMatrix m;
+    m.numInputs = juce::jlimit(1, maxInputs, numInputChannels);
+
+    for (auto& row : m.gains)
+        std::fill(std::begin(row), std::end(row), 0.0f);
+
+    const float minus3dB = juce::MathConstants<float>::sqrt2 * 0.5f;
+
+    if (preset == Preset::frontPair || m.numInputs == 1)
+    {
+        m.gains[0][0] = 1.0f;
+        m.gains[1][juce::jmin(1, m.numInputs - 1)] = 1.0f;
+    }
+    else if (preset == Preset::stemPairs || (m.numInputs != 2 && m.numInputs != 6 && m.numInputs != 8))
+    {
+        for (int ch = 0; ch < m.numInputs; ++ch)
+            m.gains[ch % 2][ch] = 1.0f;
+
+        // an odd one out goes to the middle
+        if (m.numInputs % 2 == 1 && m.numInputs > 1)
+        {
+            m.gains[0][m.numInputs - 1] = minus3dB;
+            m.gains[1][m.numInputs - 1] = minus3dB;
+        }
+    }
+    else
+    {
+        // WAVE order: L R C LFE, then Ls Rs (5.1) or Lb Rb Ls Rs (7.1). The LFE is left
+        // out, as BS.775 does; overs are the master limiter's job.
+        m.gains[0][0] = 1.0f;
+        m.gains[1][1] = 1.0f;
+
+        if (m.numInputs >= 6)
+        {
+            m.gains[0][2] = m.gains[1][2] = minus3dB;
+
+            for (int ch = 4; ch < m.numInputs; ch += 2)
+            {
+                m.gains[0][ch] = minus3dB;
+                m.gains[1][ch + 1] = minus3dB;
+            }
+        }
+    }
+
+    if (preset == Preset::monoSum && m.numInputs > 1)
+    {
+        for (int ch = 0; ch < m.numInputs; ++ch)
+            m.gains[0][ch] = m.gains[1][ch] = 0.5f * (m.gains[0][ch] + m.gains[1][ch]);
+    }
+
+    return m;
+}
+
+bool DownmixMatrix::isPassThrough() const
+{
+    if (numInputs == 1)
+        return gains[0][0] == 1.0f && gains[1][0] == 1.0f;
+
+    return numInputs == 2
+        && gains[0][0] == 1.0f && gains[0][1] == 0.0f
+        && gains[1][0] == 0.0f && gains[1][1] == 1.0f;
+}
+
+void DownmixMatrix::process(const juce::AudioBuffer<float>& source, int sourceStart,
+                            juce::AudioBuffer<float>& dest, int destStart, int numSamples) const
+{
+    const int channels = juce::jmin(numInputs, source.getNumChannels());
+    if (channels == 0 || dest.getNumChannels() < numOutputs)
+        return;
+
+    const float* in[maxInputs];
+    for (int ch = 0; ch < channels; ++ch)
+        in[ch] = source.getReadPointer(ch, sourceStart);
+
+    auto* left = dest.getWritePointer(0, destStart);
+    auto* right = dest.getWritePointer(1, destStart);
+
+    switch (channels)
+    {
+        case 1:  mixToStereo<1>(in, left, right, gains, numSamples); break;
+        case 2:  mixToStereo<2>(in, left, right, gains, numSamples); break;
+        case 6:  mixToStereo<6>(in, left, right, gains, numSamples); break;
+        case 8:  mixToStereo<8>(in, left, right, gains, numSamples); break;
+        default: mixToStereo(channels, in, left, right, gains, numSamples); break;
+    }
+}
+
+juce::String DownmixMatrix::getPresetName(Preset preset)
+{
+    switch (preset)
+    {
+        case Preset::automatic: return "Automatic (own outputs if there are enough)";
+        case Preset::stemPairs: return "Stems (pairs)";
+        case Preset::frontPair: return "Front pair only";
+        case Preset::monoSum:   return "Mono";
+    }
+
+    return {};
+}
+
+juce::String DownmixMatrix::describeLayout(int numChannels)
+{
+    switch (numChannels)
+    {
+        case 0:  return "-";
+        case 1:  return "Mono";
+        case 2:  return "Stereo";
+        case 6:  return "5.1";
+        case 8:  return "7.1";
+        default: return juce::String(numChannels) + " ch";
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <JuceHeader.h>
+
+// How a track's channels (mono, stereo, 5.1, 7.1, or a bundle of stems) are mixed down to
+// a deck's stereo bus, when they aren't played on outputs of their own (see PlayerAudio).
+// The same matrix folds a wide bus for the headphones. The gains are a plain 2 x maxInputs table, so a matrix can be
+// copied to the audio thread freely; process() is specialised for 1, 2, 6 and 8 inputs.
+class DownmixMatrix
+{
+public:
+    static constexpr int maxInputs = 8;  // channels past this are ignored
+    static constexpr int numOutputs = 2;
+
+    enum class Preset
+    {
+        automatic, // own outputs if the device has them; else by channel count: as-is up to
+                   // stereo, ITU-R BS.775 for 5.1 and 7.1, else stem pairs
+        stemPairs, // even channels left, odd channels right, at unity: stems sum back to the mix
+        frontPair, // the first two channels only
+        monoSum    // the automatic mix, folded to mono on both sides
+    };
+
+    DownmixMatrix() = default; // stereo pass-through
+    static DownmixMatrix forLayout(int numInputChannels, Preset preset);
+
+    int getNumInputs() const { return numInputs; }
+    void setGain(int output, int input, float gain) { gains[output][input] = gain; }
+    float getGain(int output, int input) const { return gains[output][input]; }
+
+    // true when the reader's own channel handling (mono copied to both sides, stereo as
+    // it is) already gives this result, so there is nothing to mix
+    bool isPassThrough() const;
+
+    // Audio thread: dest's first two channels = gains x source's first getNumInputs()
+    // channels. Doesn't allocate; source and dest must be different buffers.
+    void process(const juce::AudioBuffer<float>& source, int sourceStart,
+                 juce::AudioBuffer<float>& dest, int destStart, int numSamples) const;
+
+    static juce::String getPresetName(Preset preset);
+    static juce::String describeLayout(int numChannels);
+
+private:
+    int numInputs = 2;
+    float gains[numOutputs][maxInputs] = { { 1.0f }, { 0.0f, 1.0f } }; // stereo as it is
+};
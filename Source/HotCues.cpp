@@ -0,0 +1,382 @@
+#include "HotCues.h"
+
+// how much audio is kept decoded from each cue point, and how far that can grow
+static constexpr double kCueBufferSeconds = 2.0;
+static constexpr double kMaxCueBufferSeconds = 16.0;
+
+// how long before the end of a buffer without a hand-over its window is extended
+static constexpr double kExtendMarginSeconds = 0.5;
+// buffers start this far ahead of their cue: a jump to the cue's time in seconds can land a
+// sample or two either side of it once the transport has truncated or resampled it
+static constexpr int kLeadInSamples = 64;
+
+//==============================================================================
+HotCueBank::HotCueBank()
+    : jobs(JobScheduler::getInstance()->createGroup())
+{
+    for (auto& p : positions)
+        p = -1.0;
+
+    for (auto& w : windowSeconds)
+        w = kCueBufferSeconds;
+}
+
+HotCueBank::~HotCueBank()
+{
+    if (auto* scheduler = JobScheduler::getInstanceWithoutCreating())
+        scheduler->cancelGroup(jobs, true);
+
+    cancelPendingUpdate();
+    deleteRetiredReaders();
+}
+
+void HotCueBank::setReaderFactory(ReaderFactory newFactory)
+{
+    // buffers still decoding from the previous track are useless now
+    auto* scheduler = JobScheduler::getInstance();
+    scheduler->cancelGroup(jobs);
+    jobs = scheduler->createGroup();
+
+    factory = std::move(newFactory);
+
+    for (int i = 0; i < numCues; ++i)
+        rebuild(i);
+}
+
+void HotCueBank::setCue(int cueIndex, double positionInSeconds)
+{
+    if (!juce::isPositiveAndBelow(cueIndex, numCues))
+        return;
+
+    positions[cueIndex] = juce::jmax(0.0, positionInSeconds);
+    windowSeconds[cueIndex] = kCueBufferSeconds;
+    rebuild(cueIndex);
+}
+
+void HotCueBank::clearCue(int cueIndex)
+{
+    if (!juce::isPositiveAndBelow(cueIndex, numCues))
+        return;
+
+    positions[cueIndex] = -1.0;
+    rebuild(cueIndex);
+}
+
+void HotCueBank::clearAll()
+{
+    for (int i = 0; i < numCues; ++i)
+        clearCue(i);
+}
+
+bool HotCueBank::hasCue(int cueIndex) const
+{
+    return juce::isPositiveAndBelow(cueIndex, numCues) && positions[cueIndex] >= 0.0;
+}
+
+double HotCueBank::getCuePosition(int cueIndex) const
+{
+    return hasCue(cueIndex) ? positions[cueIndex] : -1.0;
+}
+
+size_t HotCueBank::getSizeInBytes() const
+{
+    size_t bytes = 0;
+
+    for (auto* buffer : allBuffers)
+        bytes += (size_t) buffer->audio.getNumChannels() * (size_t) buffer->audio.getNumSamples() * sizeof(float);
+
+    return bytes;
+}
+
+juce::String HotCueBank::toString() const
+{
+    juce::StringArray parts;
+
+    for (auto p : positions)
+        parts.add(p >= 0.0 ? juce::String(p, 3) : juce::String());
+
+    return parts.joinIntoString(",");
+}
+
+void HotCueBank::restoreFromString(const juce::String& state)
+{
+    auto parts = juce::StringArray::fromTokens(state, ",", "");
+
+    for (int i = 0; i < numCues; ++i)
+    {
+        if (i < parts.size() && parts[i].isNotEmpty())
+            setCue(i, parts[i].getDoubleValue());
+        else
+            clearCue(i);
+    }
+}
+
+int HotCueBank::read(float* const* dest, int numDestChannels, int destOffset, juce::int64 startSample, int numSamples)
+{
+    CueBuffer::Ptr hit;
+    int hitIndex = -1;
+
+    {
+        // never wait on the message thread: if it's swapping a slot, just decode normally
+        const juce::SpinLock::ScopedTryLockType sl(slotLock);
+        if (!sl.isLocked())
+            return 0;
+
+        for (int i = 0; i < numCues; ++i)
+        {
+            auto& slot = slots[i];
+            if (slot != nullptr && startSample >= slot->startSample
+                && startSample < slot->startSample + slot->audio.getNumSamples())
+            {
+                hit = slot;
+                hitIndex = i;
+                break;
+            }
+        }
+    }
+
+    if (hit == nullptr)
+        return 0;
+
+    auto offset = (int) (startSample - hit->startSample);
+    auto count = juce::jmin(numSamples, hit->audio.getNumSamples() - offset);
+
+    // nearly through a buffer with nothing to hand over to: get a longer one decoded
+    if (startSample + count >= hit->extendAt && hit->continuation.load() == nullptr
+        && !hit->extensionRequested.exchange(true))
+    {
+        needsExtension[hitIndex] = true;
+        triggerAsyncUpdate();
+    }
+
+    for (int ch = 0; ch < numDestChannels; ++ch)
+    {
+        if (dest[ch] == nullptr)
+            continue;
+
+        if (ch < hit->audio.getNumChannels())
+            juce::FloatVectorOperations::copy(dest[ch] + destOffset, hit->audio.getReadPointer(ch, offset), count);
+        else
+            juce::FloatVectorOperations::clear(dest[ch] + destOffset, count);
+    }
+
+    return count;
+}
+
+juce::AudioFormatReader* HotCueBank::handOver(juce::AudioFormatReader* current, juce::int64 endSample)
+{
+    // current has to go somewhere that isn't the audio thread
+    if (retiredFifo.getFreeSpace() == 0)
+        return nullptr;
+
+    juce::AudioFormatReader* next = nullptr;
+    int cueIndex = -1;
+
+    {
+        const juce::SpinLock::ScopedTryLockType sl(slotLock);
+        if (!sl.isLocked())
+            return nullptr;
+
+        for (int i = 0; i < numCues; ++i)
+        {
+            auto* slot = slots[i].get();
+            if (slot != nullptr && slot->startSample + slot->audio.getNumSamples() == endSample)
+            {
+                next = slot->continuation.exchange(nullptr);
+                cueIndex = i;
+                break;
+            }
+        }
+    }
+
+    if (next == nullptr)
+        return nullptr;
+
+    {
+        const auto scope = retiredFifo.write(1);
+        retired[scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2] = current;
+    }
+
+    needsRebuild[cueIndex] = true;
+    triggerAsyncUpdate();
+    return next;
+}
+
+void HotCueBank::deleteRetiredReaders()
+{
+    const auto scope = retiredFifo.read(retiredFifo.getNumReady());
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        delete std::exchange(retired[scope.startIndex1 + i], nullptr);
+
+    for (int i = 0; i < scope.blockSize2; ++i)
+        delete std::exchange(retired[scope.startIndex2 + i], nullptr);
+}
+
+// Re-decodes cues whose hand-over was used, and those that need a longer window.
+void HotCueBank::handleAsyncUpdate()
+{
+    deleteRetiredReaders();
+
+    for (int i = 0; i < numCues; ++i)
+    {
+        bool rebuildCue = needsRebuild[i].exchange(false);
+
+        if (needsExtension[i].exchange(false) && windowSeconds[i] < kMaxCueBufferSeconds)
+        {
+            windowSeconds[i] = juce::jmin(kMaxCueBufferSeconds, windowSeconds[i] * 2.0);
+            rebuildCue = true;
+        }
+
+        if (rebuildCue && hasCue(i))
+            rebuild(i, true);
+    }
+}
+
+void HotCueBank::rebuild(int cueIndex, bool keepCurrentBuffer)
+{
+    ++generations[cueIndex];
+
+    // a cue that's only getting a fresh hand-over keeps serving jumps from its current buffer
+    if (!keepCurrentBuffer)
+        publish(cueIndex, nullptr);
+
+    if (positions[cueIndex] >= 0.0 && factory != nullptr)
+    {
+        juce::WeakReference<HotCueBank> weakThis(this);
+        auto generation = generations[cueIndex];
+        auto seconds = positions[cueIndex];
+        auto lengthSeconds = windowSeconds[cueIndex];
+        auto readerFactory = factory;
+
+        JobScheduler::getInstance()->schedule("Hot cue " + juce::String(cueIndex + 1), JobScheduler::Priority::loadedTrack, jobs,
+            [weakThis, cueIndex, generation, seconds, lengthSeconds, readerFactory](const JobScheduler::Context& context)
+            {
+                auto buffer = decode(readerFactory, seconds, lengthSeconds, context);
+
+                juce::MessageManager::callAsync([weakThis, cueIndex, generation, buffer]
+                {
+                    if (auto* b = weakThis.get())
+                        b->install(cueIndex, generation, buffer);
+                });
+            });
+    }
+}
+
+// Runs on a scheduler worker.
+HotCueBank::CueBuffer::Ptr HotCueBank::decode(const ReaderFactory& readerFactory, double seconds, double lengthSeconds,
+                                              const JobScheduler::Context& context)
+{
+    CueBuffer::Ptr buffer;
+
+    if (auto reader = readerFactory())
+    {
+        auto start = juce::jmax((juce::int64) 0, (juce::int64) (seconds * reader->sampleRate) - kLeadInSamples);
+        auto length = (int) juce::jmin((juce::int64) (lengthSeconds * reader->sampleRate) + kLeadInSamples,
+                                       reader->lengthInSamples - start);
+
+        if (length > 0 && !context.shouldStop())
+        {
+            buffer = new CueBuffer();
+            buffer->startSample = start;
+            buffer->audio.setSize((int) reader->numChannels, length);
+            reader->read(&buffer->audio, 0, length, start, true, true);
+
+            if (start + length < reader->lengthInSamples && !context.shouldStop())
+            {
+                buffer->extendAt = start + length - (juce::int64) (kExtendMarginSeconds * reader->sampleRate);
+                buffer->continuation = reader.release();
+            }
+        }
+    }
+
+    return buffer;
+}
+
+void HotCueBank::install(int cueIndex, int generation, CueBuffer::Ptr buffer)
+{
+    // the cue was moved or cleared while this buffer was decoding
+    if (generation != generations[cueIndex])
+        return;
+
+    publish(cueIndex, buffer);
+}
+
+void HotCueBank::publish(int cueIndex, CueBuffer::Ptr buffer)
+{
+    if (buffer != nullptr)
+        allBuffers.add(buffer);
+
+    {
+        const juce::SpinLock::ScopedLockType sl(slotLock);
+        slots[cueIndex] = buffer;
+    }
+
+    // anything only referenced by allBuffers is out of the slots and can't be picked up again
+    for (int i = allBuffers.size(); --i >= 0;)
+        if (allBuffers.getObjectPointerUnchecked(i)->getReferenceCount() == 1)
+            allBuffers.remove(i);
+}
+
+//==============================================================================
+HotCueReader::HotCueReader(juce::AudioFormatReader* readerToWrap, HotCueBank& cueBank, bool handOverFromCues)
+    : juce::AudioFormatReader(nullptr, readerToWrap->getFormatName()),
+      inner(readerToWrap),
+      bank(cueBank),
+      handOver(handOverFromCues)
+{
+    sampleRate = inner->sampleRate;
+    lengthInSamples = inner->lengthInSamples;
+    numChannels = inner->numChannels;
+    metadataValues = inner->metadataValues;
+    bitsPerSample = 32;
+    usesFloatingPointData = true;
+}
+
+bool HotCueReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                               juce::int64 startSampleInFile, int numSamples)
+{
+    clearSamplesBeyondAvailableLength(destChannels, numDestChannels, startOffsetInDestBuffer,
+                                      startSampleInFile, numSamples, lengthInSamples);
+
+    if (numSamples <= 0)
+        return true;
+
+    // Only use the cue buffers after a jump (and until they run out). During normal play
+    // the inner reader keeps reading contiguously, so passing over a cue never makes it seek.
+    const bool wasServingFromCue = servingFromCue;
+    int served = 0;
+    if (startSampleInFile != nextSample || servingFromCue)
+        served = bank.read(reinterpret_cast<float* const*>(destChannels), numDestChannels,
+                           startOffsetInDestBuffer, startSampleInFile, numSamples);
+
+    servingFromCue = served == numSamples;
+    nextSample = startSampleInFile + numSamples;
+
+    if (served == numSamples)
+        return true;
+
+    // Ran off the end of a cue buffer: rather than make the inner reader seek here, carry
+    // on with the reader that decoded the buffer. Without one (the cue was triggered again
+    // before its hand-over was replaced), the inner reader seeks as before.
+    if (handOver && (served > 0 || wasServingFromCue))
+        if (auto* next = bank.handOver(inner.get(), startSampleInFile + served))
+        {
+            inner.release();
+            inner.reset(next);
+        }
+
+    auto offset = startOffsetInDestBuffer + served;
+    auto remaining = numSamples - served;
+
+    if (!inner->readSamples(destChannels, numDestChannels, offset, startSampleInFile + served, remaining))
+        return false;
+
+    if (!inner->usesFloatingPointData)
+        for (int ch = 0; ch < numDestChannels; ++ch)
+            if (auto* d = destChannels[ch])
+                juce::FloatVectorOperations::convertFixedToFloat(reinterpret_cast<float*>(d) + offset, d + offset,
+                                                                 1.0f / (float) 0x7fffffff, remaining);
+
+    return true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include <atomic>
+#include <functional>
+
+// Numbered hot cues for one deck. Each set cue keeps a short pre-decoded buffer starting
+// at the cue point, so jumping to it plays from memory on the very next audio block
+// instead of waiting for a cold decoder seek. The reader that decoded the buffer is kept
+// too, already positioned at its end, so the deck can carry on from it when playback
+// runs past the buffer; once that hand-over is used, the cue is re-decoded in the
+// background (the old buffer stays in place meanwhile) to get a fresh one. Playback
+// nearing the end of a buffer whose hand-over isn't there yet has the cue re-decoded
+// with a longer window instead.
+//
+// Cue positions are owned by the message thread; the audio thread only reads the
+// published buffers (try-lock, never blocks), following JUCE's ref-counted buffer idiom.
+class HotCueBank : private juce::AsyncUpdater
+{
+public:
+    static constexpr int numCues = 8;
+
+    // Creates a reader on the same sample timeline as the deck's own reader.
+    // Called on a background thread.
+    using ReaderFactory = std::function<std::unique_ptr<juce::AudioFormatReader>()>;
+
+    HotCueBank();
+    ~HotCueBank() override;
+
+    // Sets the source used to pre-decode cue buffers and rebuilds any that are set.
+    void setReaderFactory(ReaderFactory newFactory);
+
+    void setCue(int cueIndex, double positionInSeconds);
+    void clearCue(int cueIndex);
+    void clearAll();
+
+    bool hasCue(int cueIndex) const;
+    double getCuePosition(int cueIndex) const;
+
+    // message thread: the pre-decoded buffers held, including any the audio thread may still be reading
+    size_t getSizeInBytes() const;
+
+    // "12.5,,30.25,..." - one entry per cue, empty when unset
+    juce::String toString() const;
+    void restoreFromString(const juce::String& state);
+
+    // Audio thread: if startSample lies inside a ready cue buffer, copies as much as it
+    // holds into dest and returns the number of samples served (0 if none).
+    int read(float* const* dest, int numDestChannels, int destOffset, juce::int64 startSample, int numSamples);
+
+    // Audio thread: if a cue buffer ends at endSample and still has its decoder, returns
+    // that decoder (positioned at endSample) and takes current, which is deleted on the
+    // message thread. Otherwise returns nullptr and current stays with the caller.
+    juce::AudioFormatReader* handOver(juce::AudioFormatReader* current, juce::int64 endSample);
+
+private:
+    struct CueBuffer : public juce::ReferenceCountedObject
+    {
+        using Ptr = juce::ReferenceCountedObjectPtr<CueBuffer>;
+
+        ~CueBuffer() override { delete continuation.exchange(nullptr); }
+
+        juce::int64 startSample = 0;
+        juce::AudioBuffer<float> audio;
+
+        // the reader that decoded audio, positioned at its end; taken by handOver()
+        std::atomic<juce::AudioFormatReader*> continuation{ nullptr };
+
+        // reads from here on without a continuation ask for a longer window, once
+        juce::int64 extendAt = std::numeric_limits<juce::int64>::max();
+        std::atomic<bool> extensionRequested{ false };
+    };
+
+    static constexpr int maxRetired = 16;
+
+    static CueBuffer::Ptr decode(const ReaderFactory& readerFactory, double seconds, double lengthSeconds,
+                                 const JobScheduler::Context& context);
+
+    void rebuild(int cueIndex, bool keepCurrentBuffer = false);
+    void handleAsyncUpdate() override;
+    void deleteRetiredReaders();
+    void install(int cueIndex, int generation, CueBuffer::Ptr buffer);
+    void publish(int cueIndex, CueBuffer::Ptr buffer);
+
+    double positions[numCues];
+    double windowSeconds[numCues];
+    int generations[numCues] = {};
+    ReaderFactory factory;
+    JobScheduler::GroupId jobs;
+
+    juce::SpinLock slotLock;
+    CueBuffer::Ptr slots[numCues];
+
+    // keeps every buffer alive until the audio thread can no longer be holding it,
+    // so the last reference is always dropped on the message thread
+    juce::ReferenceCountedArray<CueBuffer> allBuffers;
+
+    // audio thread -> message thread: readers replaced by a hand-over, and cues whose
+    // hand-over was used and needs replacing
+    juce::AbstractFifo retiredFifo{ maxRetired };
+    juce::AudioFormatReader* retired[maxRetired] = {};
+    std::atomic<bool> needsRebuild[numCues] = {};
+    std::atomic<bool> needsExtension[numCues] = {};
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(HotCueBank)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HotCueBank)
+};
+
+// Wraps the deck's reader and serves reads that land inside a hot-cue buffer from memory.
+// Always delivers float data, converting from the inner reader if it is fixed-point.
+class HotCueReader : public juce::AudioFormatReader
+{
+public:
+    // With handOverFromCues, playback that runs past a cue buffer continues on the reader
+    // that decoded it instead of making readerToWrap seek there; worth it when seeking the
+    // wrapped reader means restarting a decoder, not when it reads from RAM or a mapping.
+    HotCueReader(juce::AudioFormatReader* readerToWrap, HotCueBank& cueBank, bool handOverFromCues);
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    std::unique_ptr<juce::AudioFormatReader> inner;
+    HotCueBank& bank;
+    const bool handOver;
+
+    juce::int64 nextSample = -1;
+    bool servingFromCue = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HotCueReader)
+};
@@ -0,0 +1,249 @@
+#include "InsertChain.h"
+
+InsertChain::InsertChain()
+{
+    for (auto& b : bypassed)
+        b = false;
+}
+
+InsertChain::~InsertChain()
+{
+    cancelPendingUpdate();
+
+    for (auto& p : plugins)
+    {
+        if (p != nullptr)
+        {
+            p->removeListener(this);
+            p->releaseResources();
+        }
+    }
+}
+
+void InsertChain::prepare(double newSampleRate, int maximumBlockSize)
+{
+    const juce::SpinLock::ScopedLockType sl(chainLock);
+
+    sampleRate = newSampleRate;
+    maxBlockSize = juce::jmax(1, maximumBlockSize);
+
+    delayLine.setSize(maxChannels, (int) (maxCompensationSeconds * sampleRate) + 1);
+    delayLine.clear();
+    delayWritePos = 0;
+    delayedChannels = numChannels;
+    midi.ensureSize(256);
+
+    for (auto& p : plugins)
+        if (p != nullptr)
+            preparePlugin(*p);
+}
+
+void InsertChain::release()
+{
+    const juce::SpinLock::ScopedLockType sl(chainLock);
+
+    for (auto& p : plugins)
+        if (p != nullptr)
+            p->releaseResources();
+}
+
+// Main buses only, stereo in and out; prepared for the current device if there is one.
+bool InsertChain::preparePlugin(juce::AudioPluginInstance& plugin)
+{
+    plugin.disableNonMainBuses();
+    plugin.setChannelLayoutOfBus(true, 0, juce::AudioChannelSet::stereo());
+    plugin.setChannelLayoutOfBus(false, 0, juce::AudioChannelSet::stereo());
+
+    if (plugin.getTotalNumInputChannels() > numChannels || plugin.getTotalNumOutputChannels() != numChannels)
+        return false;
+
+    if (sampleRate > 0.0)
+    {
+        plugin.setNonRealtime(false);
+        plugin.setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+        plugin.prepareToPlay(sampleRate, maxBlockSize);
+    }
+
+    return true;
+}
+
+bool InsertChain::setPlugin(int slot, std::unique_ptr<juce::AudioPluginInstance> plugin)
+{
+    if (!juce::isPositiveAndBelow(slot, numSlots))
+        return false;
+
+    if (plugin != nullptr)
+    {
+        if (!preparePlugin(*plugin))
+            return false;
+
+        plugin->addListener(this);
+    }
+
+    std::unique_ptr<juce::AudioPluginInstance> old;
+    {
+        const juce::SpinLock::ScopedLockType sl(chainLock);
+        old = std::move(plugins[(size_t) slot]);
+        plugins[(size_t) slot] = std::move(plugin);
+        bypassed[(size_t) slot] = false;
+    }
+
+    // torn down here, outside the lock, never on the audio thread
+    if (old != nullptr)
+    {
+        old->removeListener(this);
+        old->releaseResources();
+        old.reset();
+    }
+
+    pluginLatency = getLatencySamples();
+
+    if (onLatencyChanged != nullptr)
+        onLatencyChanged();
+
+    return true;
+}
+
+juce::AudioPluginInstance* InsertChain::getPlugin(int slot) const
+{
+    return juce::isPositiveAndBelow(slot, numSlots) ? plugins[(size_t) slot].get() : nullptr;
+}
+
+bool InsertChain::isEmpty() const
+{
+    for (auto& p : plugins)
+        if (p != nullptr)
+            return false;
+
+    return true;
+}
+
+void InsertChain::setBypassed(int slot, bool shouldBeBypassed)
+{
+    if (juce::isPositiveAndBelow(slot, numSlots))
+        bypassed[(size_t) slot] = shouldBeBypassed;
+}
+
+bool InsertChain::isBypassed(int slot) const
+{
+    return juce::isPositiveAndBelow(slot, numSlots) && bypassed[(size_t) slot].load();
+}
+
+// A bypassed plugin keeps its latency (processBlockBypassed delays to match), so it still counts.
+int InsertChain::getLatencySamples() const
+{
+    int total = 0;
+
+    for (auto& p : plugins)
+        if (p != nullptr)
+            total += p->getLatencySamples();
+
+    return total;
+}
+
+void InsertChain::setCompensationDelay(int numSamples)
+{
+    compensationDelay = juce::jlimit(0, juce::jmax(0, delayLine.getNumSamples() - 1), numSamples);
+}
+
+void InsertChain::audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails& details)
+{
+    // may come from any thread, including the audio thread
+    if (details.latencyChanged)
+        triggerAsyncUpdate();
+}
+
+void InsertChain::handleAsyncUpdate()
+{
+    pluginLatency = getLatencySamples();
+
+    if (onLatencyChanged != nullptr)
+        onLatencyChanged();
+}
+
+void InsertChain::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (maxBlockSize == 0 || buffer.getNumChannels() < numChannels)
+        return;
+
+    const int numBusChannels = juce::jmin(maxChannels, buffer.getNumChannels());
+    float* channels[maxChannels];
+
+    // channels joining the bus (a wider track) mustn't replay what their ring last held
+    if (numBusChannels > delayedChannels)
+        for (int ch = delayedChannels; ch < numBusChannels; ++ch)
+            delayLine.clear(ch, 0, delayLine.getNumSamples());
+
+    delayedChannels = numBusChannels;
+
+    // plugins were prepared for maxBlockSize, so bigger device blocks go through in pieces
+    for (int done = 0; done < numSamples; done += maxBlockSize)
+    {
+        const int count = juce::jmin(maxBlockSize, numSamples - done);
+
+        for (int ch = 0; ch < numBusChannels; ++ch)
+            channels[ch] = buffer.getWritePointer(ch, startSample + done);
+
+        processChunk(channels, count);
+        delayChunk(channels, numBusChannels, count);
+    }
+}
+
+void InsertChain::processChunk(float* const* channels, int numSamples)
+{
+    // only fails while the message thread swaps a plugin: play that block dry
+    const juce::SpinLock::ScopedTryLockType lock(chainLock);
+    if (!lock.isLocked())
+        return;
+
+    juce::AudioBuffer<float> view(channels, numChannels, numSamples);
+
+    for (size_t slot = 0; slot < plugins.size(); ++slot)
+    {
+        auto* plugin = plugins[slot].get();
+        if (plugin == nullptr)
+            continue;
+
+        midi.clear();
+
+        if (bypassed[slot].load())
+            plugin->processBlockBypassed(view, midi);
+        else
+            plugin->processBlock(view, midi);
+    }
+}
+
+void InsertChain::delayChunk(float* const* channels, int numBusChannels, int numSamples)
+{
+    const int length = delayLine.getNumSamples();
+    if (length == 0)
+        return;
+
+    // written even at zero delay so a later change has history to read
+    const int compensation = compensationDelay.load();
+    const int extraLatency = pluginLatency.load();
+
+    for (int ch = 0; ch < numBusChannels; ++ch)
+    {
+        const int delay = juce::jmin(ch < numChannels ? compensation : compensation + extraLatency, length - 1);
+        float* x = channels[ch];
+        float* ring = delayLine.getWritePointer(ch);
+        int write = delayWritePos;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            ring[write] = x[i];
+
+            int read = write - delay;
+            if (read < 0)
+                read += length;
+
+            x[i] = ring[read];
+
+            if (++write == length)
+                write = 0;
+        }
+    }
+
+    delayWritePos = (delayWritePos + numSamples) % length;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <functional>
+
+// A short chain of hosted effect plugins (deck or master insert), followed by a delay
+// that lines this chain up with slower ones. The plugins run in stereo on the bus's first
+// pair; any further channels (a track on its own outputs) are delayed by the plugins'
+// latency as well, so they stay in line with it. Plugins are prepared on the message thread
+// before they are swapped in under a spin lock the audio thread only ever try-locks, and
+// are released and destroyed there too; processing allocates nothing.
+class InsertChain : private juce::AudioProcessorListener,
+                    private juce::AsyncUpdater
+{
+public:
+    static constexpr int numSlots = 4;
+
+    InsertChain();
+    ~InsertChain() override;
+
+    // not called while process() can run (device start/stop)
+    void prepare(double sampleRate, int maximumBlockSize);
+    void release();
+
+    double getSampleRate() const { return sampleRate; }
+    int getMaximumBlockSize() const { return maxBlockSize; }
+
+    // message thread; nullptr empties the slot. Returns false if the plugin can't run in
+    // stereo, in which case it is destroyed.
+    bool setPlugin(int slot, std::unique_ptr<juce::AudioPluginInstance> plugin);
+    juce::AudioPluginInstance* getPlugin(int slot) const;
+    bool isEmpty() const;
+
+    void setBypassed(int slot, bool shouldBeBypassed);
+    bool isBypassed(int slot) const;
+
+    // reported latency of the plugins in the chain, not counting the compensation delay
+    int getLatencySamples() const;
+
+    // extra delay so this chain's output lines up with the slowest parallel chain
+    void setCompensationDelay(int numSamples);
+    int getCompensationDelay() const { return compensationDelay.load(); }
+
+    // message thread, when a plugin is added or removed or reports a new latency
+    std::function<void()> onLatencyChanged;
+
+    // audio thread
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+private:
+    static constexpr int numChannels = 2;  // what the plugins see
+    static constexpr int maxChannels = 8;  // what the delay covers
+    static constexpr double maxCompensationSeconds = 1.0;
+
+    void processChunk(float* const* channels, int numSamples);
+    void delayChunk(float* const* channels, int numBusChannels, int numSamples);
+    bool preparePlugin(juce::AudioPluginInstance& plugin);
+
+    void audioProcessorParameterChanged(juce::AudioProcessor*, int, float) override {}
+    void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails& details) override;
+    void handleAsyncUpdate() override;
+
+    double sampleRate = 0.0;
+    int maxBlockSize = 0;
+
+    // owned here; the audio thread uses them only while holding chainLock
+    std::array<std::unique_ptr<juce::AudioPluginInstance>, numSlots> plugins;
+    std::array<std::atomic<bool>, numSlots> bypassed{};
+    juce::SpinLock chainLock;
+    juce::MidiBuffer midi;
+
+    std::atomic<int> compensationDelay{ 0 };
+    std::atomic<int> pluginLatency{ 0 }; // extra delay for the channels past the plugins' pair
+    juce::AudioBuffer<float> delayLine;
+    int delayWritePos = 0;
+    int delayedChannels = numChannels; // audio thread: channels the ring holds history for
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InsertChain)
+};
@@ -0,0 +1,194 @@
+#include "InsertChainButton.h"
+
+namespace
+{
+    // menu ids: slot * slotIdRange + (action or firstPluginId + plugin index)
+    constexpr int slotIdRange = 10000;
+    constexpr int removeId = 1;
+    constexpr int bypassId = 2;
+    constexpr int editorId = 3;
+    constexpr int firstPluginId = 100;
+    constexpr int scanId = InsertChain::numSlots * slotIdRange + 1;
+}
+
+class InsertChainButton::EditorWindow : public juce::DocumentWindow
+{
+public:
+    EditorWindow(juce::AudioPluginInstance& plugin, std::function<void()> onClose)
+        : juce::DocumentWindow(plugin.getName(), juce::Colours::darkgrey, juce::DocumentWindow::closeButton),
+          close(std::move(onClose))
+    {
+        juce::AudioProcessorEditor* editor = plugin.hasEditor() ? plugin.createEditorIfNeeded() : nullptr;
+        if (editor == nullptr)
+            editor = new juce::GenericAudioProcessorEditor(plugin);
+
+        setUsingNativeTitleBar(true);
+        setContentOwned(editor, true);
+        setResizable(editor->isResizable(), false);
+        centreWithSize(getWidth(), getHeight());
+        setVisible(true);
+    }
+
+    // the owner deletes this window
+    void closeButtonPressed() override { close(); }
+
+private:
+    std::function<void()> close;
+};
+
+InsertChainButton::InsertChainButton(InsertChain& chainToEdit)
+    : chain(chainToEdit)
+{
+    PluginHost::getInstance()->addChangeListener(this);
+    updateText();
+}
+
+InsertChainButton::~InsertChainButton()
+{
+    if (auto* host = PluginHost::getInstanceWithoutCreating())
+        host->removeChangeListener(this);
+
+    // editors go before the plugins they belong to
+    for (auto& e : editors)
+        e.reset();
+}
+
+void InsertChainButton::updateText()
+{
+    int used = 0;
+    for (int slot = 0; slot < InsertChain::numSlots; ++slot)
+        if (chain.getPlugin(slot) != nullptr)
+            ++used;
+
+    setButtonText(used > 0 ? "FX (" + juce::String(used) + ")" : "FX");
+    setTooltip(PluginHost::getInstance()->isScanning() ? "Scanning for plugins..." : juce::String());
+}
+
+void InsertChainButton::clicked()
+{
+    auto* host = PluginHost::getInstance();
+    const auto effects = host->getEffects();
+
+    juce::PopupMenu menu;
+
+    for (int slot = 0; slot < InsertChain::numSlots; ++slot)
+    {
+        auto* plugin = chain.getPlugin(slot);
+        const int base = slot * slotIdRange;
+
+        juce::PopupMenu slotMenu;
+        for (int i = 0; i < effects.size(); ++i)
+            slotMenu.addItem(base + firstPluginId + i, effects[i].name + " (" + effects[i].pluginFormatName + ")");
+
+        if (effects.isEmpty())
+            slotMenu.addItem(base + firstPluginId, "No plugins found", false);
+
+        if (plugin != nullptr)
+        {
+            slotMenu.addSeparator();
+            slotMenu.addItem(base + editorId, "Show editor");
+            slotMenu.addItem(base + bypassId, "Bypass", true, chain.isBypassed(slot));
+            slotMenu.addItem(base + removeId, "Remove");
+        }
+
+        menu.addSubMenu(juce::String(slot + 1) + ": " + (plugin != nullptr ? plugin->getName() : juce::String("(empty)")),
+                        slotMenu);
+    }
+
+    menu.addSeparator();
+    menu.addItem(scanId, host->isScanning() ? "Scanning for plugins..." : "Scan for plugins", !host->isScanning());
+
+    juce::WeakReference<InsertChainButton> weakThis(this);
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this),
+        [weakThis, effects](int result)
+        {
+            if (auto* self = weakThis.get())
+                self->menuItemChosen(result, effects);
+        });
+}
+
+void InsertChainButton::menuItemChosen(int result, const juce::Array<juce::PluginDescription>& effects)
+{
+    if (result <= 0)
+        return;
+
+    if (result == scanId)
+    {
+        PluginHost::getInstance()->startScan();
+        return;
+    }
+
+    const int slot = result / slotIdRange;
+    const int item = result % slotIdRange;
+
+    if (item == removeId)
+        removePlugin(slot);
+    else if (item == bypassId)
+        chain.setBypassed(slot, !chain.isBypassed(slot));
+    else if (item == editorId)
+        showEditor(slot);
+    else if (juce::isPositiveAndBelow(item - firstPluginId, effects.size()))
+        loadPlugin(slot, effects.getReference(item - firstPluginId));
+}
+
+void InsertChainButton::loadPlugin(int slot, const juce::PluginDescription& description)
+{
+    // a chain that isn't prepared yet gets its plugins prepared when it is
+    const double sampleRate = chain.getSampleRate() > 0.0 ? chain.getSampleRate() : 44100.0;
+    const int blockSize = chain.getMaximumBlockSize() > 0 ? chain.getMaximumBlockSize() : 512;
+
+    juce::WeakReference<InsertChainButton> weakThis(this);
+    PluginHost::getInstance()->createInstance(description, sampleRate, blockSize,
+        [weakThis, slot, name = description.name](std::unique_ptr<juce::AudioPluginInstance> instance, const juce::String& error)
+        {
+            auto* self = weakThis.get();
+            if (self == nullptr)
+                return;
+
+            if (instance == nullptr)
+            {
+                juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "FX",
+                                                       "Couldn't load " + name + ":\n" + error);
+                return;
+            }
+
+            self->editors[(size_t) slot].reset();
+
+            if (!self->chain.setPlugin(slot, std::move(instance)))
+                juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "FX",
+                                                       name + " can't process stereo audio.");
+
+            self->updateText();
+        });
+}
+
+void InsertChainButton::removePlugin(int slot)
+{
+    editors[(size_t) slot].reset();
+    chain.setPlugin(slot, nullptr);
+    updateText();
+}
+
+void InsertChainButton::showEditor(int slot)
+{
+    auto* plugin = chain.getPlugin(slot);
+    if (plugin == nullptr)
+        return;
+
+    if (editors[(size_t) slot] != nullptr)
+    {
+        editors[(size_t) slot]->toFront(true);
+        return;
+    }
+
+    juce::WeakReference<InsertChainButton> weakThis(this);
+    editors[(size_t) slot] = std::make_unique<EditorWindow>(*plugin, [weakThis, slot]
+    {
+        // deleting the window from inside its own callback isn't safe, so do it afterwards
+        juce::MessageManager::callAsync([weakThis, slot]
+        {
+            if (auto* self = weakThis.get())
+                self->editors[(size_t) slot].reset();
+        });
+    });
+}
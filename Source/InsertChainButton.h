@@ -0,0 +1,33 @@
+#pragma once
+#include <JuceHeader.h>
+#include "InsertChain.h"
+#include "PluginHost.h"
+#include <array>
+
+// "FX" button that edits an InsertChain from a popup menu: choose a plugin for each slot,
+// bypass or remove it, open its editor, or rescan the installed plugins.
+class InsertChainButton : public juce::TextButton,
+                          private juce::ChangeListener
+{
+public:
+    explicit InsertChainButton(InsertChain& chainToEdit);
+    ~InsertChainButton() override;
+
+private:
+    class EditorWindow;
+
+    void clicked() override;
+    void changeListenerCallback(juce::ChangeBroadcaster*) override { updateText(); }
+
+    void menuItemChosen(int result, const juce::Array<juce::PluginDescription>& effects);
+    void loadPlugin(int slot, const juce::PluginDescription& description);
+    void removePlugin(int slot);
+    void showEditor(int slot);
+    void updateText();
+
+    InsertChain& chain;
+    std::array<std::unique_ptr<EditorWindow>, InsertChain::numSlots> editors;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(InsertChainButton)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InsertChainButton)
+};
@@ -0,0 +1,297 @@
+#include "JobScheduler.h"
+
+static constexpr size_t kMaxRecentStats = 256;
+
+//==============================================================================
+class JobScheduler::Worker : public juce::Thread
+{
+public:
+    Worker(JobScheduler& owner, int workerIndex)
+        : juce::Thread("Analysis worker " + juce::String(workerIndex + 1)),
+          scheduler(owner),
+          index(workerIndex)
+    {
+    }
+
+    void run() override
+    {
+        currentWorker = this;
+
+        while (!threadShouldExit())
+        {
+            // note how much work had been pushed before looking, so anything pushed while
+            // we look wakes us again, but work we couldn't find (taken by another worker
+            // that hasn't started it yet) doesn't keep us spinning
+            juce::uint64 pushedBefore;
+            {
+                std::lock_guard<std::mutex> sl(scheduler.sleepMutex);
+                pushedBefore = scheduler.workPushed;
+            }
+
+            if (auto job = scheduler.findWork(index))
+            {
+                scheduler.run(*job, *this);
+                continue;
+            }
+
+            // the timeout only matters if a steal lost its try-lock race; the owner drains its own queue anyway
+            std::unique_lock<std::mutex> sl(scheduler.sleepMutex);
+            scheduler.wakeUp.wait_for(sl, std::chrono::milliseconds(100),
+                                      [this, pushedBefore] { return scheduler.workPushed != pushedBefore || threadShouldExit(); });
+        }
+    }
+
+    void push(std::unique_ptr<Job> job)
+    {
+        const juce::ScopedLock sl(queueLock);
+        queues[(int) job->priority].push_back(std::move(job));
+    }
+
+    // own work comes off the back (most recently pushed, still warm in cache)...
+    std::unique_ptr<Job> popOwn(int priority)
+    {
+        const juce::ScopedLock sl(queueLock);
+        auto& q = queues[priority];
+        if (q.empty())
+            return nullptr;
+
+        auto job = std::move(q.back());
+        q.pop_back();
+        return job;
+    }
+
+    // ...thieves take the oldest job from the front
+    std::unique_ptr<Job> steal(int priority)
+    {
+        const juce::ScopedTryLock sl(queueLock);
+        if (!sl.isLocked())
+            return nullptr;
+
+        auto& q = queues[priority];
+        if (q.empty())
+            return nullptr;
+
+        auto job = std::move(q.front());
+        q.pop_front();
+        return job;
+    }
+
+    void clear()
+    {
+        const juce::ScopedLock sl(queueLock);
+        for (auto& q : queues)
+            q.clear();
+    }
+
+    static thread_local Worker* currentWorker;
+
+    JobScheduler& scheduler;
+    const int index;
+
+private:
+    juce::CriticalSection queueLock;
+    std::deque<std::unique_ptr<Job>> queues[numPriorities];
+};
+
+thread_local JobScheduler::Worker* JobScheduler::Worker::currentWorker = nullptr;
+
+//==============================================================================
+bool JobScheduler::Context::shouldStop() const
+{
+    return cancelled.load(std::memory_order_relaxed) || thread.threadShouldExit();
+}
+
+//==============================================================================
+JUCE_IMPLEMENT_SINGLETON(JobScheduler)
+
+JobScheduler::JobScheduler()
+{
+    // leave a core for the audio and message threads
+    const int numWorkers = juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add(new Worker(*this, i));
+
+    for (auto* w : workers)
+        w->startThread(juce::Thread::Priority::low);
+}
+
+JobScheduler::~JobScheduler()
+{
+    for (auto* w : workers)
+        w->signalThreadShouldExit();
+
+    wakeUp.notify_all();
+
+    for (auto* w : workers)
+        w->stopThread(4000);
+
+    for (auto* w : workers)
+        w->clear();
+
+    clearSingletonInstance();
+}
+
+JobScheduler::GroupId JobScheduler::createGroup()
+{
+    const juce::ScopedLock sl(groupLock);
+    groups[++lastGroupId] = std::make_shared<Group>();
+    return lastGroupId;
+}
+
+void JobScheduler::cancelGroup(GroupId group, bool waitForRunningJobs)
+{
+    std::shared_ptr<Group> g;
+
+    {
+        const juce::ScopedLock sl(groupLock);
+        auto it = groups.find(group);
+        if (it == groups.end())
+            return;
+
+        g = it->second;
+        groups.erase(it);
+    }
+
+    std::unique_lock<std::mutex> sl(g->mutex);
+    g->cancelled = true;
+
+    if (waitForRunningJobs)
+        g->finished.wait(sl, [&g] { return g->running == 0; });
+}
+
+void JobScheduler::schedule(const juce::String& name, Priority priority, GroupId group, Work work)
+{
+    auto job = std::make_unique<Job>();
+    job->name = name;
+    job->priority = priority;
+    job->work = std::move(work);
+    job->queuedAt = juce::Time::getMillisecondCounterHiRes();
+
+    {
+        const juce::ScopedLock sl(groupLock);
+        auto it = groups.find(group);
+
+        if (it != groups.end())
+            job->group = it->second;
+        else if (group == noGroup)
+            job->group = std::make_shared<Group>();
+        else
+            return; // the group was already cancelled
+    }
+
+    // jobs spawned by a running job stay on that worker; others are spread round-robin
+    auto* target = Worker::currentWorker != nullptr && &Worker::currentWorker->scheduler == this
+                 ? Worker::currentWorker
+                 : workers[nextWorker.fetch_add(1) % workers.size()];
+
+    ++queuedJobs;
+    target->push(std::move(job));
+
+    // bumped after the push, so a worker woken by it can find the job
+    {
+        std::lock_guard<std::mutex> sl(sleepMutex);
+        ++workPushed;
+    }
+
+    wakeUp.notify_one();
+}
+
+// Highest priority first; at each level try our own deque, then steal from the others.
+std::unique_ptr<JobScheduler::Job> JobScheduler::findWork(int workerIndex)
+{
+    for (int p = 0; p < numPriorities; ++p)
+    {
+        if (auto job = workers[workerIndex]->popOwn(p))
+            return job;
+
+        for (int i = 1; i < workers.size(); ++i)
+            if (auto job = workers[(workerIndex + i) % workers.size()]->steal(p))
+                return job;
+    }
+
+    return nullptr;
+}
+
+void JobScheduler::run(Job& job, const juce::Thread& worker)
+{
+    --queuedJobs;
+
+    JobStats stats;
+    stats.name = job.name;
+    stats.priority = job.priority;
+
+    auto started = juce::Time::getMillisecondCounterHiRes();
+    stats.waitMs = started - job.queuedAt;
+
+    auto& group = *job.group;
+    bool starting;
+
+    {
+        std::lock_guard<std::mutex> sl(group.mutex);
+        starting = !group.cancelled.load();
+        if (starting)
+            ++group.running;
+    }
+
+    if (!starting)
+    {
+        stats.cancelled = true;
+    }
+    else
+    {
+        job.work(Context(group.cancelled, worker));
+
+        {
+            std::lock_guard<std::mutex> sl(group.mutex);
+            if (--group.running == 0)
+                group.finished.notify_all();
+        }
+
+        stats.cancelled = group.cancelled.load();
+        stats.runMs = juce::Time::getMillisecondCounterHiRes() - started;
+    }
+
+    recordStats(std::move(stats));
+}
+
+void JobScheduler::recordStats(JobStats stats)
+{
+    const juce::ScopedLock sl(statsLock);
+
+    if (stats.cancelled)
+        ++cancelledJobs;
+    else
+        ++completedJobs;
+
+    recentStats.push_back(std::move(stats));
+    if (recentStats.size() > kMaxRecentStats)
+        recentStats.pop_front();
+}
+
+std::vector<JobScheduler::JobStats> JobScheduler::getRecentStats() const
+{
+    const juce::ScopedLock sl(statsLock);
+    return { recentStats.begin(), recentStats.end() };
+}
+
+juce::String JobScheduler::getStatsSummary() const
+{
+    const juce::ScopedLock sl(statsLock);
+
+    double totalRun = 0.0, totalWait = 0.0;
+    for (auto& s : recentStats)
+    {
+        totalRun += s.runMs;
+        totalWait += s.waitMs;
+    }
+
+    auto n = juce::jmax((size_t) 1, recentStats.size());
+
+    return juce::String(workers.size()) + " workers, "
+         + juce::String(queuedJobs.load()) + " queued, "
+         + juce::String(completedJobs) + " done, "
+         + juce::String(cancelledJobs) + " cancelled, avg wait "
+         + juce::String(totalWait / (double) n, 1) + " ms, avg run "
+         + juce::String(totalRun / (double) n, 1) + " ms";
+}
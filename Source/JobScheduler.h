@@ -0,0 +1,118 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+
+// Shared pool for all background analysis (decoding, indexing, loudness, waveforms, tags).
+// One worker per spare core, each with its own per-priority deques; idle workers steal
+// from the others, so the app never runs more analysis threads than it has cores.
+//
+// Jobs belong to a group (usually "everything for the track on deck X"): cancelling the
+// group skips its queued jobs and tells running ones to stop at their next check.
+class JobScheduler : public juce::DeletedAtShutdown
+{
+public:
+    enum class Priority
+    {
+        loadedTrack = 0, // the file a deck has loaded
+        visibleRow,      // playlist rows on screen
+        library          // everything else
+    };
+
+    static constexpr int numPriorities = 3;
+
+    using GroupId = juce::int64;
+    static constexpr GroupId noGroup = 0;
+
+    class Context
+    {
+    public:
+        // true once the job's group was cancelled or the app is shutting down
+        bool shouldStop() const;
+
+    private:
+        friend class JobScheduler;
+        Context(const std::atomic<bool>& groupCancelled, const juce::Thread& worker)
+            : cancelled(groupCancelled), thread(worker) {}
+
+        const std::atomic<bool>& cancelled;
+        const juce::Thread& thread;
+    };
+
+    using Work = std::function<void(const Context&)>;
+
+    struct JobStats
+    {
+        juce::String name;
+        Priority priority = Priority::library;
+        double waitMs = 0.0;   // time spent queued
+        double runMs = 0.0;    // time spent running
+        bool cancelled = false;
+    };
+
+    JobScheduler();
+    ~JobScheduler() override;
+
+    GroupId createGroup();
+
+    // Cancels queued and running jobs of the group. With waitForRunningJobs, blocks until
+    // none of its jobs is still executing (use before destroying state the jobs touch).
+    void cancelGroup(GroupId group, bool waitForRunningJobs = false);
+
+    void schedule(const juce::String& name, Priority priority, GroupId group, Work work);
+
+    int getNumWorkers() const { return workers.size(); }
+    std::vector<JobStats> getRecentStats() const;
+    juce::String getStatsSummary() const;
+
+    JUCE_DECLARE_SINGLETON(JobScheduler, false)
+
+private:
+    // cancelled is only set, and running only changed, with the mutex held: a job either
+    // starts before cancelGroup() sets the flag (and is waited for) or never starts
+    struct Group
+    {
+        std::atomic<bool> cancelled{ false };
+        int running = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    struct Job
+    {
+        juce::String name;
+        Priority priority;
+        std::shared_ptr<Group> group;
+        Work work;
+        double queuedAt;
+    };
+
+    class Worker;
+
+    std::unique_ptr<Job> findWork(int workerIndex);
+    void run(Job& job, const juce::Thread& worker);
+    void recordStats(JobStats stats);
+
+    juce::OwnedArray<Worker> workers;
+    std::atomic<int> nextWorker{ 0 };
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<int> queuedJobs{ 0 };
+    juce::uint64 workPushed = 0; // bumped under sleepMutex by every schedule()
+
+    juce::CriticalSection groupLock;
+    std::map<GroupId, std::shared_ptr<Group>> groups;
+    GroupId lastGroupId = noGroup;
+
+    mutable juce::CriticalSection statsLock;
+    std::deque<JobStats> recentStats;
+    int completedJobs = 0;
+    int cancelledJobs = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JobScheduler)
+};
@@ -0,0 +1,273 @@
+#include "Loudness.h"
+
+namespace
+{
+    constexpr double kAbsoluteGateLufs = -70.0;
+
+    double energyToLufs(double meanSquare)
+    {
+        return meanSquare > 0.0 ? -0.691 + 10.0 * std::log10(meanSquare) : -200.0;
+    }
+
+    double lufsToEnergy(double lufs)
+    {
+        return std::pow(10.0, (lufs + 0.691) / 10.0);
+    }
+
+    // Mean energy of the blocks above the absolute gate and a gate relative to their own mean.
+    double gatedMean(const std::vector<double>& blocks, double relativeGateLu, std::vector<double>* survivors = nullptr)
+    {
+        const double absoluteGate = lufsToEnergy(kAbsoluteGateLufs);
+
+        double sum = 0.0;
+        int count = 0;
+        for (auto e : blocks)
+            if (e >= absoluteGate) { sum += e; ++count; }
+
+        if (count == 0)
+            return 0.0;
+
+        const double gate = juce::jmax(absoluteGate, lufsToEnergy(energyToLufs(sum / count) + relativeGateLu));
+
+        sum = 0.0;
+        count = 0;
+        for (auto e : blocks)
+        {
+            if (e >= gate)
+            {
+                sum += e;
+                ++count;
+                if (survivors != nullptr)
+                    survivors->push_back(energyToLufs(e));
+            }
+        }
+
+        return count > 0 ? sum / count : 0.0;
+    }
+}
+
+//==============================================================================
+float LoudnessResult::getNormalizationGain(double targetLufs) const
+{
+    if (integratedLufs <= kAbsoluteGateLufs)
+        return 1.0f; // silence: leave it alone
+
+    auto gainDb = juce::jmin(targetLufs - integratedLufs, -1.0 - truePeakDb);
+    return juce::Decibels::decibelsToGain((float) gainDb);
+}
+
+juce::String LoudnessResult::toString() const
+{
+    return juce::String(integratedLufs, 2) + ";" + juce::String(truePeakDb, 2) + ";" + juce::String(loudnessRange, 2);
+}
+
+bool LoudnessResult::fromString(const juce::String& text, LoudnessResult& result)
+{
+    auto parts = juce::StringArray::fromTokens(text, ";", "");
+    if (parts.size() != 3)
+        return false;
+
+    result.integratedLufs = parts[0].getDoubleValue();
+    result.truePeakDb = parts[1].getDoubleValue();
+    result.loudnessRange = parts[2].getDoubleValue();
+    return true;
+}
+
+//==============================================================================
+LoudnessMeter::LoudnessMeter(double sampleRate, int channels)
+    : numChannels(juce::jmax(1, channels)),
+      z1((size_t) numChannels), z2((size_t) numChannels), z3((size_t) numChannels), z4((size_t) numChannels),
+      subBlockLength(juce::jmax(1, (int) (sampleRate * 0.1)))
+{
+    // K-weighting (BS.1770-4): high-shelf "pre-filter" then the RLB high-pass,
+    // re-derived for the file's sample rate rather than the 48 kHz table values
+    {
+        const double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const double vh = std::pow(10.0, gainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+
+        preFilter.b0 = (vh + vb * k / q + k * k) / a0;
+        preFilter.b1 = 2.0 * (k * k - vh) / a0;
+        preFilter.b2 = (vh - vb * k / q + k * k) / a0;
+        preFilter.a1 = 2.0 * (k * k - 1.0) / a0;
+        preFilter.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    {
+        const double f0 = 38.13547087602444, q = 0.5003270373238773;
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+
+        rlbFilter.b0 = 1.0;
+        rlbFilter.b1 = -2.0;
+        rlbFilter.b2 = 1.0;
+        rlbFilter.a1 = 2.0 * (k * k - 1.0) / a0;
+        rlbFilter.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    // 5.1 ordering: L R C LFE Ls Rs - LFE is excluded, surrounds get +1.5 dB
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        double w = 1.0;
+        if (numChannels >= 6 && ch == 3) w = 0.0;
+        if (numChannels >= 6 && (ch == 4 || ch == 5)) w = 1.41;
+        channelWeights.push_back(w);
+    }
+
+    // windowed-sinc interpolator, each phase normalised to unity DC gain
+    const int totalTaps = oversampling * tapsPerPhase;
+    interpolator.resize((size_t) totalTaps);
+    const double centre = (totalTaps - 1) / 2.0;
+
+    for (int n = 0; n < totalTaps; ++n)
+    {
+        double x = (n - centre) / oversampling;
+        double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+        double window = 0.5 - 0.5 * std::cos(2.0 * juce::MathConstants<double>::pi * (n + 0.5) / totalTaps);
+        interpolator[(size_t) n] = (float) (sinc * window);
+    }
+
+    for (int p = 0; p < oversampling; ++p)
+    {
+        float sum = 0.0f;
+        for (int k = 0; k < tapsPerPhase; ++k)
+            sum += interpolator[(size_t) (p + k * oversampling)];
+
+        if (sum != 0.0f)
+            for (int k = 0; k < tapsPerPhase; ++k)
+                interpolator[(size_t) (p + k * oversampling)] /= sum;
+    }
+
+    history.assign((size_t) numChannels, std::vector<float>((size_t) tapsPerPhase, 0.0f));
+}
+
+void LoudnessMeter::process(const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const int channels = juce::jmin(numChannels, buffer.getNumChannels());
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        double weightedSum = 0.0;
+
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            const float sample = buffer.getReadPointer(ch)[i];
+            const double x = sample;
+
+            // two transposed direct form II biquads
+            const double y = preFilter.b0 * x + z1[(size_t) ch];
+            z1[(size_t) ch] = preFilter.b1 * x - preFilter.a1 * y + z2[(size_t) ch];
+            z2[(size_t) ch] = preFilter.b2 * x - preFilter.a2 * y;
+
+            const double w = rlbFilter.b0 * y + z3[(size_t) ch];
+            z3[(size_t) ch] = rlbFilter.b1 * y - rlbFilter.a1 * w + z4[(size_t) ch];
+            z4[(size_t) ch] = rlbFilter.b2 * y - rlbFilter.a2 * w;
+
+            weightedSum += channelWeights[(size_t) ch] * w * w;
+
+            // true peak: evaluate the 4 interpolated points between this sample and the last
+            auto& hist = history[(size_t) ch];
+            hist[(size_t) historyPos] = sample;
+
+            for (int p = 0; p < oversampling; ++p)
+            {
+                float acc = 0.0f;
+                for (int k = 0; k < tapsPerPhase; ++k)
+                    acc += interpolator[(size_t) (p + k * oversampling)] * hist[(size_t) ((historyPos - k + tapsPerPhase) % tapsPerPhase)];
+
+                peak = juce::jmax(peak, std::abs(acc));
+            }
+
+            peak = juce::jmax(peak, std::abs(sample));
+        }
+
+        historyPos = (historyPos + 1) % tapsPerPhase;
+        subBlockEnergy += weightedSum;
+
+        if (++subBlockFill == subBlockLength)
+            finishSubBlock();
+    }
+}
+
+void LoudnessMeter::finishSubBlock()
+{
+    subBlocks.push_back(subBlockEnergy / subBlockLength);
+    subBlockEnergy = 0.0;
+    subBlockFill = 0;
+}
+
+LoudnessResult LoudnessMeter::getResult() const
+{
+    LoudnessResult result;
+
+    // momentary blocks: 400 ms (4 slices) with 75% overlap
+    std::vector<double> momentary;
+    for (size_t i = 3; i < subBlocks.size(); ++i)
+        momentary.push_back((subBlocks[i - 3] + subBlocks[i - 2] + subBlocks[i - 1] + subBlocks[i]) / 4.0);
+
+    auto integrated = gatedMean(momentary, -10.0);
+    result.integratedLufs = integrated > 0.0 ? energyToLufs(integrated) : kAbsoluteGateLufs;
+
+    // loudness range (EBU Tech 3342): 3 s short-term blocks, -20 LU relative gate, 10th..95th percentile
+    std::vector<double> shortTerm;
+    double running = 0.0;
+    for (size_t i = 0; i < subBlocks.size(); ++i)
+    {
+        running += subBlocks[i];
+        if (i >= 30)
+            running -= subBlocks[i - 30];
+        if (i >= 29)
+            shortTerm.push_back(running / 30.0);
+    }
+
+    std::vector<double> gated;
+    gatedMean(shortTerm, -20.0, &gated);
+
+    if (gated.size() >= 2)
+    {
+        std::sort(gated.begin(), gated.end());
+        auto percentile = [&gated](double p) { return gated[(size_t) juce::roundToInt(p * (double) (gated.size() - 1))]; };
+        result.loudnessRange = percentile(0.95) - percentile(0.10);
+    }
+
+    result.truePeakDb = peak > 0.0f ? juce::Decibels::gainToDecibels((double) peak, -100.0) : -100.0;
+    return result;
+}
+
+bool LoudnessMeter::measure(juce::AudioFormatReader& reader, LoudnessResult& result, std::function<bool()> shouldStop)
+{
+    LoudnessMeter meter(reader.sampleRate, (int) reader.numChannels);
+    juce::AudioBuffer<float> buffer((int) reader.numChannels, 65536);
+
+    for (juce::int64 pos = 0; pos < reader.lengthInSamples; pos += buffer.getNumSamples())
+    {
+        if (shouldStop != nullptr && shouldStop())
+            return false;
+
+        auto n = (int) juce::jmin((juce::int64) buffer.getNumSamples(), reader.lengthInSamples - pos);
+        reader.read(&buffer, 0, n, pos, true, true);
+        meter.process(buffer, n);
+    }
+
+    result = meter.getResult();
+    return true;
+}
+
+//==============================================================================
+JUCE_IMPLEMENT_SINGLETON(LoudnessCache)
+
+LoudnessCache::LoudnessCache()
+    : AnalysisCache("loudness", "Loudness",
+                    [](juce::AudioFormatReader& reader, LoudnessResult& result, const JobScheduler::Context& context)
+                    {
+                        return LoudnessMeter::measure(reader, result, [&context] { return context.shouldStop(); });
+                    })
+{
+}
+
+LoudnessCache::~LoudnessCache()
+{
+    clearSingletonInstance();
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AnalysisCache.h"
+#include <functional>
+
+// EBU R128 / ITU-R BS.1770 measurements for one track.
+struct LoudnessResult
+{
+    double integratedLufs = -70.0;
+    double truePeakDb = -100.0;
+    double loudnessRange = 0.0; // LU
+
+    // Gain (linear) that brings the track to targetLufs without pushing the
+    // true peak above -1 dBTP, ReplayGain 2 style.
+    float getNormalizationGain(double targetLufs) const;
+
+    juce::String toString() const;
+    static bool fromString(const juce::String& text, LoudnessResult& result);
+};
+
+// Streams audio through K-weighting, 400 ms / 3 s gated blocks and a 4x oversampled peak
+// detector. Feed it the whole track, then call getResult().
+class LoudnessMeter
+{
+public:
+    LoudnessMeter(double sampleRate, int numChannels);
+
+    void process(const juce::AudioBuffer<float>& buffer, int numSamples);
+    LoudnessResult getResult() const;
+
+    // Runs a meter over an entire reader; returns false if shouldStop() asked it to bail out.
+    static bool measure(juce::AudioFormatReader& reader, LoudnessResult& result, std::function<bool()> shouldStop);
+
+private:
+    struct Biquad
+    {
+        double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    };
+
+    void finishSubBlock();
+
+    int numChannels;
+    Biquad preFilter, rlbFilter;
+    std::vector<double> z1, z2, z3, z4;   // per-channel filter state (two stages)
+    std::vector<double> channelWeights;
+
+    int subBlockLength;                    // 100 ms
+    int subBlockFill = 0;
+    double subBlockEnergy = 0.0;
+    std::vector<double> subBlocks;         // mean-square energy of each 100 ms slice
+
+    // true-peak: 4x polyphase interpolator
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 12;
+    std::vector<float> interpolator;       // oversampling * tapsPerPhase coefficients
+    std::vector<std::vector<float>> history;
+    int historyPos = 0;
+    float peak = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessMeter)
+};
+
+// Process-wide loudness analysis (see AnalysisCache), plus the level decks normalize to.
+class LoudnessCache : public AnalysisCache<LoudnessResult>,
+                      public juce::DeletedAtShutdown
+{
+public:
+    LoudnessCache();
+    ~LoudnessCache() override;
+
+    double getTargetLufs() const { return targetLufs; }
+    void setTargetLufs(double newTarget) { targetLufs = newTarget; }
+
+    JUCE_DECLARE_SINGLETON(LoudnessCache, false)
+
+private:
+    double targetLufs = -18.0; // ReplayGain 2 reference level
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessCache)
+};
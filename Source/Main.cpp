@@ -1,5 +1,7 @@
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "AppLog.h"
+#include "CodecRegistry.h"
 
 // Our application class
 class SimpleAudioPlayer : public juce::JUCEApplication
@@ -10,6 +12,12 @@ public:
 
     void initialise(const juce::String&) override
     {
+        AppLog::getInstance();
+        APP_LOG(general, info, "{} {} starting", getApplicationName(), getApplicationVersion());
+
+        // codecs are registered once, before any deck or background job opens a file
+        CodecRegistry::getInstance();
+
          // Create and show the main window
         mainWindow = std::make_unique<MainWindow>(getApplicationName());
     }
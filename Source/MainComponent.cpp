@@ -5,12 +5,93 @@ MainComponent::MainComponent()
     addAndMakeVisible(gui1);
     addAndMakeVisible(gui2);
 
-    setAudioChannels(0, 2);
+    // each deck's Sync follows the other one
+    gui1.setSyncMaster(&player2);
+    gui2.setSyncMaster(&player1);
+
+    player1.setClock(&clock);
+    player2.setClock(&clock);
+
+    // plugin latency differs per deck: delay the faster one so both stay beat-aligned
+    player1.getInserts().onLatencyChanged = [this] { updateLatencyCompensation(); };
+    player2.getInserts().onLatencyChanged = [this] { updateLatencyCompensation(); };
+    PluginHost::getInstance()->startScanIfNeverScanned();
+
+    masterMeter.setColours(juce::Colour::fromRGB(255, 215, 0), juce::Colours::black.withAlpha(0.35f));
+    addAndMakeVisible(masterMeter);
+
+    // how hard the limiter (and soft clipper) is working, under the master meter
+    gainReductionLabel.setJustificationType(juce::Justification::centred);
+    gainReductionLabel.setFont(juce::Font(11.0f));
+    gainReductionLabel.setTooltip("Master limiter gain reduction");
+    addAndMakeVisible(gainReductionLabel);
+
+    softClipButton.setTooltip("Round off master peaks before the limiter, for a louder, denser mix");
+    softClipButton.setToggleState(limiter.isSoftClipEnabled(), juce::dontSendNotification);
+    softClipButton.onClick = [this] { limiter.setSoftClipEnabled(softClipButton.getToggleState()); };
+    addAndMakeVisible(softClipButton);
+
+    // worker threads only help when there is more than one core to run them on, and they
+    // keep a core partly busy while playing, so they're opt-in
+    parallelButton.setToggleState(false, juce::dontSendNotification);
+    parallelButton.setEnabled(renderPool.canRunInParallel());
+    parallelButton.onClick = [this] { renderPool.setEnabled(parallelButton.getToggleState()); };
+    renderPool.setEnabled(parallelButton.getToggleState());
+    addAndMakeVisible(parallelButton);
+
+    addAndMakeVisible(routingStrip);
+
+    masterFxButton.setTooltip("Master effect inserts");
+    addAndMakeVisible(masterFxButton);
+
+    crossfaderSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    crossfaderSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    crossfaderSlider.setRange(0.0, 1.0);
+    crossfaderSlider.setValue(crossfader.load(), juce::dontSendNotification);
+    crossfaderSlider.setDoubleClickReturnValue(true, 0.5);
+    crossfaderSlider.onValueChange = [this] { crossfader = (float) crossfaderSlider.getValue(); };
+    addAndMakeVisible(crossfaderSlider);
+
+    midiButton.onClick = [this] { showMidiMenu(); };
+    addAndMakeVisible(midiButton);
+
+    // loads and speed changes from automation go through the deck's GUI, like a click would
+    controlServer.onLoad = [this](int deck, const juce::File& file) { (deck == 0 ? gui1 : gui2).loadTrack(file); };
+    controlServer.onSpeed = [this](int deck, double speed)
+    {
+        (deck == 0 ? player1 : player2).setResamplingRatio(speed);
+        (deck == 0 ? gui1 : gui2).updateFromPlayer();
+    };
+
+    // a controller moves the crossfader behind the slider's back
+    startTimerHz(30);
+
+    audioButton.onClick = [this] { showAudioSettings(); };
+    addAndMakeVisible(audioButton);
+
+    MemoryLimits::load().apply();
+    memoryButton.onClick = [this] { showMemoryPanel(); };
+    addAndMakeVisible(memoryButton);
+
+    // the device, rate and buffer size chosen last time (the default device otherwise)
+    juce::PropertiesFile::Options options;
+    options.applicationName = "SimpleAudioPlayer";
+    options.filenameSuffix = "audio";
+    options.folderName = "SimpleAudioPlayer";
+    options.osxLibrarySubFolder = "Application Support";
+    options.storageFormat = juce::PropertiesFile::storeAsXML;
+    audioSettings = std::make_unique<juce::PropertiesFile>(options);
+
+    auto savedDevice = audioSettings->getXmlValue("deviceState");
+    setAudioChannels(0, 4, savedDevice.get()); // master on 1/2, headphones on 3/4 if the device has them; more for surround tracks
+    deviceManager.addChangeListener(this);
     setSize(1500, 1200);
 
     // ✅ تحميل الجلسة السابقة
     player1.loadLastSession();
     player2.loadLastSession();
+    gui1.updateFromPlayer();
+    gui2.updateFromPlayer();
 }
 
 MainComponent::~MainComponent()
@@ -19,34 +100,265 @@ MainComponent::~MainComponent()
     player1.saveLastSession();
     player2.saveLastSession();
 
+    if (audioWindow != nullptr)
+        delete audioWindow.getComponent();
+
+    if (memoryWindow != nullptr)
+        delete memoryWindow.getComponent();
+
+    deviceManager.removeChangeListener(this);
     shutdownAudio();
 }
 
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
+    clock.setSampleRate(sampleRate);
+    callbackMonitor.reset();
+    masterTap.prepare(sampleRate);
+    limiter.prepare(sampleRate, samplesPerBlockExpected, OutputRouting::maxBusChannels);
+
+    for (auto& buffer : deckBuffers)
+        buffer.setSize(OutputRouting::maxBusChannels, samplesPerBlockExpected);
+
+    routing.prepare(samplesPerBlockExpected);
+
+    masterInserts.prepare(sampleRate, samplesPerBlockExpected);
+
     player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
     player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    updateLatencyCompensation();
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    juce::AudioBuffer<float> tempBuffer;
-    tempBuffer.setSize(bufferToFill.buffer->getNumChannels(), bufferToFill.numSamples);
-    juce::AudioSourceChannelInfo tempInfo(&tempBuffer, 0, bufferToFill.numSamples);
+    const int numChannels = bufferToFill.buffer->getNumChannels();
+    const int numSamples = bufferToFill.numSamples;
+
+    callbackMonitor.blockStarted();
+
+    // the latency test has the output to itself while it runs
+    if (latencyTester.process(*bufferToFill.buffer, bufferToFill.startSample, numSamples))
+    {
+        clock.advance(numSamples);
+        callbackMonitor.blockFinished(numSamples, clock.getSampleRate());
+        return;
+    }
+
+    // allocated in prepareToPlay; only grows if the device delivers more than it announced
+    for (auto& buffer : deckBuffers)
+        buffer.setSize(OutputRouting::maxBusChannels, numSamples, false, false, true);
+
+    renderPool.render(numSamples, player1.isPlaying() || player2.isPlaying());
+
+    const std::array<OutputRouting::DeckBus, 2> buses{ { { &deckBuffers[0], player1.getBusChannels(), &player1.getBusFold() },
+                                                         { &deckBuffers[1], player2.getBusChannels(), &player2.getBusFold() } } };
+
+    // crossfader: both decks at full level in the middle, each fades out over its far half
+    const float fade = crossfader.load();
+    const std::array<float, 2> faderGains{ juce::jmin(1.0f, 2.0f * (1.0f - fade)), juce::jmin(1.0f, 2.0f * fade) };
+
+    // the master is the device's first pair, or as many outputs as the widest deck's bus;
+    // a view onto them, so nothing is copied
+    const int numMasterChannels = juce::jmin(numChannels, juce::jmax(buses[0].numChannels, buses[1].numChannels));
+    juce::AudioBuffer<float> master(bufferToFill.buffer->getArrayOfWritePointers(), numMasterChannels,
+                                    bufferToFill.startSample, numSamples);
+
+    routing.mixDecks(buses, faderGains, master, numSamples);
+    masterInserts.process(master, 0, numSamples);
+
+    // decks sum at unity; the limiter keeps the result under the ceiling
+    limiter.process(master, 0, numSamples);
+    masterTap.push(master, 0, numSamples);
+
+    routing.renderHeadphones(*bufferToFill.buffer, numMasterChannels, bufferToFill.startSample, numSamples);
+
+    clock.advance(bufferToFill.numSamples);
+    callbackMonitor.blockFinished(numSamples, clock.getSampleRate());
+}
+
+// Called by the render pool, possibly on one of its worker threads.
+void MainComponent::renderDeck(int deck, int numSamples)
+{
+    juce::AudioSourceChannelInfo info(&deckBuffers[(size_t) deck], 0, numSamples);
+    (deck == 0 ? player1 : player2).getNextAudioBlock(info);
+}
 
-    player1.getNextAudioBlock(bufferToFill);
-    player2.getNextAudioBlock(tempInfo);
+void MainComponent::updateLatencyCompensation()
+{
+    auto& inserts1 = player1.getInserts();
+    auto& inserts2 = player2.getInserts();
+    const int slowest = juce::jmax(inserts1.getLatencySamples(), inserts2.getLatencySamples());
 
-    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
-        bufferToFill.buffer->addFrom(channel, bufferToFill.startSample, tempBuffer, channel, 0, bufferToFill.numSamples);
+    inserts1.setCompensationDelay(slowest - inserts1.getLatencySamples());
+    inserts2.setCompensationDelay(slowest - inserts2.getLatencySamples());
+}
+
+// A track wider than stereo gets an output per channel plus the headphone pair after
+// them, if the device has that many. Outputs are only ever added here, never taken away
+// from what the audio settings picked. The decks fold to stereo when they're short.
+void MainComponent::updateOutputChannels()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr)
+        return;
+
+    const int widest = juce::jmin(OutputRouting::maxBusChannels,
+                                  juce::jmax(player1.getSourceChannels(), player2.getSourceChannels()));
+    int active = device->getActiveOutputChannels().countNumberOfSetBits();
+
+    if (widest > OutputRouting::numBusChannels && active < widest + OutputRouting::numBusChannels)
+    {
+        const int wanted = juce::jmin(widest + OutputRouting::numBusChannels, device->getOutputChannelNames().size());
+
+        // asked once per width, so a device that refuses isn't asked again every tick
+        if (wanted > active && wanted != requestedOutputs)
+        {
+            requestedOutputs = wanted;
+
+            auto setup = deviceManager.getAudioDeviceSetup();
+            setup.outputChannels.setRange(0, wanted, true);
+            setup.useDefaultOutputChannels = false;
+
+            auto error = deviceManager.setAudioDeviceSetup(setup, true);
+            if (error.isNotEmpty())
+                APP_LOG(device, warning, "Couldn't open {} outputs: {}", wanted, error);
+
+            if ((device = deviceManager.getCurrentAudioDevice()) == nullptr)
+                return;
+
+            active = device->getActiveOutputChannels().countNumberOfSetBits();
+        }
+    }
+
+    player1.setOutputChannels(active);
+    player2.setOutputChannels(active);
+}
+
+void MainComponent::timerCallback()
+{
+    updateOutputChannels();
+
+    if (!crossfaderSlider.isMouseButtonDown())
+        crossfaderSlider.setValue(crossfader.load(), juce::dontSendNotification);
+
+    midiButton.setButtonText(midi.isLearning() ? "MIDI: move a control..." : "MIDI");
+
+    // peaks show at once and fall back over a few hundred milliseconds
+    shownReductionDb = juce::jmax(limiter.takeGainReductionDb(), shownReductionDb * 0.85f);
+    gainReductionLabel.setText(shownReductionDb >= 0.05f ? "-" + juce::String(shownReductionDb, 1) : juce::String("GR"),
+                               juce::dontSendNotification);
+}
+
+void MainComponent::showMidiMenu()
+{
+    using Action = MidiControlSurface::Action;
+
+    auto itemText = [this](int deck, Action action)
+    {
+        auto mapping = midi.describeMapping(deck, action);
+        return MidiControlSurface::getActionName(action) + (mapping.isNotEmpty() ? "  [" + mapping + "]" : juce::String());
+    };
+
+    // ids: 1 + deck * numActions + action
+    juce::PopupMenu menu;
+
+    for (int deck = 0; deck < MidiControlSurface::numDecks; ++deck)
+    {
+        juce::PopupMenu deckMenu;
+        for (auto action : { Action::playPause, Action::cue, Action::loop, Action::gain, Action::jog })
+            deckMenu.addItem(1 + deck * MidiControlSurface::numActions + (int) action, "Learn " + itemText(deck, action));
+
+        juce::PopupMenu cueMenu;
+        for (bool set : { false, true })
+            for (int cue = 0; cue < HotCueBank::numCues; ++cue)
+            {
+                auto action = MidiControlSurface::hotCueAction(cue, set);
+                cueMenu.addItem(1 + deck * MidiControlSurface::numActions + (int) action, "Learn " + itemText(deck, action));
+            }
+
+        deckMenu.addSubMenu("Hot cues", cueMenu);
+
+        menu.addSubMenu(deck == 0 ? "Deck A" : "Deck B", deckMenu);
+    }
+
+    menu.addItem(1 + (int) Action::crossfader, "Learn " + itemText(0, Action::crossfader));
+    menu.addSeparator();
+    menu.addItem(-1, "Cancel learning", midi.isLearning());
+    menu.addItem(-2, "Clear all mappings");
+
+    juce::Component::SafePointer<MainComponent> safeThis(this);
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&midiButton), [safeThis](int result)
+    {
+        if (safeThis == nullptr || result == 0)
+            return;
+
+        if (result == -1)
+            safeThis->midi.cancelLearning();
+        else if (result == -2)
+            safeThis->midi.clearMappings();
+        else
+            safeThis->midi.startLearning((result - 1) / MidiControlSurface::numActions,
+                                         (MidiControlSurface::Action) ((result - 1) % MidiControlSurface::numActions));
+    });
+}
+
+void MainComponent::showAudioSettings()
+{
+    if (audioWindow != nullptr)
+    {
+        audioWindow->toFront(true);
+        return;
+    }
+
+    juce::DialogWindow::LaunchOptions options;
+    options.content.setOwned(new AudioSettingsPanel(deviceManager, callbackMonitor, latencyTester));
+    options.dialogTitle = "Audio Settings";
+    options.dialogBackgroundColour = juce::Colours::darkgrey;
+    options.useNativeTitleBar = true;
+    options.resizable = true;
+    audioWindow = options.launchAsync();
+}
+
+void MainComponent::showMemoryPanel()
+{
+    if (memoryWindow != nullptr)
+    {
+        memoryWindow->toFront(true);
+        return;
+    }
+
+    juce::DialogWindow::LaunchOptions options;
+    options.content.setOwned(new MemoryPanel(gui1, gui2));
+    options.dialogTitle = "Memory";
+    options.dialogBackgroundColour = juce::Colours::darkgrey;
+    options.useNativeTitleBar = true;
+    options.resizable = true;
+    memoryWindow = options.launchAsync();
+}
+
+// the device setup changed (here or in the settings window): remember it for next time
+void MainComponent::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        APP_LOG(device, info, "Audio device: {} ({}), {} Hz, {} samples, {} outputs", device->getName(), device->getTypeName(),
+                device->getCurrentSampleRate(), device->getCurrentBufferSizeSamples(),
+                device->getActiveOutputChannels().countNumberOfSetBits());
 
-    bufferToFill.buffer->applyGain(0.5f);
+    if (auto state = deviceManager.createStateXml())
+    {
+        audioSettings->setValue("deviceState", state.get());
+        audioSettings->saveIfNeeded();
+    }
 }
 
 void MainComponent::releaseResources()
 {
+    latencyTester.cancel();
     player1.releaseResources();
     player2.releaseResources();
+    masterInserts.release();
+    limiter.reset();
 }
 
 void MainComponent::paint(juce::Graphics& g)
@@ -57,6 +369,26 @@ void MainComponent::paint(juce::Graphics& g)
 void MainComponent::resized()
 {
     auto area = getLocalBounds().reduced(10);
+    auto footer = area.removeFromBottom(24);
+    parallelButton.setBounds(footer.removeFromRight(140));
+    footer.removeFromRight(6);
+    softClipButton.setBounds(footer.removeFromRight(90));
+    footer.removeFromRight(6);
+    masterFxButton.setBounds(footer.removeFromRight(90));
+    footer.removeFromRight(6);
+    midiButton.setBounds(footer.removeFromRight(170));
+    footer.removeFromRight(6);
+    audioButton.setBounds(footer.removeFromRight(80));
+    footer.removeFromRight(6);
+    memoryButton.setBounds(footer.removeFromRight(90));
+    crossfaderSlider.setBounds(footer.withSizeKeepingCentre(juce::jmin(300, footer.getWidth()), footer.getHeight()));
+    area.removeFromBottom(4);
+    routingStrip.setBounds(area.removeFromBottom(24));
+    area.removeFromBottom(4);
+    auto masterColumn = area.removeFromRight(36);
+    gainReductionLabel.setBounds(masterColumn.removeFromBottom(18));
+    masterMeter.setBounds(masterColumn.withSizeKeepingCentre(14, masterColumn.getHeight()));
+    area.removeFromRight(6);
     auto top = area.removeFromTop(area.getHeight() / 2);
     gui1.setBounds(top);
     gui2.setBounds(area);
@@ -2,8 +2,20 @@
 #include <JuceHeader.h>
 #include "PlayerGUI.h"
 #include "PlayerAudio.h"
+#include "MasterLimiter.h"
+#include "DeckRenderPool.h"
+#include "InsertChainButton.h"
+#include "MidiControlSurface.h"
+#include "ControlServer.h"
+#include "AudioSettingsPanel.h"
+#include "MemoryPanel.h"
+#include "OutputRouting.h"
+#include "AppLog.h"
+#include <array>
 
-class MainComponent : public juce::AudioAppComponent
+class MainComponent : public juce::AudioAppComponent,
+                      private juce::Timer,
+                      private juce::ChangeListener
 {
 public:
     MainComponent();
@@ -17,11 +29,62 @@ public:
     void resized() override;
 
 private:
-    PlayerAudio player1;
+    void renderDeck(int deck, int numSamples);
+    void updateLatencyCompensation();
+    void updateOutputChannels();
+    void timerCallback() override;
+    void showMidiMenu();
+    void showAudioSettings();
+    void showMemoryPanel();
+    void changeListenerCallback(juce::ChangeBroadcaster*) override;
+
+    PlayerAudio player1{ "deckA" };
     PlayerGUI gui1{ player1 };
 
-    PlayerAudio player2;
+    PlayerAudio player2{ "deckB" };
     PlayerGUI gui2{ player2 };
 
+    AudioClock clock;
+    InsertChain masterInserts;
+    MasterLimiter limiter;
+    juce::ToggleButton softClipButton{ "Soft clip" };
+
+    // each deck renders into its own buffer, possibly on a worker thread, then they are mixed
+    std::array<juce::AudioBuffer<float>, 2> deckBuffers;
+    DeckRenderPool renderPool{ 2, [this](int deck, int numSamples) { renderDeck(deck, numSamples); } };
+    juce::ToggleButton parallelButton{ "Parallel decks" };
+    InsertChainButton masterFxButton{ masterInserts };
+
+    // decks to master and/or the headphone cue bus (outputs 3/4, or after a surround master)
+    OutputRouting routing;
+    RoutingStrip routingStrip{ routing };
+    int requestedOutputs = 0; // most device outputs asked for on behalf of a surround track
+
+    // 0 = deck A only, 1 = deck B only; set by the slider or a MIDI controller
+    std::atomic<float> crossfader{ 0.5f };
+    juce::Slider crossfaderSlider;
+    MidiControlSurface midi{ player1, player2, crossfader };
+    juce::TextButton midiButton{ "MIDI" };
+
+    // JSON automation over a local socket
+    ControlServer controlServer{ player1, player2, crossfader };
+
+    // device choice, saved whenever it changes; timing and latency diagnostics
+    std::unique_ptr<juce::PropertiesFile> audioSettings;
+    CallbackMonitor callbackMonitor;
+    LatencyTester latencyTester;
+    juce::TextButton audioButton{ "Audio..." };
+    juce::Component::SafePointer<juce::DialogWindow> audioWindow;
+
+    // per-deck memory and the shared caches' caps
+    juce::TextButton memoryButton{ "Memory..." };
+    juce::Component::SafePointer<juce::DialogWindow> memoryWindow;
+
+    // master output level, right of the decks
+    AudioTap masterTap;
+    LevelMeter masterMeter{ masterTap };
+    juce::Label gainReductionLabel;
+    float shownReductionDb = 0.0f;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "MappedPcmReader.h"
+#include "CodecRegistry.h"
+
+#if JUCE_LINUX || JUCE_BSD || JUCE_MAC || JUCE_ANDROID
+ #include <sys/mman.h>
+ #include <unistd.h>
+ #define SAP_HAS_MADVISE 1
+#else
+ #define SAP_HAS_MADVISE 0
+#endif
+
+// how far ahead of the read position we ask the kernel to page in
+static constexpr double kPrefetchWindowSeconds = 4.0;
+
+//==============================================================================
+// One thread for the whole process that gives the advice readers ask for. It polls rather
+// than being notified, so the audio thread never touches a lock or a syscall.
+class MappedPcmReader::Prefetcher : public juce::Thread,
+                                    public juce::DeletedAtShutdown
+{
+public:
+    Prefetcher()
+        : juce::Thread("Mapped file prefetch")
+    {
+        startThread(juce::Thread::Priority::normal);
+    }
+
+    ~Prefetcher() override
+    {
+        stopThread(2000);
+        clearSingletonInstance();
+    }
+
+    void add(MappedPcmReader* reader)
+    {
+        const juce::ScopedLock sl(lock);
+        readers.add(reader);
+    }
+
+    // once this returns the reader is never serviced again
+    void remove(MappedPcmReader* reader)
+    {
+        const juce::ScopedLock sl(lock);
+        readers.removeFirstMatchingValue(reader);
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            {
+                const juce::ScopedLock sl(lock);
+
+                for (auto* reader : readers)
+                    reader->servicePrefetch();
+            }
+
+            wait(50); // well inside the half window still paged in when a refresh is asked for
+        }
+    }
+
+    JUCE_DECLARE_SINGLETON(Prefetcher, false)
+
+private:
+    juce::CriticalSection lock;
+    juce::Array<MappedPcmReader*> readers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Prefetcher)
+};
+
+JUCE_IMPLEMENT_SINGLETON(MappedPcmReader::Prefetcher)
+
+//==============================================================================
+
+MappedPcmReader::MappedPcmReader(std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader,
+                                 std::unique_ptr<juce::MemoryMappedFile> hintMapping,
+                                 juce::int64 dataChunkStart)
+    : juce::AudioFormatReader(nullptr, mappedReader->getFormatName()),
+      source(std::move(mappedReader)),
+      hintMap(std::move(hintMapping)),
+      dataStart(dataChunkStart)
+{
+    sampleRate = source->sampleRate;
+    bitsPerSample = source->bitsPerSample;
+    lengthInSamples = source->lengthInSamples;
+    numChannels = source->numChannels;
+    usesFloatingPointData = source->usesFloatingPointData;
+    metadataValues = source->metadataValues;
+
+    bytesPerFrame = (juce::int64) numChannels * (juce::int64) (bitsPerSample / 8);
+    prefetchWindow = (juce::int64) (sampleRate * kPrefetchWindowSeconds);
+
+    // the first window is advised right here, at map time
+    prefetch(0);
+
+   #if SAP_HAS_MADVISE
+    if (hintMap != nullptr)
+    {
+        prefetcher = Prefetcher::getInstance();
+        prefetcher->add(this);
+    }
+   #endif
+}
+
+MappedPcmReader::~MappedPcmReader()
+{
+    if (prefetcher != nullptr)
+        prefetcher->remove(this);
+}
+
+std::unique_ptr<MappedPcmReader> MappedPcmReader::create(const juce::File& file)
+{
+    auto* format = CodecRegistry::getInstance()->findFormatFor(file);
+    if (format == nullptr)
+        return {};
+
+    // only WAV and AIFF implement this; compressed formats return nullptr
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+    if (mapped == nullptr || mapped->lengthInSamples <= 0 || !mapped->mapEntireFile())
+        return {};
+
+    std::unique_ptr<juce::MemoryMappedFile> hint;
+    auto dataChunkStart = findDataChunkStart(file);
+
+    if (dataChunkStart >= 0)
+    {
+        hint = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly, false);
+        if (hint->getData() == nullptr)
+            hint.reset();
+    }
+
+    return std::unique_ptr<MappedPcmReader>(new MappedPcmReader(std::move(mapped), std::move(hint), dataChunkStart));
+}
+
+bool MappedPcmReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                  juce::int64 startSampleInFile, int numSamples)
+{
+    // re-issue the hint after a seek, or once we've used up half of the current window
+    auto windowStart = prefetchedStart.load(std::memory_order_relaxed);
+    auto windowEnd = prefetchedEnd.load(std::memory_order_relaxed);
+    auto readEnd = juce::jmin(lengthInSamples, startSampleInFile + numSamples);
+
+    bool outsideWindow = startSampleInFile < windowStart || readEnd > windowEnd;
+    bool runningLow = windowEnd < lengthInSamples && readEnd + prefetchWindow / 2 > windowEnd;
+
+    // the Prefetcher moves the window; until then this is asked again on every read
+    if (outsideWindow || runningLow)
+        wantedPrefetch.store(startSampleInFile, std::memory_order_relaxed);
+
+    return source->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+}
+
+void MappedPcmReader::prefetch(juce::int64 samplePosition)
+{
+    samplePosition = juce::jlimit((juce::int64) 0, lengthInSamples, samplePosition);
+    auto endSample = juce::jmin(lengthInSamples, samplePosition + prefetchWindow);
+
+    prefetchedStart.store(samplePosition, std::memory_order_relaxed);
+    prefetchedEnd.store(endSample, std::memory_order_relaxed);
+
+   #if SAP_HAS_MADVISE
+    if (hintMap == nullptr || bytesPerFrame <= 0)
+        return;
+
+    static const auto pageSize = (juce::int64) sysconf(_SC_PAGESIZE);
+
+    auto first = dataStart + samplePosition * bytesPerFrame;
+    auto last = juce::jmin((juce::int64) hintMap->getSize(), dataStart + endSample * bytesPerFrame);
+    first -= first % pageSize; // madvise wants a page-aligned start
+
+    if (last > first)
+        madvise(static_cast<char*>(hintMap->getData()) + first, (size_t) (last - first), MADV_WILLNEED);
+   #endif
+}
+
+void MappedPcmReader::servicePrefetch()
+{
+    auto position = wantedPrefetch.exchange(-1, std::memory_order_relaxed);
+
+    if (position >= 0)
+        prefetch(position);
+}
+
+// Walks the RIFF/AIFF chunk list to find the byte offset where sample frames begin.
+// Returns -1 if the layout isn't recognised (prefetch hints are then skipped).
+juce::int64 MappedPcmReader::findDataChunkStart(const juce::File& file)
+{
+    juce::FileInputStream in(file);
+    if (!in.openedOk())
+        return -1;
+
+    char id[4];
+    if (in.read(id, 4) != 4)
+        return -1;
+
+    const bool isRiff = memcmp(id, "RIFF", 4) == 0 || memcmp(id, "RF64", 4) == 0;
+    const bool isAiff = memcmp(id, "FORM", 4) == 0;
+    if (!isRiff && !isAiff)
+        return -1;
+
+    in.skipNextBytes(8); // container size + "WAVE"/"AIFF"/"AIFC"
+
+    while (!in.isExhausted())
+    {
+        if (in.read(id, 4) != 4)
+            break;
+
+        auto chunkSize = (juce::int64) (juce::uint32) (isRiff ? in.readInt() : in.readIntBigEndian());
+        auto bodyStart = in.getPosition();
+
+        if (isRiff && memcmp(id, "data", 4) == 0)
+            return bodyStart;
+
+        if (isAiff && memcmp(id, "SSND", 4) == 0)
+        {
+            auto offset = (juce::int64) (juce::uint32) in.readIntBigEndian();
+            return bodyStart + 8 + offset; // skip the offset + blockSize fields
+        }
+
+        // chunks are padded to an even length
+        in.setPosition(bodyStart + chunkSize + (chunkSize & 1));
+    }
+
+    return -1;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+
+// Reader for uncompressed WAV/AIFF files that serves samples straight out of a
+// memory-mapped view of the file (JUCE's MemoryMappedAudioFormatReader), so a block
+// read is a page-cache copy instead of a read() syscall + intermediate buffer.
+//
+// The kernel is asked (madvise WILLNEED) to page in a window ahead of the playhead,
+// and again right after a seek, so the audio thread rarely takes a hard page fault.
+// readSamples() itself only notes where the window should move to; the advice is given
+// by a shared background thread, so reads stay a plain copy-and-convert.
+class MappedPcmReader : public juce::AudioFormatReader
+{
+public:
+    ~MappedPcmReader() override;
+
+    // Returns nullptr when the file isn't a PCM format that can be mapped,
+    // in which case the caller should fall back to CodecRegistry::createReaderFor().
+    static std::unique_ptr<MappedPcmReader> create(const juce::File& file);
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+    // Hint the kernel to page in the region starting at this sample. A non-blocking
+    // syscall, but still a syscall: not for the audio thread.
+    void prefetch(juce::int64 samplePosition);
+
+    juce::int64 getPrefetchWindowSamples() const { return prefetchWindow; }
+
+private:
+    MappedPcmReader(std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader,
+                    std::unique_ptr<juce::MemoryMappedFile> hintMap,
+                    juce::int64 dataChunkStart);
+
+    class Prefetcher;
+
+    static juce::int64 findDataChunkStart(const juce::File& file);
+    void servicePrefetch(); // on the Prefetcher's thread
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> source;
+
+    // Second read-only view of the same file used only for madvise; it shares the
+    // page cache with the reader's own mapping, so no sample data is duplicated.
+    std::unique_ptr<juce::MemoryMappedFile> hintMap;
+    juce::int64 dataStart = 0;
+    juce::int64 bytesPerFrame = 0;
+    juce::int64 prefetchWindow = 0;
+
+    std::atomic<juce::int64> prefetchedStart{ -1 };
+    std::atomic<juce::int64> prefetchedEnd{ -1 };
+    std::atomic<juce::int64> wantedPrefetch{ -1 }; // readSamples -> Prefetcher
+    Prefetcher* prefetcher = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedPcmReader)
+};
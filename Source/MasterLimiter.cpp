@@ -0,0 +1,164 @@
+#include "MasterLimiter.h"
+
+namespace
+{
+    constexpr double kLookaheadSeconds = 0.005;
+    constexpr double kReleaseSeconds = 0.1;
+    constexpr float kSoftClipKnee = 0.6f; // proportion of the ceiling where saturation starts
+
+    // linear below the knee, tanh-shaped towards the ceiling above it (continuous slope)
+    void softClip(float* samples, int numSamples, float ceiling)
+    {
+        const float knee = ceiling * kSoftClipKnee;
+        const float range = ceiling - knee;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float magnitude = std::abs(samples[i]);
+            if (magnitude > knee)
+                samples[i] = std::copysign(knee + range * std::tanh((magnitude - knee) / range), samples[i]);
+        }
+    }
+}
+
+void MasterLimiter::prepare(double sampleRate, int maximumBlockSize, int numChannels)
+{
+    lookahead = juce::jmax(2, (int) std::round(kLookaheadSeconds * sampleRate));
+    maxBlockSize = juce::jmax(1, maximumBlockSize);
+    releaseCoefficient = (float) std::exp(-1.0 / (kReleaseSeconds * sampleRate));
+
+    scratch.setSize(2, maxBlockSize);
+    minValues.assign((size_t) lookahead + 1, 1.0f);
+    minIndices.assign((size_t) lookahead + 1, 0);
+    boxHistory.assign((size_t) lookahead, 1.0f);
+    delay.setSize(juce::jmax(1, numChannels), getLatencySamples());
+
+    reset();
+}
+
+void MasterLimiter::reset()
+{
+    minHead = minSize = 0;
+    sampleCounter = 0;
+    releaseEnvelope = 1.0f;
+
+    std::fill(boxHistory.begin(), boxHistory.end(), 1.0f);
+    boxPos = 0;
+    boxSum = (double) lookahead;
+
+    delay.clear();
+    delayPos = 0;
+}
+
+float MasterLimiter::takeGainReductionDb()
+{
+    return maxReductionDb.exchange(0.0f);
+}
+
+void MasterLimiter::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (maxBlockSize == 0)
+        return; // not prepared
+
+    // hosts may deliver more than the size we prepared for
+    for (int done = 0; done < numSamples; done += maxBlockSize)
+        processChunk(buffer, startSample + done, juce::jmin(maxBlockSize, numSamples - done));
+}
+
+// Gain for one detector sample, after the sliding minimum, release and moving average.
+float MasterLimiter::nextEnvelope(float requiredGain)
+{
+    const int capacity = (int) minValues.size();
+    const juce::int64 index = sampleCounter++;
+
+    while (minSize > 0 && minValues[(size_t) ((minHead + minSize - 1) % capacity)] >= requiredGain)
+        --minSize;
+
+    const int back = (minHead + minSize) % capacity;
+    minValues[(size_t) back] = requiredGain;
+    minIndices[(size_t) back] = index;
+    ++minSize;
+
+    if (minIndices[(size_t) minHead] <= index - lookahead)
+    {
+        minHead = (minHead + 1) % capacity;
+        --minSize;
+    }
+
+    const float held = minValues[(size_t) minHead];
+
+    // instant attack (the moving average below makes it smooth), exponential release
+    releaseEnvelope = held < releaseEnvelope ? held : held + releaseCoefficient * (releaseEnvelope - held);
+
+    boxSum += releaseEnvelope - boxHistory[(size_t) boxPos];
+    boxHistory[(size_t) boxPos] = releaseEnvelope;
+    boxPos = (boxPos + 1) % lookahead;
+
+    return (float) (boxSum / lookahead);
+}
+
+void MasterLimiter::processChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    const int numChannels = juce::jmin(buffer.getNumChannels(), delay.getNumChannels());
+    if (numChannels == 0)
+        return;
+
+    const float ceiling = juce::Decibels::decibelsToGain(ceilingDb);
+    float* peak = scratch.getWritePointer(0);
+    float* gain = scratch.getWritePointer(1);
+
+    if (softClipEnabled.load())
+        for (int ch = 0; ch < numChannels; ++ch)
+            softClip(buffer.getWritePointer(ch, startSample), numSamples, ceiling);
+
+    // detector: loudest channel at each sample
+    juce::FloatVectorOperations::abs(peak, buffer.getReadPointer(0, startSample), numSamples);
+    for (int ch = 1; ch < numChannels; ++ch)
+    {
+        juce::FloatVectorOperations::abs(gain, buffer.getReadPointer(ch, startSample), numSamples);
+        juce::FloatVectorOperations::max(peak, peak, gain, numSamples);
+    }
+
+    // gain that would bring each sample down to the ceiling (1 when already below it)
+    juce::FloatVectorOperations::max(peak, peak, ceiling, numSamples);
+    for (int i = 0; i < numSamples; ++i)
+        gain[i] = ceiling / peak[i];
+
+    float minGain = 1.0f;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        gain[i] = nextEnvelope(gain[i]);
+        minGain = juce::jmin(minGain, gain[i]);
+    }
+
+    // delay the audio by the lookahead so the gain is already down when a peak arrives
+    const int delayLength = delay.getNumSamples();
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        float* x = buffer.getWritePointer(ch, startSample);
+        float* d = delay.getWritePointer(ch);
+        int pos = delayPos;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float delayed = d[pos];
+            d[pos] = x[i];
+            x[i] = delayed;
+
+            if (++pos == delayLength)
+                pos = 0;
+        }
+
+        juce::FloatVectorOperations::multiply(x, gain, numSamples);
+
+        // belt and braces against float rounding in the envelope
+        juce::FloatVectorOperations::clip(x, x, -ceiling, ceiling, numSamples);
+    }
+
+    delayPos = (delayPos + numSamples) % delayLength;
+
+    const float reductionDb = -juce::Decibels::gainToDecibels(minGain);
+    float previous = maxReductionDb.load();
+    while (reductionDb > previous && !maxReductionDb.compare_exchange_weak(previous, reductionDb)) {}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+// Lookahead brickwall limiter for the master bus. The gain needed to keep every sample
+// under the ceiling is min-held over the lookahead window, released slowly and then
+// box-averaged over the same window, so it is fully down before the peak arrives and
+// never moves abruptly. The audio is delayed to match: a constant latency of
+// getLatencySamples(), with every buffer allocated in prepare().
+//
+// An optional soft clipper in front rounds off peaks instead of leaving it all to the
+// limiter, for a louder, denser master.
+class MasterLimiter
+{
+public:
+    void prepare(double sampleRate, int maximumBlockSize, int numChannels);
+    void reset();
+
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    void setSoftClipEnabled(bool shouldBeEnabled) { softClipEnabled = shouldBeEnabled; }
+    bool isSoftClipEnabled() const { return softClipEnabled.load(); }
+
+    int getLatencySamples() const { return lookahead - 1; }
+
+    // largest reduction applied since the last call, in dB (positive), for the GR readout
+    float takeGainReductionDb();
+
+private:
+    void processChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    float nextEnvelope(float requiredGain);
+
+    static constexpr float ceilingDb = -0.3f;
+    std::atomic<bool> softClipEnabled{ false };
+    std::atomic<float> maxReductionDb{ 0.0f };
+
+    int lookahead = 1;
+    int maxBlockSize = 0;
+    float releaseCoefficient = 0.0f;
+
+    // per-block scratch
+    juce::AudioBuffer<float> scratch; // channel 0: detector peak, channel 1: gain
+
+    // sliding minimum over the lookahead (monotonic deque in a ring)
+    std::vector<float> minValues;
+    std::vector<juce::int64> minIndices;
+    int minHead = 0, minSize = 0;
+    juce::int64 sampleCounter = 0;
+
+    float releaseEnvelope = 1.0f;
+
+    // moving average over the lookahead
+    std::vector<float> boxHistory;
+    int boxPos = 0;
+    double boxSum = 0.0;
+
+    // audio delay line, one ring per channel
+    juce::AudioBuffer<float> delay;
+    int delayPos = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MasterLimiter)
+};
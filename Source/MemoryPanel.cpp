@@ -0,0 +1,191 @@
+#include "MemoryPanel.h"
+#include "CodecRegistry.h"
+#include "DecodedAudioCache.h"
+#include "BandWaveform.h"
+
+namespace
+{
+    constexpr size_t megabyte = 1024 * 1024;
+    constexpr size_t decodedAudioChoices[] = { 256 * megabyte, 512 * megabyte, 1024 * megabyte, 2048 * megabyte, 4096 * megabyte };
+    constexpr size_t waveformChoices[] = { 1 * megabyte, 2 * megabyte, 4 * megabyte, 8 * megabyte, 16 * megabyte };
+    constexpr int readerChoices[] = { 0, 4, 8, 16, 32 };
+
+    juce::PropertiesFile::Options getSettingsOptions()
+    {
+        juce::PropertiesFile::Options options;
+        options.applicationName = "SimpleAudioPlayer";
+        options.filenameSuffix = "memory";
+        options.folderName = "SimpleAudioPlayer";
+        options.osxLibrarySubFolder = "Application Support";
+        options.storageFormat = juce::PropertiesFile::storeAsXML;
+        return options;
+    }
+
+    // fills the box with the choices and selects the one closest to current
+    template <typename Value, size_t numChoices>
+    void fillChoices(juce::ComboBox& box, const Value (&choices)[numChoices], Value current,
+                     std::function<juce::String(Value)> describe)
+    {
+        int closest = 0;
+
+        for (int i = 0; i < (int) numChoices; ++i)
+        {
+            box.addItem(describe(choices[i]), i + 1);
+
+            if (std::abs((double) choices[i] - (double) current) < std::abs((double) choices[closest] - (double) current))
+                closest = i;
+        }
+
+        box.setSelectedId(closest + 1, juce::dontSendNotification);
+    }
+
+    juce::String describeBytes(size_t bytes)
+    {
+        return juce::File::descriptionOfSizeInBytes((juce::int64) bytes);
+    }
+}
+
+//==============================================================================
+MemoryLimits MemoryLimits::load()
+{
+    MemoryLimits limits;
+    juce::PropertiesFile settings(getSettingsOptions());
+
+    limits.decodedAudioBytes = (size_t) settings.getValue("decodedAudioBytes", juce::String((juce::int64) limits.decodedAudioBytes)).getLargeIntValue();
+    limits.waveformBytes = (size_t) settings.getValue("waveformBytes", juce::String((juce::int64) limits.waveformBytes)).getLargeIntValue();
+    limits.pooledReaders = settings.getIntValue("pooledReaders", limits.pooledReaders);
+    return limits;
+}
+
+void MemoryLimits::save() const
+{
+    juce::PropertiesFile settings(getSettingsOptions());
+    settings.setValue("decodedAudioBytes", (juce::int64) decodedAudioBytes);
+    settings.setValue("waveformBytes", (juce::int64) waveformBytes);
+    settings.setValue("pooledReaders", pooledReaders);
+    settings.saveIfNeeded();
+}
+
+void MemoryLimits::apply() const
+{
+    DecodedAudioCache::getInstance()->setBudgetBytes(decodedAudioBytes);
+    BandWaveformCache::getInstance()->setBudgetBytes(waveformBytes);
+    CodecRegistry::getInstance()->setPoolLimit(pooledReaders);
+}
+
+//==============================================================================
+MemoryPanel::MemoryPanel(const PlayerGUI& deckA, const PlayerGUI& deckB)
+    : deck1(deckA), deck2(deckB), limits(MemoryLimits::load())
+{
+    for (auto* label : { &decodedLabel, &waveformLabel, &readersLabel })
+    {
+        label->setColour(juce::Label::textColourId, juce::Colours::white);
+        addAndMakeVisible(label);
+    }
+
+    fillChoices<size_t>(decodedBox, decodedAudioChoices, limits.decodedAudioBytes, describeBytes);
+    fillChoices<size_t>(waveformBox, waveformChoices, limits.waveformBytes, describeBytes);
+    fillChoices<int>(readersBox, readerChoices, limits.pooledReaders, [](int n) { return n == 0 ? juce::String("None") : juce::String(n); });
+
+    for (auto* box : { &decodedBox, &waveformBox, &readersBox })
+    {
+        box->onChange = [this] { limitsChanged(); };
+        addAndMakeVisible(box);
+    }
+
+    setSize(460, 360);
+    startTimerHz(4);
+}
+
+MemoryPanel::~MemoryPanel()
+{
+    stopTimer();
+}
+
+void MemoryPanel::limitsChanged()
+{
+    limits.decodedAudioBytes = decodedAudioChoices[juce::jlimit(0, juce::numElementsInArray(decodedAudioChoices) - 1, decodedBox.getSelectedId() - 1)];
+    limits.waveformBytes = waveformChoices[juce::jlimit(0, juce::numElementsInArray(waveformChoices) - 1, waveformBox.getSelectedId() - 1)];
+    limits.pooledReaders = readerChoices[juce::jlimit(0, juce::numElementsInArray(readerChoices) - 1, readersBox.getSelectedId() - 1)];
+    limits.apply();
+    limits.save();
+    repaint();
+}
+
+void MemoryPanel::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::darkgrey);
+
+    const auto a = deck1.getMemoryUsage();
+    const auto b = deck2.getMemoryUsage();
+
+    auto area = reportArea;
+    g.setFont(14.0f);
+
+    auto row = [&](const juce::String& name, const juce::String& first, const juce::String& second, juce::Colour colour)
+    {
+        auto r = area.removeFromTop(20);
+        g.setColour(colour);
+        g.drawText(name, r.removeFromLeft(r.getWidth() / 2), juce::Justification::centredLeft);
+        g.drawText(first, r.removeFromLeft(r.getWidth() / 2), juce::Justification::centredRight);
+        g.drawText(second, r, juce::Justification::centredRight);
+    };
+
+    auto deckRow = [&](const juce::String& name, size_t PlayerAudio::MemoryUsage::* field)
+    {
+        row(name, describeBytes(a.*field), describeBytes(b.*field), juce::Colours::white);
+    };
+
+    row({}, "Deck A", "Deck B", juce::Colours::lightgrey);
+    deckRow("RAM copy", &PlayerAudio::MemoryUsage::ramTrack);
+    deckRow("Seek index", &PlayerAudio::MemoryUsage::seekIndex);
+    deckRow("Hot cues", &PlayerAudio::MemoryUsage::hotCues);
+    deckRow("Scrub buffer", &PlayerAudio::MemoryUsage::scrubBuffer);
+    deckRow("Block buffers", &PlayerAudio::MemoryUsage::processing);
+    deckRow("Waveform", &PlayerAudio::MemoryUsage::waveform);
+    row("Total", describeBytes(a.getTotal()), describeBytes(b.getTotal()), juce::Colours::yellow);
+
+    // the shared caches, against the caps set below
+    area.removeFromTop(12);
+    row({}, "Used", "Cap", juce::Colours::lightgrey);
+
+    auto* decoded = DecodedAudioCache::getInstance();
+    row("RAM deck cache", describeBytes(decoded->getBytesUsed()), describeBytes(decoded->getBudgetBytes()), juce::Colours::white);
+
+    auto* waveforms = BandWaveformCache::getInstance();
+    row("Waveform cache", describeBytes(waveforms->getBytesUsed()), describeBytes(waveforms->getBudgetBytes()), juce::Colours::white);
+
+    auto* codecs = CodecRegistry::getInstance();
+    row("Idle decoders", juce::String(codecs->getNumPooledReaders()), juce::String(codecs->getPoolLimit()), juce::Colours::white);
+}
+
+void MemoryPanel::resized()
+{
+    auto area = getLocalBounds().reduced(10);
+
+    auto row = [&area]
+    {
+        auto r = area.removeFromBottom(26);
+        area.removeFromBottom(8);
+        return r;
+    };
+
+    auto readersRow = row();
+    readersLabel.setBounds(readersRow.removeFromLeft(140));
+    readersBox.setBounds(readersRow);
+
+    auto waveformRow = row();
+    waveformLabel.setBounds(waveformRow.removeFromLeft(140));
+    waveformBox.setBounds(waveformRow);
+
+    auto decodedRow = row();
+    decodedLabel.setBounds(decodedRow.removeFromLeft(140));
+    decodedBox.setBounds(decodedRow);
+
+    reportArea = area;
+}
+
+void MemoryPanel::timerCallback()
+{
+    repaint(reportArea);
+}
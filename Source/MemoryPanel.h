@@ -0,0 +1,49 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlayerGUI.h"
+
+// Caps for the process-wide caches (decoded tracks, waveforms, idle decoders), saved in
+// SimpleAudioPlayer's "memory" settings file and applied at startup.
+struct MemoryLimits
+{
+    size_t decodedAudioBytes = (size_t) 1024 * 1024 * 1024;
+    size_t waveformBytes = (size_t) 4 * 1024 * 1024;
+    int pooledReaders = 8;
+
+    static MemoryLimits load();
+    void save() const;
+    void apply() const;
+};
+
+// What each deck holds in memory (RAM copy, seek index, hot cues, scrub window, block
+// buffers, waveform) and how full the shared caches are, refreshed while open; the
+// caps can be changed here.
+class MemoryPanel : public juce::Component,
+                    private juce::Timer
+{
+public:
+    MemoryPanel(const PlayerGUI& deckA, const PlayerGUI& deckB);
+    ~MemoryPanel() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    void limitsChanged();
+
+    const PlayerGUI& deck1;
+    const PlayerGUI& deck2;
+    MemoryLimits limits;
+
+    juce::Rectangle<int> reportArea;
+
+    juce::Label decodedLabel{ {}, "RAM deck cache" };
+    juce::ComboBox decodedBox;
+    juce::Label waveformLabel{ {}, "Waveform cache" };
+    juce::ComboBox waveformBox;
+    juce::Label readersLabel{ {}, "Idle decoders" };
+    juce::ComboBox readersBox;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MemoryPanel)
+};
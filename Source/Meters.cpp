@@ -0,0 +1,227 @@
+#include "Meters.h"
+
+namespace
+{
+    constexpr float kMinDb = -60.0f;
+
+    float toDb(float gain)
+    {
+        return juce::Decibels::gainToDecibels(gain, kMinDb);
+    }
+
+    float dbToProportion(float db)
+    {
+        return juce::jlimit(0.0f, 1.0f, (db - kMinDb) / -kMinDb);
+    }
+}
+
+//==============================================================================
+LevelMeter::LevelMeter(AudioTap& tapToShow)
+    : tap(tapToShow)
+{
+    for (int ch = 0; ch < AudioTap::maxChannels; ++ch)
+        peakDb[ch] = rmsDb[ch] = holdDb[ch] = kMinDb;
+
+    setInterceptsMouseClicks(false, false);
+    startTimerHz(30);
+}
+
+void LevelMeter::setColours(juce::Colour levelColour, juce::Colour backgroundColour)
+{
+    fill = levelColour;
+    background = backgroundColour;
+    repaint();
+}
+
+void LevelMeter::timerCallback()
+{
+    for (int ch = 0; ch < AudioTap::maxChannels; ++ch)
+    {
+        // fast attack, ~20 dB/s fall
+        peakDb[ch] = juce::jmax(toDb(tap.takePeak(ch)), peakDb[ch] - 0.7f);
+        rmsDb[ch] = toDb(tap.getRms(ch));
+
+        if (peakDb[ch] >= holdDb[ch] || --holdFrames[ch] <= 0)
+        {
+            holdDb[ch] = peakDb[ch];
+            holdFrames[ch] = 45; // 1.5 s
+        }
+    }
+
+    repaint();
+}
+
+void LevelMeter::paint(juce::Graphics& g)
+{
+    auto area = getLocalBounds().toFloat();
+    g.setColour(background);
+    g.fillRoundedRectangle(area, 2.0f);
+
+    const float barW = (area.getWidth() - 3.0f) / AudioTap::maxChannels;
+
+    for (int ch = 0; ch < AudioTap::maxChannels; ++ch)
+    {
+        auto bar = juce::Rectangle<float>(area.getX() + 1.0f + ch * (barW + 1.0f), area.getY() + 1.0f,
+                                          barW, area.getHeight() - 2.0f);
+
+        auto peakH = bar.getHeight() * dbToProportion(peakDb[ch]);
+        auto rmsH = bar.getHeight() * dbToProportion(rmsDb[ch]);
+
+        g.setColour(fill.withAlpha(0.45f));
+        g.fillRect(bar.withTop(bar.getBottom() - peakH));
+
+        g.setColour(peakDb[ch] > -0.1f ? juce::Colours::red : fill);
+        g.fillRect(bar.withTop(bar.getBottom() - rmsH));
+
+        auto holdY = bar.getBottom() - bar.getHeight() * dbToProportion(holdDb[ch]);
+        g.setColour(holdDb[ch] > -0.1f ? juce::Colours::red : juce::Colours::white);
+        g.fillRect(bar.getX(), holdY, bar.getWidth(), 1.5f);
+    }
+}
+
+//==============================================================================
+SpectrumView::SpectrumView(AudioTap& tapToShow)
+    : tap(tapToShow),
+      history((size_t) fftSize, 0.0f),
+      incoming((size_t) fftSize, 0.0f),
+      window((size_t) fftSize),
+      fftData((size_t) fftSize),
+      levelsDb((size_t) fftSize / 2, kMinDb)
+{
+    // Hann window
+    for (int i = 0; i < fftSize; ++i)
+        window[(size_t) i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float) i / (float) (fftSize - 1));
+
+    setInterceptsMouseClicks(false, false);
+    startTimerHz(30);
+}
+
+void SpectrumView::setColours(juce::Colour lineColour, juce::Colour backgroundColour)
+{
+    line = lineColour;
+    background = backgroundColour;
+    repaint();
+}
+
+// In-place iterative radix-2 FFT (size must be a power of two).
+void SpectrumView::performFft(std::vector<std::complex<float>>& data)
+{
+    const size_t n = data.size();
+
+    for (size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j)
+            std::swap(data[i], data[j]);
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        const float angle = -juce::MathConstants<float>::twoPi / (float) len;
+        const std::complex<float> step(std::cos(angle), std::sin(angle));
+
+        for (size_t i = 0; i < n; i += len)
+        {
+            std::complex<float> w(1.0f, 0.0f);
+            for (size_t k = 0; k < len / 2; ++k)
+            {
+                auto even = data[i + k];
+                auto odd = data[i + k + len / 2] * w;
+                data[i + k] = even + odd;
+                data[i + k + len / 2] = even - odd;
+                w *= step;
+            }
+        }
+    }
+}
+
+void SpectrumView::timerCallback()
+{
+    int got = tap.readSamples(incoming.data(), fftSize);
+    if (got == 0)
+    {
+        // nothing playing: let the display fall away
+        for (auto& db : levelsDb)
+            db = juce::jmax(kMinDb, db - 1.5f);
+
+        repaint();
+        return;
+    }
+
+    // drain anything else that piled up, keeping only the newest fftSize samples
+    while (got > 0)
+    {
+        for (int i = 0; i < got; ++i)
+        {
+            history[(size_t) historyPos] = incoming[(size_t) i];
+            historyPos = (historyPos + 1) % fftSize;
+        }
+
+        got = tap.readSamples(incoming.data(), fftSize);
+    }
+
+    for (int i = 0; i < fftSize; ++i)
+        fftData[(size_t) i] = { history[(size_t) ((historyPos + i) % fftSize)] * window[(size_t) i], 0.0f };
+
+    performFft(fftData);
+
+    // Hann window has a coherent gain of 0.5; full-scale sine -> 0 dB
+    const float scale = 4.0f / (float) fftSize;
+    for (size_t bin = 0; bin < levelsDb.size(); ++bin)
+    {
+        auto db = toDb(std::abs(fftData[bin]) * scale);
+        levelsDb[bin] = db > levelsDb[bin] ? db : levelsDb[bin] + 0.25f * (db - levelsDb[bin]);
+    }
+
+    repaint();
+}
+
+void SpectrumView::paint(juce::Graphics& g)
+{
+    auto area = getLocalBounds().toFloat();
+    g.setColour(background);
+    g.fillRoundedRectangle(area, 3.0f);
+
+    const double nyquist = tap.getSampleRate() / 2.0;
+    const double minHz = 20.0;
+    const double maxHz = juce::jmin(20000.0, nyquist);
+    if (area.getWidth() < 2.0f || maxHz <= minHz)
+        return;
+
+    juce::Path path;
+    const float binHz = (float) (tap.getSampleRate() / fftSize);
+
+    // one point per pixel column, taking the loudest bin that falls under it
+    for (int x = 0; x < (int) area.getWidth(); ++x)
+    {
+        auto hzLo = minHz * std::pow(maxHz / minHz, (double) x / area.getWidth());
+        auto hzHi = minHz * std::pow(maxHz / minHz, (double) (x + 1) / area.getWidth());
+        auto binLo = juce::jlimit(1, (int) levelsDb.size() - 1, (int) (hzLo / binHz));
+        auto binHi = juce::jlimit(binLo, (int) levelsDb.size() - 1, (int) (hzHi / binHz));
+
+        float db = kMinDb;
+        for (int b = binLo; b <= binHi; ++b)
+            db = juce::jmax(db, levelsDb[(size_t) b]);
+
+        auto y = area.getBottom() - area.getHeight() * dbToProportion(db);
+
+        if (x == 0)
+            path.startNewSubPath(area.getX(), y);
+        else
+            path.lineTo(area.getX() + (float) x, y);
+    }
+
+    g.setColour(line.withAlpha(0.25f));
+    auto filled = path;
+    filled.lineTo(area.getRight(), area.getBottom());
+    filled.lineTo(area.getX(), area.getBottom());
+    filled.closeSubPath();
+    g.fillPath(filled);
+
+    g.setColour(line);
+    g.strokePath(path, juce::PathStrokeType(1.2f));
+}
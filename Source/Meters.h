@@ -0,0 +1,60 @@
+#pragma once
+#include <JuceHeader.h>
+#include "AudioTap.h"
+#include <complex>
+#include <vector>
+
+// Vertical L/R peak + RMS meter with a short peak hold, polling an AudioTap at 30 Hz.
+class LevelMeter : public juce::Component,
+                   private juce::Timer
+{
+public:
+    explicit LevelMeter(AudioTap& tapToShow);
+
+    void setColours(juce::Colour levelColour, juce::Colour backgroundColour);
+    void paint(juce::Graphics& g) override;
+
+private:
+    void timerCallback() override;
+
+    AudioTap& tap;
+    juce::Colour fill{ juce::Colours::yellow }, background{ juce::Colours::black };
+
+    float peakDb[AudioTap::maxChannels];
+    float rmsDb[AudioTap::maxChannels];
+    float holdDb[AudioTap::maxChannels];
+    int holdFrames[AudioTap::maxChannels] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeter)
+};
+
+// Log-frequency spectrum of an AudioTap. The FFT runs here on the message thread from
+// the samples the tap collected, never on the audio thread.
+class SpectrumView : public juce::Component,
+                     private juce::Timer
+{
+public:
+    explicit SpectrumView(AudioTap& tapToShow);
+
+    void setColours(juce::Colour lineColour, juce::Colour backgroundColour);
+    void paint(juce::Graphics& g) override;
+
+private:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+
+    void timerCallback() override;
+    static void performFft(std::vector<std::complex<float>>& data);
+
+    AudioTap& tap;
+    juce::Colour line{ juce::Colours::yellow }, background{ juce::Colours::black };
+
+    std::vector<float> history; // last fftSize samples, circular
+    int historyPos = 0;
+    std::vector<float> incoming;
+    std::vector<float> window;
+    std::vector<std::complex<float>> fftData;
+    std::vector<float> levelsDb; // smoothed, one per bin
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumView)
+};
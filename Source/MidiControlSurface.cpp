@@ -0,0 +1,266 @@
+#include "MidiControlSurface.h"
+#include "AppLog.h"
+
+MidiControlSurface::MidiControlSurface(PlayerAudio& deckA, PlayerAudio& deckB, std::atomic<float>& crossfaderValue)
+    : decks{ &deckA, &deckB }, crossfader(crossfaderValue)
+{
+    for (auto& m : mappings)
+        m = 0;
+
+    juce::PropertiesFile::Options options;
+    options.applicationName = "SimpleAudioPlayer";
+    options.filenameSuffix = "midi";
+    options.folderName = "SimpleAudioPlayer";
+    options.osxLibrarySubFolder = "Application Support";
+    options.storageFormat = juce::PropertiesFile::storeAsXML;
+
+    store = std::make_unique<juce::PropertiesFile>(options);
+    loadMappings();
+
+    // not available on every platform
+    virtualInput = juce::MidiInput::createNewDevice("SimpleAudioPlayer", this);
+    if (virtualInput != nullptr)
+        virtualInput->start();
+
+    openInputs();
+    deviceListConnection = juce::MidiDeviceListConnection::make([this] { openInputs(); });
+}
+
+MidiControlSurface::~MidiControlSurface()
+{
+    deviceListConnection = {};
+    inputs.clear();
+    virtualInput.reset();
+    cancelPendingUpdate();
+}
+
+// Opens controllers as they appear and drops the ones that went away.
+void MidiControlSurface::openInputs()
+{
+    const auto available = juce::MidiInput::getAvailableDevices();
+
+    for (int i = inputs.size(); --i >= 0;)
+        if (!available.contains(inputs[i]->getDeviceInfo()))
+            inputs.remove(i);
+
+    for (auto& info : available)
+    {
+        if (virtualInput != nullptr && info.identifier == virtualInput->getIdentifier())
+            continue;
+
+        bool alreadyOpen = false;
+        for (auto* input : inputs)
+            alreadyOpen = alreadyOpen || input->getIdentifier() == info.identifier;
+
+        if (alreadyOpen)
+            continue;
+
+        if (auto input = juce::MidiInput::openDevice(info.identifier, this))
+        {
+            APP_LOG(midi, info, "Opened MIDI input {}", info.name);
+            input->start();
+            inputs.add(input.release());
+        }
+    }
+}
+
+juce::uint16 MidiControlSurface::encode(int deck, Action action)
+{
+    return (juce::uint16) (1 + (int) action * numDecks + (action == Action::crossfader ? 0 : deck));
+}
+
+// note-ons and controllers only; -1 for anything else
+int MidiControlSurface::keyFor(const juce::MidiMessage& message)
+{
+    int type;
+    int number;
+
+    if (message.isNoteOn())
+    {
+        type = 0;
+        number = message.getNoteNumber();
+    }
+    else if (message.isController())
+    {
+        type = 1;
+        number = message.getControllerNumber();
+    }
+    else
+    {
+        return -1;
+    }
+
+    return (type * 16 + (message.getChannel() - 1)) * 128 + number;
+}
+
+// MIDI thread.
+void MidiControlSurface::handleIncomingMidiMessage(juce::MidiInput*, const juce::MidiMessage& message)
+{
+    const int key = keyFor(message);
+    if (key < 0)
+        return;
+
+    if (learning.load() != 0)
+    {
+        const auto target = learning.exchange(0);
+        if (target != 0)
+        {
+            // one control per action
+            for (auto& m : mappings)
+                if (m.load() == target)
+                    m = 0;
+
+            mappings[(size_t) key] = target;
+            APP_LOG(midi, info, "Learned key {} for binding {}", key, (int) target);
+            triggerAsyncUpdate();
+            return;
+        }
+    }
+
+    if (const auto binding = mappings[(size_t) key].load())
+        dispatch(binding, message);
+}
+
+void MidiControlSurface::dispatch(juce::uint16 binding, const juce::MidiMessage& message)
+{
+    const int index = binding - 1;
+    const auto action = (Action) (index / numDecks);
+    auto& deck = *decks[(size_t) (index % numDecks)];
+
+    // 0..127; buttons send velocity or 127 when pressed and 0 (or a note-off) when released
+    const int value = message.isController() ? message.getControllerValue() : message.getVelocity();
+
+    auto push = [&deck](PlayerAudio::ControlAction controlAction, float controlValue)
+    {
+        deck.pushControl(controlAction, controlValue);
+    };
+
+    switch (action)
+    {
+        case Action::playPause:
+            if (value > 0)
+                push(PlayerAudio::ControlAction::playPause, 1.0f);
+            break;
+
+        case Action::cue:
+            if (value > 0)
+                push(PlayerAudio::ControlAction::cue, 1.0f);
+            break;
+
+        case Action::loop:
+            if (value > 0)
+                push(PlayerAudio::ControlAction::loop, 1.0f);
+            break;
+
+        case Action::gain:
+            push(PlayerAudio::ControlAction::gain, (float) value / 127.0f);
+            break;
+
+        // relative encoder, two's complement: 1..63 forwards, 65..127 backwards
+        case Action::jog:
+        {
+            const int ticks = value < 64 ? value : value - 128;
+            if (ticks != 0)
+                push(PlayerAudio::ControlAction::jog, (float) ticks);
+            break;
+        }
+
+        case Action::crossfader:
+            crossfader = (float) value / 127.0f;
+            break;
+
+        default:
+        {
+            const int hotCue = (int) action - (int) Action::hotCue1;
+            if (value > 0)
+                push(hotCue < HotCueBank::numCues ? PlayerAudio::ControlAction::hotCue : PlayerAudio::ControlAction::setHotCue,
+                     (float) (hotCue % HotCueBank::numCues));
+            break;
+        }
+    }
+}
+
+void MidiControlSurface::startLearning(int deck, Action action)
+{
+    learning = encode(juce::jlimit(0, numDecks - 1, deck), action);
+}
+
+void MidiControlSurface::cancelLearning()
+{
+    learning = 0;
+}
+
+void MidiControlSurface::clearMappings()
+{
+    for (auto& m : mappings)
+        m = 0;
+
+    saveMappings();
+}
+
+juce::String MidiControlSurface::describeMapping(int deck, Action action) const
+{
+    const auto target = encode(deck, action);
+
+    for (int key = 0; key < numKeys; ++key)
+    {
+        if (mappings[(size_t) key].load() != target)
+            continue;
+
+        const bool isController = key >= 16 * 128;
+        const int channel = (key / 128) % 16 + 1;
+        return (isController ? "CC " : "Note ") + juce::String(key % 128) + " ch " + juce::String(channel);
+    }
+
+    return {};
+}
+
+juce::String MidiControlSurface::getActionName(Action action)
+{
+    switch (action)
+    {
+        case Action::playPause:  return "Play/Pause";
+        case Action::cue:        return "Cue";
+        case Action::loop:       return "Loop A-B";
+        case Action::gain:       return "Gain";
+        case Action::jog:        return "Jog";
+        case Action::crossfader: return "Crossfader";
+        default:                 break;
+    }
+
+    const int hotCue = (int) action - (int) Action::hotCue1;
+    return (hotCue < HotCueBank::numCues ? "Hot cue " : "Set hot cue ") + juce::String(hotCue % HotCueBank::numCues + 1);
+}
+
+void MidiControlSurface::handleAsyncUpdate()
+{
+    saveMappings();
+
+    if (onMappingChanged != nullptr)
+        onMappingChanged();
+}
+
+// "key:binding" pairs separated by spaces
+void MidiControlSurface::loadMappings()
+{
+    for (auto& pair : juce::StringArray::fromTokens(store->getValue("mappings"), " ", {}))
+    {
+        const int key = pair.upToFirstOccurrenceOf(":", false, false).getIntValue();
+        const int binding = pair.fromFirstOccurrenceOf(":", false, false).getIntValue();
+
+        if (juce::isPositiveAndBelow(key, numKeys) && juce::isPositiveAndBelow(binding - 1, numActions * numDecks))
+            mappings[(size_t) key] = (juce::uint16) binding;
+    }
+}
+
+void MidiControlSurface::saveMappings()
+{
+    juce::StringArray pairs;
+
+    for (int key = 0; key < numKeys; ++key)
+        if (const auto binding = mappings[(size_t) key].load())
+            pairs.add(juce::String(key) + ":" + juce::String(binding));
+
+    store->setValue("mappings", pairs.joinIntoString(" "));
+    store->saveIfNeeded();
+}
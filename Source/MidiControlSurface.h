@@ -0,0 +1,75 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlayerAudio.h"
+#include <array>
+#include <atomic>
+
+// MIDI controller input with a learnable mapping. Every available MIDI input is opened,
+// plus a virtual "SimpleAudioPlayer" input where the platform supports one (ALSA, so a
+// controller or a test sequencer can be wired to it with aconnect). Messages are handled
+// on the MIDI thread: the mapping is a table of atomics and the deck actions go through
+// each deck's lock-free control queue, so they take effect in the next audio block
+// without ever touching the message thread.
+class MidiControlSurface : private juce::MidiInputCallback,
+                           private juce::AsyncUpdater
+{
+public:
+    // new actions go at the end: saved mappings store the action's number
+    enum class Action { playPause, cue, loop, gain, jog, crossfader,
+                        hotCue1, hotCue2, hotCue3, hotCue4, hotCue5, hotCue6, hotCue7, hotCue8,
+                        setHotCue1, setHotCue2, setHotCue3, setHotCue4, setHotCue5, setHotCue6, setHotCue7, setHotCue8 };
+    static constexpr int numActions = 22;
+    static_assert(HotCueBank::numCues == 8, "one hotCue and setHotCue action per cue");
+
+    // hotCue jumps to the cue (or sets it if empty, like the number keys), setHotCue overwrites it
+    static Action hotCueAction(int cueIndex, bool set)
+    {
+        return (Action) ((int) (set ? Action::setHotCue1 : Action::hotCue1) + cueIndex);
+    }
+    static constexpr int numDecks = 2;
+
+    // crossfader: 0 = deck A only, 1 = deck B only
+    MidiControlSurface(PlayerAudio& deckA, PlayerAudio& deckB, std::atomic<float>& crossfaderValue);
+    ~MidiControlSurface() override;
+
+    // the next note or controller that arrives is bound to this action (deck is ignored
+    // for the crossfader)
+    void startLearning(int deck, Action action);
+    void cancelLearning();
+    bool isLearning() const { return learning.load() != 0; }
+
+    void clearMappings();
+    juce::String describeMapping(int deck, Action action) const;
+
+    static juce::String getActionName(Action action);
+
+    // message thread, after a learn completes
+    std::function<void()> onMappingChanged;
+
+private:
+    static constexpr int numKeys = 2 * 16 * 128; // note/CC x channel x number
+
+    void handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message) override;
+    void handleAsyncUpdate() override;
+
+    void dispatch(juce::uint16 binding, const juce::MidiMessage& message);
+    void openInputs();
+    void loadMappings();
+    void saveMappings();
+
+    static int keyFor(const juce::MidiMessage& message);
+    static juce::uint16 encode(int deck, Action action);
+
+    std::array<PlayerAudio*, numDecks> decks;
+    std::atomic<float>& crossfader;
+
+    std::array<std::atomic<juce::uint16>, numKeys> mappings;
+    std::atomic<juce::uint16> learning{ 0 };
+
+    std::unique_ptr<juce::MidiInput> virtualInput;
+    juce::OwnedArray<juce::MidiInput> inputs;
+    juce::MidiDeviceListConnection deviceListConnection;
+    std::unique_ptr<juce::PropertiesFile> store;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiControlSurface)
+};
@@ -0,0 +1,663 @@
+#include "Mp3SeekIndex.h"
+
+namespace
+{
+    // synthesis filterbank delay every Layer III decoder adds on top of the encoder delay
+    constexpr int kDecoderDelay = 529;
+
+    // bytes of earlier frames the bit reservoir can reach back into (main_data_begin is 9 bits)
+    constexpr juce::int64 kMaxReservoirBytes = 512;
+
+    constexpr int kIndexMagic = 0x49504153; // "SAPI"
+    constexpr int kIndexVersion = 1;
+
+    struct FrameHeader
+    {
+        int sampleRate = 0;
+        int numChannels = 2;
+        int frameBytes = 0;
+    };
+
+    // Only MPEG-1 Layer III is indexed; that's what JUCE's MP3 decoder assumes (1152 samples/frame).
+    bool parseFrameHeader(const juce::uint8* h, FrameHeader& out)
+    {
+        static const int bitrates[] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+        static const int sampleRates[] = { 44100, 48000, 32000 };
+
+        if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0)
+            return false;
+
+        const int versionBits = (h[1] >> 3) & 3;
+        const int layerBits = (h[1] >> 1) & 3;
+        const int bitrateIndex = h[2] >> 4;
+        const int sampleRateIndex = (h[2] >> 2) & 3;
+
+        if (versionBits != 3 || layerBits != 1 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+            return false;
+
+        out.sampleRate = sampleRates[sampleRateIndex];
+        out.numChannels = (h[3] >> 6) == 3 ? 1 : 2;
+        out.frameBytes = 144 * bitrates[bitrateIndex] * 1000 / out.sampleRate + ((h[2] >> 1) & 1);
+        return true;
+    }
+
+    juce::uint32 readBigEndian32(const juce::uint8* p)
+    {
+        return ((juce::uint32) p[0] << 24) | ((juce::uint32) p[1] << 16) | ((juce::uint32) p[2] << 8) | (juce::uint32) p[3];
+    }
+}
+
+//==============================================================================
+juce::int64 Mp3SeekIndex::getDecoderStartSkip() const
+{
+    return hasGaplessInfo ? encoderDelay + kDecoderDelay : 0;
+}
+
+juce::int64 Mp3SeekIndex::getLengthInSamples() const
+{
+    auto total = (juce::int64) frameOffsets.size() * samplesPerFrame;
+
+    if (hasGaplessInfo)
+        total -= encoderDelay + encoderPadding;
+
+    return juce::jmax((juce::int64) 0, total);
+}
+
+bool Mp3SeekIndex::matches(const juce::File& mp3File) const
+{
+    return mp3File.getSize() == sourceFileSize
+        && mp3File.getLastModificationTime().toMilliseconds() == sourceModificationTime;
+}
+
+std::unique_ptr<Mp3SeekIndex> Mp3SeekIndex::build(const juce::File& mp3File)
+{
+    juce::MemoryMappedFile map(mp3File, juce::MemoryMappedFile::readOnly);
+    auto* data = static_cast<const juce::uint8*>(map.getData());
+    auto size = (juce::int64) map.getSize();
+
+    // offsets are stored as 32-bit
+    if (data == nullptr || size < 4 || size > (juce::int64) 0xffffffff)
+        return {};
+
+    juce::int64 pos = 0;
+
+    // skip ID3v2 tags (size is a 28-bit syncsafe integer, plus an optional footer)
+    while (pos + 10 <= size && memcmp(data + pos, "ID3", 3) == 0)
+    {
+        auto tagSize = ((data[pos + 6] & 0x7f) << 21) | ((data[pos + 7] & 0x7f) << 14)
+                     | ((data[pos + 8] & 0x7f) << 7) | (data[pos + 9] & 0x7f);
+        pos += 10 + tagSize + ((data[pos + 5] & 0x10) != 0 ? 10 : 0);
+    }
+
+    auto index = std::make_unique<Mp3SeekIndex>();
+    index->sourceFileSize = mp3File.getSize();
+    index->sourceModificationTime = mp3File.getLastModificationTime().toMilliseconds();
+
+    bool synced = false;
+    bool seenFirstFrame = false;
+
+    while (pos + 4 <= size)
+    {
+        FrameHeader h;
+        bool ok = parseFrameHeader(data + pos, h) && pos + h.frameBytes <= size;
+
+        // when (re)syncing, only trust a header that is followed by another matching one
+        if (ok && !synced)
+        {
+            FrameHeader next;
+            auto nextPos = pos + h.frameBytes;
+            ok = nextPos + 4 > size || (parseFrameHeader(data + nextPos, next) && next.sampleRate == h.sampleRate);
+        }
+
+        if (ok && seenFirstFrame && h.sampleRate != (int) index->sampleRate)
+            ok = false;
+
+        if (!ok)
+        {
+            synced = false;
+            ++pos;
+            continue;
+        }
+
+        synced = true;
+
+        if (!seenFirstFrame)
+        {
+            seenFirstFrame = true;
+            index->sampleRate = h.sampleRate;
+            index->numChannels = h.numChannels;
+
+            // a Xing/Info or VBRI frame holds tag data, not audio
+            auto sideInfoBytes = h.numChannels == 1 ? 17 : 32;
+            auto* tag = data + pos + 4 + sideInfoBytes;
+            auto* frameEnd = data + pos + h.frameBytes;
+
+            if (tag + 8 <= frameEnd && (memcmp(tag, "Xing", 4) == 0 || memcmp(tag, "Info", 4) == 0))
+            {
+                auto flags = readBigEndian32(tag + 4);
+                auto* p = tag + 8;
+                if (flags & 1) p += 4;   // frame count
+                if (flags & 2) p += 4;   // byte count
+                if (flags & 4) p += 100; // TOC
+                if (flags & 8) p += 4;   // quality
+
+                // LAME (and ffmpeg's "Lavc") extension: 9-byte version string, 12 bytes of fields,
+                // then encoder delay and padding as two packed 12-bit values
+                if (p + 24 <= frameEnd && (memcmp(p, "LAME", 4) == 0 || memcmp(p, "Lavc", 4) == 0 || memcmp(p, "Lavf", 4) == 0))
+                {
+                    index->encoderDelay = (p[21] << 4) | (p[22] >> 4);
+                    index->encoderPadding = ((p[22] & 0x0f) << 8) | p[23];
+                    index->hasGaplessInfo = true;
+                }
+
+                pos += h.frameBytes;
+                continue;
+            }
+
+            if (data + pos + 4 + 32 + 4 <= frameEnd && memcmp(data + pos + 4 + 32, "VBRI", 4) == 0)
+            {
+                pos += h.frameBytes;
+                continue;
+            }
+        }
+
+        index->frameOffsets.push_back((juce::uint32) pos);
+        pos += h.frameBytes;
+    }
+
+    if (index->frameOffsets.empty())
+        return {};
+
+    return index;
+}
+
+std::unique_ptr<Mp3SeekIndex> Mp3SeekIndex::readFrom(const juce::File& indexFile)
+{
+    juce::FileInputStream in(indexFile);
+    if (!in.openedOk() || in.readInt() != kIndexMagic || in.readInt() != kIndexVersion)
+        return {};
+
+    auto index = std::make_unique<Mp3SeekIndex>();
+    index->sourceFileSize = in.readInt64();
+    index->sourceModificationTime = in.readInt64();
+    index->sampleRate = in.readDouble();
+    index->numChannels = in.readInt();
+    index->samplesPerFrame = in.readInt();
+    index->encoderDelay = in.readInt();
+    index->encoderPadding = in.readInt();
+    index->hasGaplessInfo = in.readBool();
+
+    auto numFrames = in.readInt();
+    if (numFrames <= 0 || (juce::int64) numFrames * 4 > in.getNumBytesRemaining())
+        return {};
+
+    index->frameOffsets.resize((size_t) numFrames);
+    for (auto& offset : index->frameOffsets)
+        offset = (juce::uint32) in.readInt();
+
+    return index;
+}
+
+bool Mp3SeekIndex::writeTo(const juce::File& indexFile) const
+{
+    indexFile.getParentDirectory().createDirectory();
+
+    // write to a temp file and swap it in, so a crash never leaves a half-written index
+    juce::TemporaryFile temp(indexFile);
+
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+            return false;
+
+        out.writeInt(kIndexMagic);
+        out.writeInt(kIndexVersion);
+        out.writeInt64(sourceFileSize);
+        out.writeInt64(sourceModificationTime);
+        out.writeDouble(sampleRate);
+        out.writeInt(numChannels);
+        out.writeInt(samplesPerFrame);
+        out.writeInt(encoderDelay);
+        out.writeInt(encoderPadding);
+        out.writeBool(hasGaplessInfo);
+        out.writeInt((int) frameOffsets.size());
+
+        for (auto offset : frameOffsets)
+            out.writeInt((int) offset);
+
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+//==============================================================================
+// One thread for the whole process that keeps the parked decoders of background-seeking
+// readers warm and deletes the ones they've finished with. It polls rather than being
+// woken, so the audio thread never has to signal it.
+class IndexedMp3Reader::Preparer : public juce::Thread,
+                                  public juce::DeletedAtShutdown
+{
+public:
+    Preparer()
+        : juce::Thread("MP3 seek")
+    {
+        startThread(juce::Thread::Priority::high);
+    }
+
+    ~Preparer() override
+    {
+        stopThread(4000);
+        clearSingletonInstance();
+    }
+
+    void add(IndexedMp3Reader* reader)
+    {
+        const juce::ScopedLock sl(lock);
+        readers.add(reader);
+    }
+
+    // once this returns the reader is never serviced again
+    void remove(IndexedMp3Reader* reader)
+    {
+        const juce::ScopedLock sl(lock);
+        readers.removeFirstMatchingValue(reader);
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            {
+                const juce::ScopedLock sl(lock);
+
+                for (auto* reader : readers)
+                    reader->serviceRequests();
+            }
+
+            wait(50);
+        }
+    }
+
+    JUCE_DECLARE_SINGLETON(Preparer, false)
+
+private:
+    juce::CriticalSection lock;
+    juce::Array<IndexedMp3Reader*> readers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Preparer)
+};
+
+JUCE_IMPLEMENT_SINGLETON(IndexedMp3Reader::Preparer)
+
+//==============================================================================
+IndexedMp3Reader::IndexedMp3Reader(const juce::File& mp3File, std::shared_ptr<const Mp3SeekIndex> seekIndex,
+                                   Seeking seekingMode)
+    : juce::AudioFormatReader(nullptr, "MP3 file"),
+      file(mp3File),
+      index(std::move(seekIndex)),
+      seeking(seekingMode)
+{
+    sampleRate = index->sampleRate;
+    bitsPerSample = 32;
+    usesFloatingPointData = true;
+    numChannels = (unsigned int) index->numChannels;
+    lengthInSamples = index->getLengthInSamples();
+
+    if (seeking == Seeking::background)
+    {
+        preparer = Preparer::getInstance();
+        preparer->add(this);
+    }
+}
+
+IndexedMp3Reader::~IndexedMp3Reader()
+{
+    if (preparer != nullptr)
+        preparer->remove(this);
+
+    delete prepared.exchange(nullptr);
+    delete parked.exchange(nullptr);
+    deleteRetiredDecoders();
+}
+
+bool IndexedMp3Reader::openAt(juce::int64 startSampleInFile)
+{
+    decoder = openDecoder(startSampleInFile + index->getDecoderStartSkip());
+    opened = true;
+    return decoder != nullptr;
+}
+
+void IndexedMp3Reader::prepareSeek(juce::int64 startSampleInFile)
+{
+    jassert(seeking == Seeking::background);
+
+    auto target = juce::jmax((juce::int64) 0, startSampleInFile + index->getDecoderStartSkip() - seekSlack);
+
+    // only the reading thread takes it, and it owns whatever it exchanges out
+    if (auto fresh = openDecoder(target))
+        delete prepared.exchange(fresh.release(), std::memory_order_release);
+}
+
+void IndexedMp3Reader::parkAt(juce::int64 startSampleInFile)
+{
+    jassert(seeking == Seeking::background);
+
+    parkTarget = startSampleInFile < 0 ? -1
+                                       : juce::jmax((juce::int64) 0, startSampleInFile + index->getDecoderStartSkip() - seekSlack);
+}
+
+bool IndexedMp3Reader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                   juce::int64 startSampleInFile, int numSamples)
+{
+    clearSamplesBeyondAvailableLength(destChannels, numDestChannels, startOffsetInDestBuffer,
+                                      startSampleInFile, numSamples, lengthInSamples);
+
+    if (numSamples <= 0)
+        return true;
+
+    auto decoderSample = startSampleInFile + index->getDecoderStartSkip();
+
+    // the first decoder is always started by whoever reads first
+    if (!opened)
+    {
+        if (!openAt(startSampleInFile))
+            return false;
+    }
+
+    if (decoder == nullptr || !canCatchUp(*decoder, decoderSample))
+    {
+        std::unique_ptr<Decoder> fresh;
+
+        if (seeking == Seeking::background)
+            fresh = takeReadyDecoder(decoderSample);
+
+        // nothing was opened ahead for this seek: open it here, the index keeps that to a frame or two
+        if (fresh == nullptr)
+            fresh = openDecoder(decoderSample);
+
+        if (fresh == nullptr)
+            return false;
+
+        if (seeking == Seeking::background)
+            retire(decoder.release());
+
+        decoder = std::move(fresh);
+    }
+
+    // a short skip forward is decoded through, using the destination as scratch
+    if (!decodeForward(*decoder, decoderSample, destChannels, numDestChannels, startOffsetInDestBuffer, numSamples))
+        return false;
+
+    bool ok = decoder->reader->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer,
+                                           decoderSample - decoder->base, numSamples);
+    decoder->position += numSamples;
+    return ok;
+}
+
+bool IndexedMp3Reader::canCatchUp(const Decoder& d, juce::int64 decoderSample) const
+{
+    return decoderSample >= d.position && decoderSample - d.position <= maxCatchUpSamples;
+}
+
+// Reading thread: a decoder opened ahead of time that can serve this read, either the one
+// prepareSeek() opened or the one parked at the loop start. A parked decoder that doesn't
+// fit stays parked; the Preparer re-parks once one has been used.
+std::unique_ptr<IndexedMp3Reader::Decoder> IndexedMp3Reader::takeReadyDecoder(juce::int64 decoderSample)
+{
+    if (auto* ready = prepared.exchange(nullptr, std::memory_order_acquire))
+    {
+        if (canCatchUp(*ready, decoderSample))
+            return std::unique_ptr<Decoder>(ready);
+
+        retire(ready);
+    }
+
+    if (auto* ready = parked.exchange(nullptr, std::memory_order_acquire))
+    {
+        if (canCatchUp(*ready, decoderSample))
+            return std::unique_ptr<Decoder>(ready);
+
+        Decoder* none = nullptr;
+        if (!parked.compare_exchange_strong(none, ready, std::memory_order_release))
+            retire(ready);
+    }
+
+    return {};
+}
+
+void IndexedMp3Reader::retire(Decoder* old)
+{
+    if (old == nullptr)
+        return;
+
+    // the Preparer has fallen behind; deleting here beats leaking
+    if (retiredFifo.getFreeSpace() == 0)
+    {
+        delete old;
+        return;
+    }
+
+    const auto scope = retiredFifo.write(1);
+    retired[scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2] = old;
+}
+
+void IndexedMp3Reader::deleteRetiredDecoders()
+{
+    const auto scope = retiredFifo.read(retiredFifo.getNumReady());
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        delete std::exchange(retired[scope.startIndex1 + i], nullptr);
+
+    for (int i = 0; i < scope.blockSize2; ++i)
+        delete std::exchange(retired[scope.startIndex2 + i], nullptr);
+}
+
+void IndexedMp3Reader::serviceRequests()
+{
+    deleteRetiredDecoders();
+
+    auto target = parkTarget.load(std::memory_order_relaxed);
+
+    if (target < 0)
+    {
+        delete parked.exchange(nullptr, std::memory_order_acquire);
+        parkedAt = -1;
+        return;
+    }
+
+    // a new target, or the reading thread has taken the last one
+    if (target != parkedAt || parked.load(std::memory_order_relaxed) == nullptr)
+    {
+        parkedAt = target;
+
+        if (auto fresh = openDecoder(target))
+            delete parked.exchange(fresh.release(), std::memory_order_acq_rel);
+    }
+}
+
+// Reads and throws away samples until the decoder is at decoderSample.
+bool IndexedMp3Reader::decodeForward(Decoder& d, juce::int64 decoderSample, int* const* scratch,
+                                     int numScratchChannels, int scratchOffset, int scratchSize)
+{
+    while (d.position < decoderSample)
+    {
+        auto num = (int) juce::jmin((juce::int64) scratchSize, decoderSample - d.position);
+
+        if (!d.reader->readSamples(scratch, numScratchChannels, scratchOffset, d.position - d.base, num))
+            return false;
+
+        d.position += num;
+    }
+
+    return true;
+}
+
+std::unique_ptr<IndexedMp3Reader::Decoder> IndexedMp3Reader::openDecoder(juce::int64 decoderSample)
+{
+   #if JUCE_USE_MP3AUDIOFORMAT
+    auto d = std::make_unique<Decoder>();
+    d->file = std::make_unique<juce::FileInputStream>(file);
+
+    if (!d->file->openedOk())
+        return {};
+
+    const auto& offsets = index->frameOffsets;
+    auto lastFrame = (juce::int64) offsets.size() - 1;
+    auto targetFrame = juce::jlimit((juce::int64) 0, lastFrame, decoderSample / index->samplesPerFrame);
+
+    // back up far enough to cover the bit reservoir, plus one frame for the MDCT overlap
+    auto firstFrame = targetFrame;
+    while (firstFrame > 0 && offsets[(size_t) targetFrame] - offsets[(size_t) firstFrame] < kMaxReservoirBytes)
+        --firstFrame;
+    firstFrame = juce::jmax((juce::int64) 0, firstFrame - 1);
+
+    auto byteStart = (juce::int64) offsets[(size_t) firstFrame];
+    auto* region = new juce::SubregionStream(d->file.get(), byteStart,
+                                             d->file->getTotalLength() - byteStart, false);
+
+    d->reader.reset(mp3Format.createReaderFor(region, true));
+    if (d->reader == nullptr)
+        return {};
+
+    d->base = d->position = firstFrame * index->samplesPerFrame;
+
+    // Decode the preroll frames rather than asking the decoder to start at the target: its
+    // own seek re-syncs on the next frame header and would skip the frames that fill the
+    // bit reservoir.
+    juce::AudioBuffer<float> scratch((int) numChannels, index->samplesPerFrame);
+    if (!decodeForward(*d, decoderSample, reinterpret_cast<int* const*>(scratch.getArrayOfWritePointers()),
+                       (int) numChannels, 0, scratch.getNumSamples()))
+        return {};
+
+    return d;
+   #else
+    juce::ignoreUnused(decoderSample);
+    return {};
+   #endif
+}
+
+//==============================================================================
+JUCE_IMPLEMENT_SINGLETON(Mp3SeekIndexStore)
+
+Mp3SeekIndexStore::Mp3SeekIndexStore() {}
+
+Mp3SeekIndexStore::~Mp3SeekIndexStore()
+{
+    clearSingletonInstance();
+}
+
+// Runs on a scheduler worker. Not tied to a group: a finished index is written to disk,
+// so it's worth completing even if the deck has moved on.
+void Mp3SeekIndexStore::loadOrBuild(juce::WeakReference<Mp3SeekIndexStore> store, const juce::File& mp3File)
+{
+    auto indexFile = getIndexFileFor(mp3File);
+    std::shared_ptr<Mp3SeekIndex> index(Mp3SeekIndex::readFrom(indexFile));
+
+    if (index == nullptr || !index->matches(mp3File))
+    {
+        index = Mp3SeekIndex::build(mp3File);
+
+        if (index != nullptr)
+            index->writeTo(indexFile);
+    }
+
+    juce::MessageManager::callAsync([store, mp3File, index]
+    {
+        if (auto* s = store.get())
+            s->indexFinished(mp3File, index);
+    });
+}
+
+juce::File Mp3SeekIndexStore::getIndexFileFor(const juce::File& mp3File)
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("SimpleAudioPlayer")
+        .getChildFile("SeekIndex")
+        .getChildFile(juce::String::toHexString(mp3File.getFullPathName().hashCode64()) + ".mp3idx");
+}
+
+void Mp3SeekIndexStore::requestIndex(const juce::File& mp3File, const void* owner, Callback onReady)
+{
+    auto key = mp3File.getFullPathName();
+    Index ready;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        auto found = loaded.find(key);
+        if (found != loaded.end() && found->second->matches(mp3File))
+        {
+            ready = found->second;
+            touch(key);
+        }
+        else
+        {
+            auto& waiting = pending[key];
+            waiting.push_back({ owner, std::move(onReady) });
+
+            if (waiting.size() == 1)
+            {
+                juce::WeakReference<Mp3SeekIndexStore> weakThis(this);
+                JobScheduler::getInstance()->schedule("Index " + mp3File.getFileName(),
+                                                      JobScheduler::Priority::loadedTrack, JobScheduler::noGroup,
+                                                      [weakThis, mp3File](const JobScheduler::Context&) { loadOrBuild(weakThis, mp3File); });
+            }
+
+            return;
+        }
+    }
+
+    onReady(ready);
+}
+
+void Mp3SeekIndexStore::cancelRequests(const void* owner)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (auto& p : pending)
+        p.second.erase(std::remove_if(p.second.begin(), p.second.end(),
+                                      [owner](const Request& r) { return r.owner == owner; }),
+                       p.second.end());
+}
+
+void Mp3SeekIndexStore::touch(const juce::String& key)
+{
+    recentlyUsed.removeString(key);
+    recentlyUsed.add(key);
+}
+
+void Mp3SeekIndexStore::indexFinished(const juce::File& mp3File, Index index)
+{
+    std::vector<Request> requests;
+
+    {
+        const juce::ScopedLock sl(lock);
+        auto key = mp3File.getFullPathName();
+
+        if (index != nullptr)
+        {
+            // indexes are small, but don't keep every file ever loaded around
+            loaded[key] = index;
+            touch(key);
+
+            while (recentlyUsed.size() > maxLoaded)
+            {
+                loaded.erase(recentlyUsed[0]);
+                recentlyUsed.remove(0);
+            }
+        }
+
+        auto it = pending.find(key);
+        if (it != pending.end())
+        {
+            requests = std::move(it->second);
+            pending.erase(it);
+        }
+    }
+
+    for (auto& r : requests)
+        r.callback(index);
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+#include <functional>
+#include <map>
+#include <atomic>
+#include <memory>
+
+// Byte offset of every MPEG-1 Layer III audio frame in a file, plus the LAME/Xing
+// gapless info (encoder delay/padding). With it a seek is a table lookup instead of
+// a scan through every frame header from the start of the file.
+struct Mp3SeekIndex
+{
+    double sampleRate = 0.0;
+    int numChannels = 2;
+    int samplesPerFrame = 1152;
+    int encoderDelay = 0;
+    int encoderPadding = 0;
+    bool hasGaplessInfo = false;
+    std::vector<juce::uint32> frameOffsets;
+
+    // used to tell whether a persisted index still matches the file on disk
+    juce::int64 sourceFileSize = 0;
+    juce::int64 sourceModificationTime = 0;
+
+    // decoder output samples to drop so sample 0 is the first sample the encoder was given
+    juce::int64 getDecoderStartSkip() const;
+    juce::int64 getLengthInSamples() const;
+
+    bool matches(const juce::File& mp3File) const;
+
+    size_t getSizeInBytes() const { return sizeof(Mp3SeekIndex) + frameOffsets.size() * sizeof(juce::uint32); }
+
+    static std::unique_ptr<Mp3SeekIndex> build(const juce::File& mp3File);
+    static std::unique_ptr<Mp3SeekIndex> readFrom(const juce::File& indexFile);
+    bool writeTo(const juce::File& indexFile) const;
+};
+
+// Plays an MP3 using its seek index: contiguous reads go straight to the decoder, a seek
+// starts a fresh decoder a few frames before the target frame and decodes its way up to
+// the exact requested position, so the bit reservoir is filled by real frames.
+//
+// Starting a decoder opens the file and allocates, so with Seeking::background the reader
+// is meant to be started by something other than the audio thread (see openAt()), and
+// seeks are opened ahead of time: prepareSeek() before the playhead is moved, parkAt() for
+// a spot playback is about to jump back to (a loop start), kept warm by a shared
+// background thread. Ready decoders are swapped in through atomic pointers and the ones
+// they replace are deleted on that thread. A seek nobody announced still opens a decoder
+// on the spot, which with the index costs a frame or two of decoding, never silence.
+class IndexedMp3Reader : public juce::AudioFormatReader
+{
+public:
+    enum class Seeking { blocking, background };
+
+    IndexedMp3Reader(const juce::File& mp3File, std::shared_ptr<const Mp3SeekIndex> seekIndex,
+                     Seeking seekingMode = Seeking::blocking);
+    ~IndexedMp3Reader() override;
+
+    // starts the first decoder at this sample; call before handing the reader to the audio thread
+    bool openAt(juce::int64 startSampleInFile);
+
+    // Seeking::background, not on the audio thread: opens a decoder for a read about to
+    // start at this sample, so the seek finds it ready
+    void prepareSeek(juce::int64 startSampleInFile);
+
+    // Seeking::background: keeps a decoder parked at this sample until told otherwise
+    // (-1 drops it), for a jump that happens on the audio thread without warning
+    void parkAt(juce::int64 startSampleInFile);
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    class Preparer;
+
+    struct Decoder
+    {
+        std::unique_ptr<juce::FileInputStream> file;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        juce::int64 base = 0;     // decoder-timeline sample where this decoder starts
+        juce::int64 position = 0; // where a contiguous read continues
+    };
+
+    // furthest a read may skip forward on the current decoder by decoding, instead of seeking
+    static constexpr int maxCatchUpSamples = 8192;
+    static constexpr int maxRetired = 8;
+    // decoders opened ahead of time stop this far short of their target, so a seek that
+    // rounds a little differently still lands where they can catch up
+    static constexpr int seekSlack = 256;
+
+    std::unique_ptr<Decoder> openDecoder(juce::int64 decoderSample);
+    static bool decodeForward(Decoder& decoder, juce::int64 decoderSample, int* const* scratch,
+                              int numScratchChannels, int scratchOffset, int scratchSize);
+    bool canCatchUp(const Decoder& d, juce::int64 decoderSample) const;
+    std::unique_ptr<Decoder> takeReadyDecoder(juce::int64 decoderSample);
+    void retire(Decoder* old);
+    void deleteRetiredDecoders();
+    void serviceRequests(); // on the Preparer's thread
+
+    const juce::File file;
+    std::shared_ptr<const Mp3SeekIndex> index;
+    const Seeking seeking;
+    Preparer* preparer = nullptr;
+
+   #if JUCE_USE_MP3AUDIOFORMAT
+    juce::MP3AudioFormat mp3Format;
+   #endif
+
+    std::unique_ptr<Decoder> decoder;
+    bool opened = false;
+
+    // Seeking::background: reading thread <-> prepareSeek() and the Preparer
+    std::atomic<Decoder*> prepared{ nullptr };
+    std::atomic<Decoder*> parked{ nullptr };
+    std::atomic<juce::int64> parkTarget{ -1 };
+    juce::int64 parkedAt = -1; // Preparer only
+    juce::AbstractFifo retiredFifo{ maxRetired };
+    Decoder* retired[maxRetired] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IndexedMp3Reader)
+};
+
+// Builds seek indexes in the background and persists them next to the app settings,
+// so a file is only ever scanned once.
+class Mp3SeekIndexStore : public juce::DeletedAtShutdown
+{
+public:
+    using Index = std::shared_ptr<const Mp3SeekIndex>;
+    using Callback = std::function<void(Index)>;
+
+    Mp3SeekIndexStore();
+    ~Mp3SeekIndexStore() override;
+
+    // The callback runs on the message thread with the index, or nullptr if the file can't be indexed.
+    void requestIndex(const juce::File& mp3File, const void* owner, Callback onReady);
+    void cancelRequests(const void* owner);
+
+    static juce::File getIndexFileFor(const juce::File& mp3File);
+
+    JUCE_DECLARE_SINGLETON(Mp3SeekIndexStore, false)
+
+private:
+    struct Request
+    {
+        const void* owner;
+        Callback callback;
+    };
+
+    static void loadOrBuild(juce::WeakReference<Mp3SeekIndexStore> store, const juce::File& mp3File);
+    void indexFinished(const juce::File& mp3File, Index index);
+
+    void touch(const juce::String& key); // called with lock held
+
+    static constexpr int maxLoaded = 32;
+
+    juce::CriticalSection lock;
+    std::map<juce::String, Index> loaded;
+    juce::StringArray recentlyUsed; // keys of loaded, least recently used first
+    std::map<juce::String, std::vector<Request>> pending;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(Mp3SeekIndexStore)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Mp3SeekIndexStore)
+};
@@ -0,0 +1,211 @@
+#include "OutputRouting.h"
+
+OutputRouting::OutputRouting()
+{
+    for (auto& route : toMaster)
+        route = true;
+
+    for (auto& route : toCue)
+        route = false;
+}
+
+void OutputRouting::prepare(int maximumBlockSize)
+{
+    cueBus.setSize(numBusChannels, maximumBlockSize);
+    cueBus.clear();
+    foldBus.setSize(numBusChannels, maximumBlockSize);
+    cueBusActive = false;
+}
+
+void OutputRouting::mixDecks(const std::array<DeckBus, numDecks>& decks,
+                             const std::array<float, numDecks>& faderGains,
+                             juce::AudioBuffer<float>& master, int numSamples)
+{
+    // only grow if the device delivers more than it announced
+    cueBus.setSize(numBusChannels, numSamples, false, false, true);
+    foldBus.setSize(numBusChannels, numSamples, false, false, true);
+
+    const int numMasterChannels = master.getNumChannels();
+    bool masterWritten = false;
+    cueBusActive = false;
+
+    for (size_t deck = 0; deck < (size_t) numDecks; ++deck)
+    {
+        const auto& bus = *decks[deck].buffer;
+        const int width = juce::jmin(decks[deck].numChannels, bus.getNumChannels());
+        const float masterGain = toMaster[deck].load() ? faderGains[deck] : 0.0f;
+        const float cueGain = toCue[deck].load() ? 1.0f : 0.0f;
+
+        // the first deck copies rather than adds, so neither bus needs clearing
+        for (int ch = 0; ch < numMasterChannels; ++ch)
+        {
+            if (ch < width)
+            {
+                if (masterWritten)
+                    master.addFromWithRamp(ch, 0, bus.getReadPointer(ch), numSamples, lastMasterGain[deck], masterGain);
+                else
+                    master.copyFromWithRamp(ch, 0, bus.getReadPointer(ch), numSamples, lastMasterGain[deck], masterGain);
+            }
+            else if (!masterWritten)
+            {
+                master.clear(ch, 0, numSamples);
+            }
+        }
+
+        if (cueGain > 0.0f || lastCueGain[deck] > 0.0f)
+        {
+            // the headphones are a pair, so a wide deck is folded for them
+            const auto* cueSource = &bus;
+            if (width > numBusChannels && decks[deck].fold != nullptr)
+            {
+                decks[deck].fold->process(bus, 0, foldBus, 0, numSamples);
+                cueSource = &foldBus;
+            }
+
+            for (int ch = 0; ch < numBusChannels; ++ch)
+            {
+                const auto* source = cueSource->getReadPointer(juce::jmin(ch, cueSource->getNumChannels() - 1));
+
+                if (cueBusActive)
+                    cueBus.addFromWithRamp(ch, 0, source, numSamples, lastCueGain[deck], cueGain);
+                else
+                    cueBus.copyFromWithRamp(ch, 0, source, numSamples, lastCueGain[deck], cueGain);
+            }
+        }
+
+        masterWritten = true;
+        cueBusActive = cueBusActive || cueGain > 0.0f || lastCueGain[deck] > 0.0f;
+
+        lastMasterGain[deck] = masterGain;
+        lastCueGain[deck] = cueGain;
+    }
+}
+
+void OutputRouting::renderHeadphones(juce::AudioBuffer<float>& output, int numMasterChannels, int startSample, int numSamples)
+{
+    const int numOutputs = output.getNumChannels();
+    const int firstHeadphone = juce::jmax(numBusChannels, numMasterChannels);
+    const bool available = numOutputs >= firstHeadphone + numBusChannels;
+
+    headphonesAvailable = available;
+    firstHeadphoneOutput = firstHeadphone;
+
+    // without room for a headphone pair the cue bus goes nowhere
+    for (int ch = available ? firstHeadphone + numBusChannels : numMasterChannels; ch < numOutputs; ++ch)
+        output.clear(ch, startSample, numSamples);
+
+    if (!available)
+        return;
+
+    const float level = headphoneLevel.load();
+    const float mix = cueMix.load();
+    const float cueGain = level * (1.0f - mix);
+    const float masterGain = level * mix;
+
+    // a master wider than stereo is folded for the blend
+    const float* masterPair[numBusChannels] = { output.getReadPointer(0, startSample),
+                                                output.getReadPointer(juce::jmin(1, numMasterChannels - 1), startSample) };
+
+    if (numMasterChannels > numBusChannels)
+    {
+        if (masterFold.getNumInputs() != numMasterChannels)
+            masterFold = DownmixMatrix::forLayout(numMasterChannels, DownmixMatrix::Preset::automatic);
+
+        foldBus.setSize(numBusChannels, numSamples, false, false, true);
+        masterFold.process(output, startSample, foldBus, 0, numSamples);
+
+        for (int ch = 0; ch < numBusChannels; ++ch)
+            masterPair[ch] = foldBus.getReadPointer(ch);
+    }
+
+    for (int ch = 0; ch < numBusChannels; ++ch)
+    {
+        const int dest = firstHeadphone + ch;
+
+        if (cueBusActive)
+            output.copyFromWithRamp(dest, startSample, cueBus.getReadPointer(ch), numSamples, lastHeadphoneCueGain, cueGain);
+        else
+            output.clear(dest, startSample, numSamples);
+
+        output.addFromWithRamp(dest, startSample, masterPair[ch], numSamples, lastHeadphoneMasterGain, masterGain);
+    }
+
+    lastHeadphoneCueGain = cueGain;
+    lastHeadphoneMasterGain = masterGain;
+}
+
+//==============================================================================
+RoutingStrip::RoutingStrip(OutputRouting& routingToEdit)
+    : routing(routingToEdit)
+{
+    for (int deck = 0; deck < OutputRouting::numDecks; ++deck)
+    {
+        auto& label = deckLabels[(size_t) deck];
+        label.setText(deck == 0 ? "Deck A" : "Deck B", juce::dontSendNotification);
+        label.setColour(juce::Label::textColourId, juce::Colours::white);
+        addAndMakeVisible(label);
+
+        auto& master = masterButtons[(size_t) deck];
+        master.setButtonText("Master");
+        master.setToggleState(routing.isDeckToMaster(deck), juce::dontSendNotification);
+        master.onClick = [this, deck] { routing.setDeckToMaster(deck, masterButtons[(size_t) deck].getToggleState()); };
+        addAndMakeVisible(master);
+
+        auto& cue = cueButtons[(size_t) deck];
+        cue.setButtonText("Cue");
+        cue.setTooltip("Pre-listen on the headphone outputs (3/4, or the pair after a surround master)");
+        cue.setToggleState(routing.isDeckToCue(deck), juce::dontSendNotification);
+        cue.onClick = [this, deck] { routing.setDeckToCue(deck, cueButtons[(size_t) deck].getToggleState()); };
+        addAndMakeVisible(cue);
+    }
+
+    for (auto* label : { &blendLabel, &levelLabel })
+    {
+        label->setColour(juce::Label::textColourId, juce::Colours::white);
+        label->setJustificationType(juce::Justification::centredRight);
+        addAndMakeVisible(label);
+    }
+
+    for (auto* slider : { &blendSlider, &levelSlider })
+    {
+        slider->setSliderStyle(juce::Slider::LinearHorizontal);
+        slider->setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+        slider->setRange(0.0, 1.0);
+        addAndMakeVisible(slider);
+    }
+
+    blendSlider.setValue(routing.getCueMix(), juce::dontSendNotification);
+    blendSlider.setDoubleClickReturnValue(true, 0.5);
+    blendSlider.onValueChange = [this] { routing.setCueMix((float) blendSlider.getValue()); };
+
+    levelSlider.setValue(routing.getHeadphoneLevel(), juce::dontSendNotification);
+    levelSlider.onValueChange = [this] { routing.setHeadphoneLevel((float) levelSlider.getValue()); };
+
+    startTimerHz(4);
+}
+
+void RoutingStrip::resized()
+{
+    auto area = getLocalBounds();
+
+    for (int deck = 0; deck < OutputRouting::numDecks; ++deck)
+    {
+        deckLabels[(size_t) deck].setBounds(area.removeFromLeft(60));
+        masterButtons[(size_t) deck].setBounds(area.removeFromLeft(80));
+        cueButtons[(size_t) deck].setBounds(area.removeFromLeft(60));
+        area.removeFromLeft(12);
+    }
+
+    levelSlider.setBounds(area.removeFromRight(120));
+    levelLabel.setBounds(area.removeFromRight(60));
+    blendSlider.setBounds(area.removeFromRight(160));
+    blendLabel.setBounds(area.removeFromRight(100));
+}
+
+// the headphone controls only matter on devices with four or more outputs
+void RoutingStrip::timerCallback()
+{
+    const bool available = routing.hasHeadphoneOutputs();
+    blendSlider.setEnabled(available);
+    levelSlider.setEnabled(available);
+}
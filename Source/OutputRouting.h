@@ -0,0 +1,98 @@
+#pragma once
+#include <JuceHeader.h>
+#include "DownmixMatrix.h"
+#include <array>
+#include <atomic>
+
+// Where each deck goes: the master (device outputs 1/2, after the crossfader) and/or the
+// cue bus, which is heard pre-fader on the headphone pair blended with the master. A deck
+// playing a wider track on its own outputs widens the master to match (outputs 1..N) and
+// the headphone pair moves up to the two outputs after it; otherwise it is outputs 3/4.
+// Routing and blend are set from the message thread; changes ramp over one block so
+// nothing clicks. All buffers are allocated up front.
+class OutputRouting
+{
+public:
+    static constexpr int numDecks = 2;
+    static constexpr int numBusChannels = 2;                        // cue bus, headphones, a folded deck
+    static constexpr int maxBusChannels = DownmixMatrix::maxInputs; // a deck or master carrying a track's own channels
+
+    // A deck's output for one block: the first numChannels channels of buffer. A bus wider
+    // than stereo is folded with fold for the cue bus.
+    struct DeckBus
+    {
+        const juce::AudioBuffer<float>* buffer = nullptr;
+        int numChannels = numBusChannels;
+        const DownmixMatrix* fold = nullptr;
+    };
+
+    OutputRouting();
+
+    void setDeckToMaster(int deck, bool shouldBeRouted) { toMaster[(size_t) deck] = shouldBeRouted; }
+    bool isDeckToMaster(int deck) const { return toMaster[(size_t) deck].load(); }
+    void setDeckToCue(int deck, bool shouldBeRouted) { toCue[(size_t) deck] = shouldBeRouted; }
+    bool isDeckToCue(int deck) const { return toCue[(size_t) deck].load(); }
+
+    // 0 = cue bus only, 1 = master only
+    void setCueMix(float newMix) { cueMix = juce::jlimit(0.0f, 1.0f, newMix); }
+    float getCueMix() const { return cueMix.load(); }
+    void setHeadphoneLevel(float newLevel) { headphoneLevel = juce::jlimit(0.0f, 1.0f, newLevel); }
+    float getHeadphoneLevel() const { return headphoneLevel.load(); }
+
+    // whether the last device buffer had the headphone pair, and where it starts (0-based)
+    bool hasHeadphoneOutputs() const { return headphonesAvailable.load(); }
+    int getFirstHeadphoneOutput() const { return firstHeadphoneOutput.load(); }
+
+    void prepare(int maximumBlockSize);
+
+    // Audio thread: sums the decks into every channel of master (from sample 0) with their
+    // crossfader gains, and into the cue bus. A deck narrower than the master only reaches
+    // its first channels.
+    void mixDecks(const std::array<DeckBus, numDecks>& decks,
+                  const std::array<float, numDecks>& faderGains,
+                  juce::AudioBuffer<float>& master, int numSamples);
+
+    // Audio thread, once the master is final: fills the headphone pair after the master's
+    // numMasterChannels outputs and silences any outputs past it. Doesn't touch the master.
+    void renderHeadphones(juce::AudioBuffer<float>& output, int numMasterChannels, int startSample, int numSamples);
+
+private:
+    std::array<std::atomic<bool>, numDecks> toMaster, toCue;
+    std::atomic<float> cueMix{ 0.0f }, headphoneLevel{ 0.8f };
+    std::atomic<bool> headphonesAvailable{ false };
+    std::atomic<int> firstHeadphoneOutput{ numBusChannels };
+
+    // audio thread only
+    juce::AudioBuffer<float> cueBus;
+    juce::AudioBuffer<float> foldBus; // a wide deck or master folded to stereo
+    DownmixMatrix masterFold;
+    bool cueBusActive = false;
+    std::array<float, numDecks> lastMasterGain{}, lastCueGain{};
+    float lastHeadphoneCueGain = 0.0f, lastHeadphoneMasterGain = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OutputRouting)
+};
+
+// Toggles for the routing matrix plus the headphone blend and level, one row.
+class RoutingStrip : public juce::Component,
+                     private juce::Timer
+{
+public:
+    explicit RoutingStrip(OutputRouting& routingToEdit);
+
+    void resized() override;
+
+private:
+    void timerCallback() override;
+
+    OutputRouting& routing;
+
+    std::array<juce::Label, OutputRouting::numDecks> deckLabels;
+    std::array<juce::ToggleButton, OutputRouting::numDecks> masterButtons, cueButtons;
+    juce::Label blendLabel{ {}, "Cue / Master" };
+    juce::Slider blendSlider;
+    juce::Label levelLabel{ {}, "Phones" };
+    juce::Slider levelSlider;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RoutingStrip)
+};
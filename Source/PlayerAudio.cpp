@@ -1,17 +1,19 @@
 ﻿#include "PlayerAudio.h"
+#include "MappedPcmReader.h"
+#include "CodecRegistry.h"
+#include "AppLog.h"
 #include <taglib/fileref.h>           //  لقراءة الميتاداتا
 #include <taglib/tag.h>               //  للوصول إلى البيانات (title, artist, album)
 #include <taglib/audioproperties.h>   //  لقراءة خصائص الصوت (المدة، إلخ)
 
 
 // CHANGED: global ApplicationProperties so JUCE manages single settings file for the app.
-// We use per-player key prefixes to avoid collisions when multiple PlayerAudio instances exist.
+// Hot cues are keyed by file, so both decks share it; deck state lives in SessionJournal.
 static juce::ApplicationProperties appProperties;
 
-PlayerAudio::PlayerAudio()
+PlayerAudio::PlayerAudio(const juce::String& deckSessionId)
+    : sessionId(deckSessionId)
 {
-    formatManager.registerBasicFormats();
-
     // ✅ إعداد التخزين مرة واحدة فقط
     static bool propsInitialized = false;
     if (!propsInitialized)
@@ -26,20 +28,27 @@ PlayerAudio::PlayerAudio()
         appProperties.setStorageParameters(options);
         propsInitialized = true;
     }
-
-    // ✅ اجعل المفتاح ثابتًا، مش بيعتمد على pointer
-    settingsKeyPrefix = "player_main_";
-
-    if (auto* userSettings = appProperties.getUserSettings())
-        DBG("PlayerAudio constructed. Settings file: " << userSettings->getFile().getFullPathName()
-            << "  keyPrefix=" << settingsKeyPrefix);
-
-    loadLastSession();
 }
 
 PlayerAudio::~PlayerAudio()
 {
+    if (auto* cache = DecodedAudioCache::getInstanceWithoutCreating())
+        cache->cancelRequests(this);
+
+    if (auto* indexStore = Mp3SeekIndexStore::getInstanceWithoutCreating())
+        indexStore->cancelRequests(this);
+
+    if (auto* loudness = LoudnessCache::getInstanceWithoutCreating())
+        loudness->cancelRequests(this);
+
+    if (auto* beats = BeatGridCache::getInstanceWithoutCreating())
+        beats->cancelRequests(this);
+
+    if (auto* scheduler = JobScheduler::getInstanceWithoutCreating())
+        scheduler->cancelGroup(loadJobs);
+
     // Save session on destruction
+    stopTimer();
     saveLastSession();
 
     // Close files to avoid leak warnings (safe to call multiple times)
@@ -48,84 +57,674 @@ PlayerAudio::~PlayerAudio()
     transportSource.releaseResources();
 }
 
-void PlayerAudio::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+void PlayerAudio::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
 {
+    sampleRate = newSampleRate;
     resamplingAudioSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    surroundResamplingSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    sourceBuffer.setSize(DownmixMatrix::maxInputs, samplesPerBlockExpected);
+    processingBytes = (size_t) DownmixMatrix::maxInputs * (size_t) samplesPerBlockExpected * sizeof(float);
+    eq.prepare(sampleRate);
+    inserts.prepare(sampleRate, samplesPerBlockExpected);
+    tap.prepare(sampleRate);
 }
 
 void PlayerAudio::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    resamplingAudioSource.getNextAudioBlock(bufferToFill);
+    const double callbackTimeMs = juce::Time::getMillisecondCounterHiRes();
+
+    applyControls(bufferToFill.numSamples);
+    applyDownmixChange();
+    collectDueEvents();
+
+    // the deck's bus: the track's own channels when it's on its own outputs, else stereo
+    juce::AudioBuffer<float> bus(bufferToFill.buffer->getArrayOfWritePointers(),
+                                 juce::jmin(busChannels.load(std::memory_order_relaxed), bufferToFill.buffer->getNumChannels()),
+                                 bufferToFill.startSample, bufferToFill.numSamples);
 
-    if (!isLooping && transportSource.getCurrentPosition() >= transportSource.getLengthInSeconds() - 0.05)
+    const double startPosition = getPosition();
+
+    // split the block at every scheduled event that falls inside it
+    const juce::int64 blockStart = clock != nullptr ? clock->getSampleTime() : 0;
+    int done = 0;
+
+    for (;;)
     {
-        transportSource.stop();
-        transportSource.setPosition(0.0);
+        while (numDueEvents > 0 && dueEvents[0].sampleTime <= blockStart + done)
+        {
+            applyEvent(dueEvents[0]);
+            std::move(dueEvents.begin() + 1, dueEvents.begin() + numDueEvents, dueEvents.begin());
+            --numDueEvents;
+        }
+
+        if (done >= bufferToFill.numSamples)
+            break;
+
+        int end = bufferToFill.numSamples;
+        if (numDueEvents > 0)
+            end = (int) juce::jmin((juce::int64) end, dueEvents[0].sampleTime - blockStart);
+
+        renderSegment(&bus, done, end - done);
+        done = end;
+    }
+
+    inserts.process(bus, 0, bufferToFill.numSamples);
+    tap.push(bus, 0, bufferToFill.numSamples);
+
+    if (!isLooping && !outputGated && transportSource.isPlaying()
+        && transportSource.getCurrentPosition() >= transportSource.getLengthInSeconds() - 0.05)
+    {
+        stopFromAudioThread(0.0);
     }
 
     
     loopBetweenTwoPoints();
+
+    playhead.publish(startPosition, getPosition(), bufferToFill.numSamples, sampleRate, callbackTimeMs);
 }
 
 void PlayerAudio::releaseResources()
 {
     resamplingAudioSource.releaseResources();
+    surroundResamplingSource.releaseResources();
+    inserts.release();
 }
 
 // ✅ تحميل ملف صوت وقراءة الميتاداتا باستخدام TagLib
 // =====================================================
 void PlayerAudio::loadFile(const juce::File& file)
 {
-    if (auto* reader = formatManager.createReaderFor(file))
+    DecodedAudioCache::getInstance()->cancelRequests(this);
+    Mp3SeekIndexStore::getInstance()->cancelRequests(this);
+    LoudnessCache::getInstance()->cancelRequests(this);
+
+    // RAM deck: reuse a copy that's already decoded (possibly by the other deck)
+    std::unique_ptr<juce::AudioFormatReader> ramReader;
+    DecodedAudioCache::Track ramTrack;
+    if (ramDeckEnabled)
+        if ((ramTrack = DecodedAudioCache::getInstance()->find(file)) != nullptr)
+            ramReader = std::make_unique<RamAudioReader>(ramTrack);
+
+    const bool fromRam = ramReader != nullptr;
+
+    // WAV/AIFF are served from a memory-mapped view; everything else goes through the decoder
+    std::unique_ptr<MappedPcmReader> mapped;
+    if (!fromRam)
+        mapped = MappedPcmReader::create(file);
+
+    auto* mappedPtr = mapped.get();
+    juce::AudioFormatReader* reader = fromRam ? ramReader.release()
+                                    : mapped != nullptr ? mapped.release()
+                                    : CodecRegistry::getInstance()->createReaderFor(file).release();
+
+    if (reader != nullptr)
     {
         transportSource.stop();
         transportSource.setSource(nullptr);
-        readerSource.reset(new juce::AudioFormatReaderSource(reader, true));
-        transportSource.setSource(readerSource.get(), 0, nullptr, reader->sampleRate);
+        mappedReader = mappedPtr;
+        indexedReader = nullptr;
+        playingFromRam = fromRam;
+        currentRamTrack = ramTrack;
+        currentSeekIndex = nullptr;
+        readerSource.reset(new juce::AudioFormatReaderSource(new HotCueReader(reader, hotCues, !fromRam && mappedPtr == nullptr), true));
+        transportSource.setSource(readerSource.get(), 0, nullptr, reader->sampleRate,
+                                  juce::jlimit(1, DownmixMatrix::maxInputs, (int) reader->numChannels));
 
         durationInSeconds = static_cast<double>(reader->lengthInSamples) / reader->sampleRate;
         lastLoadedFile = file;
 
-        // 🔹 قراءة الميتاداتا من TagLib بأمان
-        TagLib::FileRef f(file.getFullPathName().toRawUTF8());
-        if (!f.isNull() && f.tag())
+        sourceChannels = (int) reader->numChannels;
+        updateDownmix();
+
+        APP_LOG(deck, info, "{} loaded {} ({} channels, {} Hz, {})", sessionId, file.getFullPathName(),
+                (int) reader->numChannels, reader->sampleRate,
+                fromRam ? "from RAM" : mappedPtr != nullptr ? "memory-mapped" : "streamed");
+
+        // pre-decode this file's saved hot cues against the reader we just picked
+        hotCues.clearAll();
+        hotCues.setReaderFactory(makeReaderFactory(IndexedMp3Reader::Seeking::background));
+        scrub.setSource(makeReaderFactory(IndexedMp3Reader::Seeking::blocking));
+        loadHotCues();
+
+        // tags are read in the background; show the file name until they arrive
+        title = file.getFileNameWithoutExtension();
+        artist = "Unknown Artist";
+        album = "Unknown Album";
+        readMetadata(file);
+
+        // mapped files already come straight from the page cache, so only decode the rest
+        if (ramDeckEnabled && !playingFromRam && mappedReader == nullptr)
+            requestRamCopy();
+
+        updateNormalization();
+        requestBeatGrid();
+
+        // compressed MP3s get a frame index for fast, sample-exact seeking
+        if (!playingFromRam && file.hasFileExtension("mp3"))
+            requestSeekIndex();
+
+        play();
+    }
+    else
+    {
+        APP_LOG(deck, error, "{} couldn't open {}", sessionId, file.getFullPathName());
+        title = "Invalid File";
+        artist = "";
+        album = "";
+        durationInSeconds = 0.0;
+    }
+}
+// 🔹 قراءة الميتاداتا من TagLib بأمان (على خيط خلفي)
+void PlayerAudio::readMetadata(const juce::File& file)
+{
+    // whatever the previous track still had queued is no longer wanted
+    auto* scheduler = JobScheduler::getInstance();
+    scheduler->cancelGroup(loadJobs);
+    loadJobs = scheduler->createGroup();
+
+    juce::WeakReference<PlayerAudio> weakThis(this);
+
+    scheduler->schedule("Tags " + file.getFileName(), JobScheduler::Priority::loadedTrack, loadJobs,
+        [weakThis, file](const JobScheduler::Context& context)
         {
+            TagLib::FileRef f(file.getFullPathName().toRawUTF8());
+            if (f.isNull() || f.tag() == nullptr || context.shouldStop())
+                return;
+
             TagLib::Tag* tag = f.tag();
             TagLib::AudioProperties* props = f.audioProperties();
 
-            title = juce::String::fromUTF8(tag->title().toCString(true));
-            artist = juce::String::fromUTF8(tag->artist().toCString(true));
-            album = juce::String::fromUTF8(tag->album().toCString(true));
+            auto newTitle = juce::String::fromUTF8(tag->title().toCString(true));
+            auto newArtist = juce::String::fromUTF8(tag->artist().toCString(true));
+            auto newAlbum = juce::String::fromUTF8(tag->album().toCString(true));
+            int length = props != nullptr ? props->length() : 0;
 
-            if (title.isEmpty())  title = file.getFileNameWithoutExtension();
-            if (artist.isEmpty()) artist = "Unknown Artist";
-            if (album.isEmpty())  album = "Unknown Album";
+            juce::MessageManager::callAsync([weakThis, file, newTitle, newArtist, newAlbum, length]
+            {
+                auto* player = weakThis.get();
+                if (player == nullptr || player->lastLoadedFile != file)
+                    return;
 
-            if (props)
-                durationInSeconds = props->length();
+                if (newTitle.isNotEmpty())  player->title = newTitle;
+                if (newArtist.isNotEmpty()) player->artist = newArtist;
+                if (newAlbum.isNotEmpty())  player->album = newAlbum;
+
+                if (length > 0)
+                    player->durationInSeconds = length;
+            });
+        });
+}
+
+void PlayerAudio::renderSegment(juce::AudioBuffer<float>* buffer, int startSample, int numSamples)
+{
+    if (outputGated)
+    {
+        // once the message thread has asked the transport to stop, give it the one
+        // block it needs to acknowledge that, and throw the audio away
+        if (!transportSource.isPlaying())
+        {
+            pullSource(buffer, startSample, numSamples);
+            outputGated = false;
         }
-        else
+
+        buffer->clear(startSample, numSamples);
+        return;
+    }
+
+    if (scrubbing)
+        renderScrub(buffer, startSample, numSamples);
+    else
+        pullSource(buffer, startSample, numSamples);
+
+    eq.process(*buffer, startSample, numSamples);
+}
+
+// Audio thread: picks up a new track's layout or preset between blocks.
+void PlayerAudio::applyDownmixChange()
+{
+    if (!downmixChanged.load())
+        return;
+
+    const juce::SpinLock::ScopedTryLockType tl(downmixLock);
+    if (tl.isLocked())
+    {
+        downmix = pendingDownmix;
+        busChannels = pendingBusChannels;
+        downmixChanged = false;
+    }
+}
+
+// Audio thread: the next numSamples of the track at the current speed, on the deck's bus.
+void PlayerAudio::pullSource(juce::AudioBuffer<float>* buffer, int startSample, int numSamples)
+{
+    // the resampler that sat idle holds history from some earlier track
+    const bool useSurround = downmix.getNumInputs() > 2;
+    if (useSurround != surroundResamplerActive)
+    {
+        (useSurround ? surroundResamplingSource : resamplingAudioSource).flushBuffers();
+        surroundResamplerActive = useSurround;
+    }
+
+    // on its own outputs: every channel straight onto the bus, nothing to mix
+    if (buffer->getNumChannels() > DownmixMatrix::numOutputs)
+    {
+        surroundResamplingSource.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer, startSample, numSamples));
+        return;
+    }
+
+    if (downmix.isPassThrough())
+    {
+        resamplingAudioSource.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer, startSample, numSamples));
+        return;
+    }
+
+    // only grows if the device delivers more than it announced
+    sourceBuffer.setSize(DownmixMatrix::maxInputs, numSamples, false, false, true);
+    juce::AudioBuffer<float> source(sourceBuffer.getArrayOfWritePointers(), downmix.getNumInputs(), numSamples);
+
+    auto& resampler = useSurround ? surroundResamplingSource : resamplingAudioSource;
+    resampler.getNextAudioBlock(juce::AudioSourceChannelInfo(&source, 0, numSamples));
+
+    downmix.process(source, 0, *buffer, startSample, numSamples);
+}
+
+void PlayerAudio::setDownmixPreset(DownmixMatrix::Preset newPreset)
+{
+    downmixPreset = newPreset;
+    updateDownmix();
+}
+
+void PlayerAudio::setOutputChannels(int numOutputs)
+{
+    if (numOutputs != outputChannels)
+    {
+        outputChannels = numOutputs;
+        updateDownmix();
+    }
+}
+
+// message thread: a new track, preset or device
+void PlayerAudio::updateDownmix()
+{
+    const int channels = juce::jmax(1, sourceChannels.load());
+    const auto matrix = DownmixMatrix::forLayout(channels, downmixPreset);
+
+    // the fold is only the fallback for a device short of outputs
+    const bool ownOutputs = downmixPreset == DownmixMatrix::Preset::automatic
+                         && channels > DownmixMatrix::numOutputs
+                         && channels <= juce::jmin(outputChannels, DownmixMatrix::maxInputs);
+
+    {
+        const juce::SpinLock::ScopedLockType sl(downmixLock);
+        pendingDownmix = matrix;
+        pendingBusChannels = ownOutputs ? channels : DownmixMatrix::numOutputs;
+        downmixChanged = true;
+    }
+
+    scrub.setDownmix(matrix);
+}
+
+void PlayerAudio::setResamplingRatios(double ratio)
+{
+    resamplingAudioSource.setResamplingRatio(ratio);
+    surroundResamplingSource.setResamplingRatio(ratio);
+}
+
+// Audio thread. AudioTransportSource::stop() waits for the next audio callback, so it
+// must not be called here: go silent now and let handleAsyncUpdate() do the real stop.
+void PlayerAudio::stopFromAudioThread(double positionAfter)
+{
+    outputGated = true;
+    positionAfterStop = positionAfter;
+    stopRequested = true;
+    triggerAsyncUpdate();
+}
+
+void PlayerAudio::handleAsyncUpdate()
+{
+    if (stopRequested.exchange(false))
+    {
+        transportSource.stop();
+        transportSource.setPosition(positionAfterStop.load());
+    }
+
+    if (const auto cues = pendingHotCues.exchange(0))
+    {
+        for (int i = 0; i < HotCueBank::numCues; ++i)
         {
-            title = file.getFileNameWithoutExtension();
-            artist = "Unknown Artist";
-            album = "Unknown Album";
+            if ((cues >> (HotCueBank::numCues + i)) & 1)
+                setHotCue(i);
+
+            if ((cues >> i) & 1)
+                triggerHotCue(i);
         }
+    }
+}
 
-        play();
+void PlayerAudio::pushEvent(const ScheduledEvent& event)
+{
+    const auto scope = eventFifo.write(1);
+
+    if (scope.blockSize1 > 0)
+        eventQueue[(size_t) scope.startIndex1] = event;
+    else if (scope.blockSize2 > 0)
+        eventQueue[(size_t) scope.startIndex2] = event;
+    else
+        jassertfalse; // more than maxScheduledEvents pending
+}
+
+// Audio thread: moves newly scheduled events into the sorted due list.
+void PlayerAudio::collectDueEvents()
+{
+    const auto scope = eventFifo.read(eventFifo.getNumReady());
+
+    auto insert = [this](const ScheduledEvent& event)
+    {
+        if (numDueEvents == maxScheduledEvents)
+            return;
+
+        int i = numDueEvents++;
+        for (; i > 0 && dueEvents[(size_t) i - 1].sampleTime > event.sampleTime; --i)
+            dueEvents[(size_t) i] = dueEvents[(size_t) i - 1];
+
+        dueEvents[(size_t) i] = event;
+    };
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        insert(eventQueue[(size_t) (scope.startIndex1 + i)]);
+
+    for (int i = 0; i < scope.blockSize2; ++i)
+        insert(eventQueue[(size_t) (scope.startIndex2 + i)]);
+}
+
+void PlayerAudio::applyEvent(const ScheduledEvent& event)
+{
+    switch (event.type)
+    {
+        case ScheduledEvent::Type::start:
+            // a stop still being completed by the message thread wins
+            if (!outputGated)
+                transportSource.start();
+            break;
+
+        case ScheduledEvent::Type::stop:
+            if (transportSource.isPlaying() && !outputGated)
+                stopFromAudioThread(transportSource.getCurrentPosition());
+            break;
+
+        case ScheduledEvent::Type::seek:
+            transportSource.setPosition(event.position);
+            break;
+    }
+}
+
+void PlayerAudio::pushControl(ControlAction action, float value, double position)
+{
+    // if it's full, the controller is flooding us faster than blocks go by: drop it
+    const ControlEvent event{ action, value, position };
+    pushControls(&event, 1);
+}
+
+bool PlayerAudio::pushControls(const ControlEvent* events, int numEvents)
+{
+    const juce::SpinLock::ScopedLockType sl(controlPushLock);
+
+    if (controlFifo.getFreeSpace() < numEvents)
+        return false;
+
+    // the write position only moves when the scope ends, so the audio thread sees all of them at once
+    const auto scope = controlFifo.write(numEvents);
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        controlQueue[(size_t) (scope.startIndex1 + i)] = events[i];
+
+    for (int i = 0; i < scope.blockSize2; ++i)
+        controlQueue[(size_t) (scope.startIndex2 + i)] = events[scope.blockSize1 + i];
+
+    return true;
+}
+
+// Audio thread: applies everything the controllers sent since the last block.
+void PlayerAudio::applyControls(int numSamples)
+{
+    const auto scope = controlFifo.read(controlFifo.getNumReady());
+
+    auto apply = [this](const ControlEvent& event)
+    {
+        const bool playing = transportSource.isPlaying() && !outputGated;
+
+        switch (event.action)
+        {
+            case ControlAction::playPause:
+                if (playing)
+                    stopFromAudioThread(transportSource.getCurrentPosition());
+                else if (!outputGated)
+                    transportSource.start();
+                break;
+
+            // CDJ style: stopped sets the cue point, playing returns to it and stops
+            case ControlAction::cue:
+                if (playing)
+                    stopFromAudioThread(cuePoint.load());
+                else if (!outputGated)
+                    cuePoint = transportSource.getCurrentPosition();
+                break;
+
+            case ControlAction::loop:
+                loopABEnabled = !loopABEnabled.load();
+                break;
+
+            case ControlAction::play:
+                if (!playing && !outputGated)
+                    transportSource.start();
+                break;
+
+            case ControlAction::pause:
+                if (playing)
+                    stopFromAudioThread(transportSource.getCurrentPosition());
+                break;
+
+            case ControlAction::stop:
+                if (playing)
+                    stopFromAudioThread(0.0);
+                else if (!outputGated)
+                    transportSource.setPosition(0.0);
+                break;
+
+            case ControlAction::seek:
+                if (!outputGated)
+                    transportSource.setPosition(juce::jmax(0.0, event.position));
+                break;
+
+            case ControlAction::loopIn:
+                pointA = juce::jmax(0.0, event.position);
+                break;
+
+            case ControlAction::loopOut:
+                pointB = juce::jmax(0.0, event.position);
+                break;
+
+            case ControlAction::loopEnabled:
+                loopABEnabled = event.value > 0.5f;
+                break;
+
+            case ControlAction::gain:
+                setGain(event.value);
+                controllerGain = event.value;
+                break;
+
+            // vinyl: move the platter; otherwise bend the speed while playing, nudge while stopped
+            case ControlAction::jog:
+                if (vinylMode.load())
+                    pendingJogTicks += (int) event.value;
+                else if (playing)
+                    jogBend = juce::jlimit(-0.5f, 0.5f, jogBend + event.value * 0.02f);
+                else if (!outputGated)
+                    transportSource.setPosition(juce::jmax(0.0, transportSource.getCurrentPosition() + event.value / 75.0));
+                break;
+
+            case ControlAction::hotCue:
+            case ControlAction::setHotCue:
+            {
+                const int cueIndex = (int) event.value;
+                if (juce::isPositiveAndBelow(cueIndex, HotCueBank::numCues))
+                {
+                    const int bit = event.action == ControlAction::setHotCue ? HotCueBank::numCues + cueIndex : cueIndex;
+                    pendingHotCues.fetch_or(1u << bit);
+                    triggerAsyncUpdate();
+                }
+                break;
+            }
+        }
+    };
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        apply(controlQueue[(size_t) (scope.startIndex1 + i)]);
+
+    for (int i = 0; i < scope.blockSize2; ++i)
+        apply(controlQueue[(size_t) (scope.startIndex2 + i)]);
+
+    if (jogBend != 0.0f)
+    {
+        // the bend dies away over ~100 ms once the wheel stops
+        jogBend *= (float) std::exp(-numSamples / (0.1 * sampleRate));
+        if (std::abs(jogBend) < 1.0e-3f)
+            jogBend = 0.0f;
+
+        setResamplingRatios(currentSpeed * (1.0 + jogBend));
+    }
+
+    applyGainChange();
+    updateScrub(numSamples);
+}
+
+// Audio thread, once per block: decides whether the deck plays from the scrub buffer and
+// at what rate. A jog tick moves the "record" by kSecondsPerJogTick; between ticks the
+// platter is held for a moment, then the motor brings it back up to speed.
+void PlayerAudio::updateScrub(int numSamples)
+{
+    static constexpr double kSecondsPerJogTick = 1.8 / 128.0; // 128-step wheel, 33 rpm
+    static constexpr double kHoldSeconds = 0.05;
+    static constexpr double kMotorSeconds = 0.05;
+
+    const double sourceRate = scrub.getSourceSampleRate();
+    const bool playing = transportSource.isPlaying() && !outputGated;
+    const bool reversing = reverse.load() && playing;
+    const bool touched = pendingJogTicks != 0;
+
+    const int ticks = pendingJogTicks;
+    pendingJogTicks = 0;
+    jogIdleSamples = touched ? 0 : juce::jmin(jogIdleSamples + numSamples, 1 << 30);
+
+    if (sourceRate <= 0.0 || outputGated)
+        return;
+
+    const double normalRate = currentSpeed * sourceRate / sampleRate;
+
+    if (!scrubbing)
+    {
+        if (!touched && !reversing)
+        {
+            scrub.setPlayhead((juce::int64) (transportSource.getCurrentPosition() * sourceRate));
+            return;
+        }
+
+        scrubbing = true;
+        transportPositionAtScrub = transportSource.getCurrentPosition();
+        scrubPosition = transportPositionAtScrub * sourceRate;
+        scrubRate = playing ? normalRate : 0.0;
     }
+
+    // somebody seeked the (paused) transport meanwhile: follow it
+    if (transportSource.getCurrentPosition() != transportPositionAtScrub)
+    {
+        transportPositionAtScrub = transportSource.getCurrentPosition();
+        scrubPosition = transportPositionAtScrub * sourceRate;
+    }
+
+    const bool handOnPlatter = vinylMode.load() && jogIdleSamples < (int) (kHoldSeconds * sampleRate);
+    const double motorRate = reversing ? -normalRate : (playing ? normalRate : 0.0);
+
+    scrubRateBefore = scrubRate;
+
+    if (touched)
+        scrubRate = ticks * kSecondsPerJogTick * sourceRate / numSamples;
+    else if (handOnPlatter)
+        scrubRate = 0.0;
     else
+        scrubRate += (motorRate - scrubRate) * (1.0 - std::exp(-numSamples / (kMotorSeconds * sampleRate)));
+
+    // back at normal forward speed (or at rest): hand over to the transport again
+    if (!handOnPlatter && !reversing && std::abs(scrubRate - motorRate) < 0.01 * juce::jmax(normalRate, 0.1))
     {
-        title = "Invalid File";
-        artist = "";
-        album = "";
-        durationInSeconds = 0.0;
+        transportSource.setPosition(scrubPosition / sourceRate);
+        scrubbing = false;
+        scrubSeconds = -1.0;
+        return;
     }
+
+    scrub.setPlayhead((juce::int64) scrubPosition);
+}
+
+void PlayerAudio::renderScrub(juce::AudioBuffer<float>* buffer, int startSample, int numSamples)
+{
+    scrub.render(*buffer, startSample, numSamples, scrubPosition, scrubRateBefore, scrubRate);
+    scrubRateBefore = scrubRate; // any later segment of this block runs at the new rate
+
+    const double end = (double) scrub.getSourceLength();
+    scrubPosition = juce::jlimit(0.0, end, scrubPosition);
+    scrubSeconds = scrubPosition / scrub.getSourceSampleRate();
+
+    // the transport would have applied these
+    buffer->applyGain(startSample, numSamples, transportSource.getGain());
+
+    // the scrub buffer holds the stereo fold, played on the front pair of a wider bus
+    for (int ch = DownmixMatrix::numOutputs; ch < buffer->getNumChannels(); ++ch)
+        buffer->clear(ch, startSample, numSamples);
+}
+
+void PlayerAudio::setVinylMode(bool shouldBeEnabled)
+{
+    vinylMode = shouldBeEnabled;
+    scrub.setActive(vinylMode.load() || reverse.load());
 }
+
+void PlayerAudio::setReverse(bool shouldBeEnabled)
+{
+    reverse = shouldBeEnabled;
+    scrub.setActive(vinylMode.load() || reverse.load());
+}
+
+void PlayerAudio::scheduleStart(juce::int64 sampleTime)
+{
+    pushEvent({ ScheduledEvent::Type::start, sampleTime, 0.0 });
+}
+
+void PlayerAudio::scheduleStop(juce::int64 sampleTime)
+{
+    pushEvent({ ScheduledEvent::Type::stop, sampleTime, 0.0 });
+}
+
+void PlayerAudio::scheduleSeek(juce::int64 sampleTime, double newPositionInSeconds)
+{
+    pushEvent({ ScheduledEvent::Type::seek, sampleTime, newPositionInSeconds });
+}
+
+juce::int64 PlayerAudio::getNextBeatSampleTime() const
+{
+    if (clock == nullptr || !beatGrid.isValid() || !transportSource.isPlaying())
+        return -1;
+
+    // the transport's read position is where the next block starts, as is the clock
+    auto secondsToBeat = (1.0 - beatGrid.getBeatPhase(getPosition())) * beatGrid.getBeatLength() / currentSpeed;
+    return clock->getSampleTimeAfter(secondsToBeat);
+}
+
 void PlayerAudio::play() { transportSource.start(); }
-void PlayerAudio::stop() { transportSource.stop(); transportSource.setPosition(0.0); }
-void PlayerAudio::restart() { transportSource.setPosition(0.0); transportSource.start(); }
+void PlayerAudio::stop() { transportSource.stop(); setPosition(0.0); }
+void PlayerAudio::restart() { setPosition(0.0); transportSource.start(); }
 void PlayerAudio::pause() { transportSource.stop(); }
-void PlayerAudio::goToStart() { transportSource.setPosition(0.0); }
+void PlayerAudio::goToStart() { setPosition(0.0); }
 
 bool PlayerAudio::isFileLoaded() const { return transportSource.getLengthInSeconds() > 0; }
 
@@ -133,28 +732,27 @@ void PlayerAudio::goToEnd()
 {
     double length = transportSource.getLengthInSeconds();
     if (length > 0.1)
-        transportSource.setPosition(length - 0.1);
+        setPosition(length - 0.1);
 }
 
+// Any thread; takes effect at the start of the next audio block.
 void PlayerAudio::setGain(float gain)
 {
     currentVolume = gain;
-    transportSource.setGain(gain);
+    gainChanged = true;
 }
 
 void PlayerAudio::toggleMute()
 {
-    if (isMuted)
-    {
-        setGain((float)previousVolume);
-        isMuted = false;
-    }
-    else
-    {
-        previousVolume = currentVolume;
-        setGain(0.0f);
-        isMuted = true;
-    }
+    isMuted = !isMuted.load();
+    gainChanged = true;
+}
+
+// Audio thread: normalization is folded into the transport's own gain, so it costs nothing per block.
+void PlayerAudio::applyGainChange()
+{
+    if (gainChanged.exchange(false))
+        transportSource.setGain(isMuted.load() ? 0.0f : (float) currentVolume.load() * normalizationGain.load());
 }
 
 void PlayerAudio::toggleLoop()
@@ -169,29 +767,64 @@ double PlayerAudio::getTotalLength() { return transportSource.getTotalLength();
 
 void PlayerAudio::setPosition(double newPositionInSecond)
 {
+    // ask the kernel for the pages at the new playhead before the audio thread reads them
+    if (mappedReader != nullptr)
+        mappedReader->prefetch((juce::int64) (newPositionInSecond * mappedReader->sampleRate));
+
+    // and have an MP3 decoder open there before the transport moves, so the seek doesn't wait on one
+    if (indexedReader != nullptr)
+        indexedReader->prepareSeek((juce::int64) (newPositionInSecond * indexedReader->sampleRate));
+
     transportSource.setPosition(newPositionInSecond);
 }
 
-double PlayerAudio::getPosition() const { return transportSource.getCurrentPosition(); }
+double PlayerAudio::getPosition() const
+{
+    auto scrubbed = scrubSeconds.load();
+    return scrubbed >= 0.0 ? scrubbed : transportSource.getCurrentPosition();
+}
+// for cursors: smooth between audio blocks, and the transport until audio has run
+double PlayerAudio::getDisplayPosition() const
+{
+    return playhead.hasValue() ? playhead.getPositionNow() : getPosition();
+}
 double PlayerAudio::getLengthInSecond() const { return transportSource.getLengthInSeconds(); }
 
-void PlayerAudio::setPointA(double newPositionInSecond) { pointA = newPositionInSecond; }
-void PlayerAudio::setPointB(double newPositionInSecond) { pointB = newPositionInSecond; }
+void PlayerAudio::setPointA(double newPositionInSecond) { pointA = quantize(newPositionInSecond); }
+void PlayerAudio::setPointB(double newPositionInSecond) { pointB = quantize(newPositionInSecond); }
 
-void PlayerAudio::toggleLoopAB() { loopABEnabled = !loopABEnabled; }
+void PlayerAudio::toggleLoopAB() { loopABEnabled = !loopABEnabled.load(); }
 
 void PlayerAudio::loopBetweenTwoPoints()
 {
-    if (loopABEnabled && transportSource.isPlaying() && pointB > pointA && (pointB - pointA) > 0.1)
+    const double a = pointA.load(), b = pointB.load();
+
+    if (loopABEnabled && transportSource.isPlaying() && b > a && (b - a) > 0.1)
     {
         double currentPosition = transportSource.getCurrentPosition();
-        if (currentPosition >= pointB)
+        if (currentPosition >= b)
         {
-            transportSource.setPosition(pointA);
+            transportSource.setPosition(a);
         }
     }
 }
 
+// The wrap back to A happens on the audio thread, so once the playhead is close to B an
+// MP3 reader keeps a decoder parked at A for it.
+void PlayerAudio::keepLoopStartWarm()
+{
+    static constexpr double kLoopLookaheadSeconds = 1.0;
+
+    if (indexedReader == nullptr)
+        return;
+
+    const double a = pointA.load(), b = pointB.load();
+    const bool wrapComing = loopABEnabled && transportSource.isPlaying() && b > a && (b - a) > 0.1
+                         && transportSource.getCurrentPosition() >= b - kLoopLookaheadSeconds;
+
+    indexedReader->parkAt(wrapComing ? (juce::int64) (a * indexedReader->sampleRate) : -1);
+}
+
 void PlayerAudio::setBookmark(double pos) {
     bookmarks.push_back(pos);
 }
@@ -221,70 +854,308 @@ void PlayerAudio::goToBookmark()
         });
 }
 
-void PlayerAudio::setResamplingRatio(double spede)
+void PlayerAudio::setRamDeckEnabled(bool shouldBeEnabled)
 {
-    resamplingAudioSource.setResamplingRatio(spede);
+    ramDeckEnabled = shouldBeEnabled;
+
+    if (!ramDeckEnabled)
+        DecodedAudioCache::getInstance()->cancelRequests(this);
+    else if (isFileLoaded() && !playingFromRam && mappedReader == nullptr)
+        requestRamCopy();
 }
 
-// =====================================================
-// CHANGED: Save & Load Last Session using ApplicationProperties
-// keys are stored as: settingsKeyPrefix + "lastFile" / "lastPosition"
-// =====================================================
+void PlayerAudio::requestRamCopy()
+{
+    auto file = lastLoadedFile;
 
-void PlayerAudio::saveLastSession()
+    DecodedAudioCache::getInstance()->requestDecode(file, this,
+        [this, file](DecodedAudioCache::Track track)
+        {
+            // the deck may have moved on to another file while we were decoding
+            if (track == nullptr || file != lastLoadedFile || !ramDeckEnabled)
+                return;
+
+            playingFromRam = true;
+            currentRamTrack = track;
+            swapReader(new RamAudioReader(track), true);
+        });
+}
+
+void PlayerAudio::requestSeekIndex()
 {
-    if (auto* settings = appProperties.getUserSettings())
+    auto file = lastLoadedFile;
+
+    Mp3SeekIndexStore::getInstance()->requestIndex(file, this,
+        [this, file](Mp3SeekIndexStore::Index index)
+        {
+            // a RAM copy already seeks instantly, keep it
+            if (index == nullptr || file != lastLoadedFile || playingFromRam)
+                return;
+
+            currentSeekIndex = index;
+
+            // started here at the current position, so the audio thread never opens a decoder
+            auto* reader = new IndexedMp3Reader(file, index, IndexedMp3Reader::Seeking::background);
+            reader->openAt((juce::int64) (transportSource.getCurrentPosition() * index->sampleRate));
+            swapReader(reader, false);
+            indexedReader = reader;
+        });
+}
+
+// Replaces the reader under the transport without losing position, play state or looping.
+void PlayerAudio::swapReader(juce::AudioFormatReader* newReader, bool seeksAreCheap)
+{
+    auto position = transportSource.getCurrentPosition();
+    bool wasPlaying = transportSource.isPlaying();
+    bool looping = readerSource != nullptr && readerSource->isLooping();
+
+    transportSource.stop();
+    transportSource.setSource(nullptr);
+
+    mappedReader = nullptr;
+    indexedReader = nullptr;
+    readerSource.reset(new juce::AudioFormatReaderSource(new HotCueReader(newReader, hotCues, !seeksAreCheap), true));
+    readerSource->setLooping(looping);
+    transportSource.setSource(readerSource.get(), 0, nullptr, newReader->sampleRate,
+                              juce::jlimit(1, DownmixMatrix::maxInputs, (int) newReader->numChannels));
+    transportSource.setPosition(position);
+
+    if (wasPlaying)
+        transportSource.start();
+
+    // the new reader may be on a slightly different timeline (e.g. gapless MP3), so re-decode cues
+    hotCues.setReaderFactory(makeReaderFactory(IndexedMp3Reader::Seeking::background));
+    scrub.setSource(makeReaderFactory(IndexedMp3Reader::Seeking::blocking));
+}
+
+// Builds readers equivalent to the deck's current one, for decoding on other threads. Hot
+// cue readers can end up on the audio thread (see HotCueReader), so they seek in the background.
+HotCueBank::ReaderFactory PlayerAudio::makeReaderFactory(IndexedMp3Reader::Seeking seeking) const
+{
+    auto file = lastLoadedFile;
+    auto ramTrack = currentRamTrack;
+    auto seekIndex = currentSeekIndex;
+
+    return [file, ramTrack, seekIndex, seeking]() -> std::unique_ptr<juce::AudioFormatReader>
     {
-        // 🔹 احفظ باستخدام key ثابت
-        if (lastLoadedFile.existsAsFile())
-            settings->setValue(settingsKeyPrefix + "lastFile", lastLoadedFile.getFullPathName());
+        if (ramTrack != nullptr)
+            return std::make_unique<RamAudioReader>(ramTrack);
+
+        if (seekIndex != nullptr)
+            return std::make_unique<IndexedMp3Reader>(file, seekIndex, seeking);
+
+        if (auto mapped = MappedPcmReader::create(file))
+            return mapped;
 
-        settings->setValue(settingsKeyPrefix + "lastPosition", transportSource.getCurrentPosition());
-        settings->saveIfNeeded();
+        return CodecRegistry::getInstance()->createReaderFor(file);
+    };
+}
+
+//==============================================================================
+// Hot cues: pressing an empty cue stores the current position, pressing a set one jumps there.
+void PlayerAudio::triggerHotCue(int cueIndex)
+{
+    if (!isFileLoaded())
+        return;
 
-        DBG("💾 Session saved: " << lastLoadedFile.getFileName()
-            << " @ " << transportSource.getCurrentPosition());
+    if (!hotCues.hasCue(cueIndex))
+    {
+        setHotCue(cueIndex);
+        return;
     }
+
+    setPosition(hotCues.getCuePosition(cueIndex));
+
+    if (!transportSource.isPlaying())
+        transportSource.start();
 }
 
-void PlayerAudio::loadLastSession()
+void PlayerAudio::setHotCue(int cueIndex)
+{
+    hotCues.setCue(cueIndex, quantize(transportSource.getCurrentPosition()));
+    saveHotCues();
+}
+
+void PlayerAudio::clearHotCue(int cueIndex)
+{
+    hotCues.clearCue(cueIndex);
+    saveHotCues();
+}
+
+// cue sets are stored per file, keyed by a hash of the path
+static juce::String hotCueKeyFor(const juce::File& file)
+{
+    return "hotcues_" + juce::String::toHexString(file.getFullPathName().hashCode64());
+}
+
+void PlayerAudio::saveHotCues()
+{
+    if (auto* settings = appProperties.getUserSettings())
+        if (lastLoadedFile != juce::File())
+            settings->setValue(hotCueKeyFor(lastLoadedFile), hotCues.toString());
+}
+
+void PlayerAudio::loadHotCues()
 {
-    juce::PropertiesFile::Options options;
-    options.applicationName = "SimpleAudioPlayer";
-    options.filenameSuffix = "settings";
-    options.osxLibrarySubFolder = "Application Support";
-    options.folderName = "SimpleAudioPlayer";
+    if (auto* settings = appProperties.getUserSettings())
+        hotCues.restoreFromString(settings->getValue(hotCueKeyFor(lastLoadedFile)));
+}
 
-    juce::ApplicationProperties appProperties;
-    appProperties.setStorageParameters(options);
+void PlayerAudio::setNormalizationEnabled(bool shouldBeEnabled)
+{
+    normalizationEnabled = shouldBeEnabled;
+    updateNormalization();
+}
 
-    auto* props = appProperties.getUserSettings();
+// Picks up the track's cached loudness, or queues an analysis and applies it when done.
+void PlayerAudio::updateNormalization()
+{
+    auto* loudness = LoudnessCache::getInstance();
+    loudness->cancelRequests(this);
 
-    juce::String lastFilePath = props->getValue(settingsKeyPrefix + "lastFile");
-    double lastPosition = props->getDoubleValue(settingsKeyPrefix + "lastPosition", 0.0);
+    normalizationGain = 1.0f;
+    LoudnessResult result;
 
-    if (lastFilePath.isNotEmpty())
+    if (normalizationEnabled && lastLoadedFile.existsAsFile())
     {
-        juce::File file(lastFilePath);
-        if (file.existsAsFile())
+        if (loudness->find(lastLoadedFile, result))
+        {
+            normalizationGain = result.getNormalizationGain(loudness->getTargetLufs());
+        }
+        else
         {
-            loadFile(file);
+            auto file = lastLoadedFile;
+            loudness->request(file, this, [this, file](const LoudnessResult& r)
+            {
+                if (file != lastLoadedFile || !normalizationEnabled)
+                    return;
+
+                normalizationGain = r.getNormalizationGain(LoudnessCache::getInstance()->getTargetLufs());
+                gainChanged = true;
+            }, JobScheduler::Priority::loadedTrack);
+        }
+    }
 
-            // ✋ تأكد إن التشغيل متوقف
-            transportSource.stop();
+    gainChanged = true;
+}
+
+void PlayerAudio::setResamplingRatio(double spede)
+{
+    currentSpeed = spede;
+    setResamplingRatios(spede);
+}
 
-            // ✅ أعد الضبط للموضع الأخير بدون تشغيل
-            transportSource.setPosition(lastPosition);
+void PlayerAudio::requestBeatGrid()
+{
+    auto* beats = BeatGridCache::getInstance();
+    beats->cancelRequests(this);
+    beatGrid = {};
 
-            // ⚙ جهّز الصوت لكن ما تشغلوش
-            transportSource.prepareToPlay(512, 44100);
+    auto file = lastLoadedFile;
+    beats->request(file, this, [this, file](const BeatGrid& grid)
+    {
+        if (file == lastLoadedFile)
+            beatGrid = grid;
+    }, JobScheduler::Priority::loadedTrack);
+}
 
-            // 🔇 mute & loop states reset for safety
-            isMuted = false;
-            transportSource.setGain((float)currentVolume);
-            isLooping = false;
+double PlayerAudio::getEffectiveBpm() const
+{
+    return beatGrid.isValid() ? beatGrid.bpm * currentSpeed : 0.0;
+}
+
+double PlayerAudio::quantize(double seconds) const
+{
+    return quantizeEnabled && beatGrid.isValid() ? beatGrid.snap(seconds) : seconds;
+}
+
+bool PlayerAudio::syncTo(const PlayerAudio& master)
+{
+    if (!beatGrid.isValid() || !master.getBeatGrid().isValid() || !isFileLoaded())
+        return false;
+
+    // tempo: allow half/double time so 87 BPM can follow 174
+    auto ratio = master.getEffectiveBpm() / beatGrid.bpm;
+    while (ratio > 1.5)  ratio *= 0.5;
+    while (ratio < 0.75) ratio *= 2.0;
+    setResamplingRatio(juce::jlimit(0.5, 2.0, ratio));
+
+    // phase: nudge by less than half a beat so our beats land on the master's
+    auto& masterGrid = master.getBeatGrid();
+    auto offset = masterGrid.getBeatPhase(master.getPosition()) - beatGrid.getBeatPhase(getPosition());
+    offset -= std::round(offset);
+
+    setPosition(juce::jmax(0.0, getPosition() + offset * beatGrid.getBeatLength()));
+    return true;
+}
+
+// =====================================================
+// Save & Load Last Session through this deck's SessionJournal
+// =====================================================
+
+void PlayerAudio::saveLastSession()
+{
+    // nothing until the saved state is back, or defaults would overwrite it
+    if (!sessionRestored)
+        return;
+
+    auto note = [this](const juce::Identifier& key, const juce::var& value)
+    {
+        if (journaled.set(key, value))
+            SessionJournal::getInstance()->set(sessionId, key, value);
+    };
+
+    note("file", lastLoadedFile.getFullPathName());
+    note("position", transportSource.getCurrentPosition());
+    note("loopStart", pointA.load());
+    note("loopEnd", pointB.load());
+    note("loopEnabled", loopABEnabled.load());
+    note("cues", hotCues.toString());
+    note("gain", currentVolume.load());
+    note("speed", currentSpeed);
+}
+
+void PlayerAudio::timerCallback()
+{
+    saveLastSession();
+}
+
+void PlayerAudio::loadLastSession()
+{
+    auto state = SessionJournal::getInstance()->load(sessionId);
+    journaled = state;
+
+    juce::File file(state["file"].toString());
+    if (file.existsAsFile())
+    {
+        loadFile(file);
+
+        // ✋ تأكد إن التشغيل متوقف
+        transportSource.stop();
+
+        // ✅ أعد الضبط للموضع الأخير بدون تشغيل
+        setPosition(state["position"]);
+
+        pointA = (double) state["loopStart"];
+        pointB = (double) state["loopEnd"];
+        loopABEnabled = (bool) state["loopEnabled"];
+
+        // newer than the settings file if the app didn't get to save it
+        if (state.contains("cues"))
+        {
+            hotCues.restoreFromString(state["cues"].toString());
+            saveHotCues();
         }
     }
+
+    if (state.contains("gain"))
+        setGain((float) (double) state["gain"]);
+
+    if (state.contains("speed"))
+        setResamplingRatio(state["speed"]);
+
+    sessionRestored = true;
+    startTimerHz(1);
 }
 void PlayerAudio::skipForward(double seconds)
 {
@@ -293,9 +1164,9 @@ void PlayerAudio::skipForward(double seconds)
     double newPos = current + seconds;
 
     if (newPos < length)
-        transportSource.setPosition(newPos);
+        setPosition(newPos);
     else
-        transportSource.setPosition(length);
+        setPosition(length);
 }
 
 void PlayerAudio::skipBackward(double seconds)
@@ -304,15 +1175,31 @@ void PlayerAudio::skipBackward(double seconds)
     double newPos = current - seconds;
 
     if (newPos > 0)
-        transportSource.setPosition(newPos);
+        setPosition(newPos);
     else
-        transportSource.setPosition(0.0);
+        setPosition(0.0);
 }
 
 
 
 
 
+PlayerAudio::MemoryUsage PlayerAudio::getMemoryUsage() const
+{
+    MemoryUsage usage;
+
+    if (currentRamTrack != nullptr)
+        usage.ramTrack = currentRamTrack->getSizeInBytes();
+
+    if (currentSeekIndex != nullptr)
+        usage.seekIndex = currentSeekIndex->getSizeInBytes();
+
+    usage.hotCues = hotCues.getSizeInBytes();
+    usage.scrubBuffer = ScrubBuffer::getSizeInBytes();
+    usage.processing = processingBytes.load();
+    return usage;
+}
+
 // =====================================================
 
 juce::String PlayerAudio::getTitle() const { return title; }
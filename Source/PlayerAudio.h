@@ -1,10 +1,29 @@
 #pragma once
 #include <JuceHeader.h>
-
-class PlayerAudio
+#include "JobScheduler.h"
+#include "HotCues.h"
+#include "DecodedAudioCache.h"
+#include "Mp3SeekIndex.h"
+#include "Loudness.h"
+#include "BeatGrid.h"
+#include "AudioClock.h"
+#include "DeckEq.h"
+#include "AudioTap.h"
+#include "InsertChain.h"
+#include "ScrubBuffer.h"
+#include "PlayheadSnapshot.h"
+#include "SessionJournal.h"
+#include "DownmixMatrix.h"
+#include <array>
+
+class MappedPcmReader;
+
+class PlayerAudio : private juce::AsyncUpdater,
+                    private juce::Timer
 {
 public:
-    PlayerAudio();
+    // sessionId names this deck's saved session, so each deck gets its own
+    explicit PlayerAudio(const juce::String& sessionId);
     ~PlayerAudio();
 
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
@@ -18,12 +37,59 @@ public:
     void pause();
     void goToStart();
 
+    // shared output timeline (owned by the mixer) that the schedule calls refer to
+    void setClock(const AudioClock* mixerClock) { clock = mixerClock; }
+
+    // Sample-accurate transport changes at an absolute clock time, executed by the audio
+    // thread inside the block that contains that sample. Times already past apply at once.
+    void scheduleStart(juce::int64 sampleTime);
+    void scheduleStop(juce::int64 sampleTime);
+    void scheduleSeek(juce::int64 sampleTime, double newPositionInSeconds);
+
+    // Controller and automation input (see MidiControlSurface, ControlServer): queued from
+    // any thread but the audio thread and applied by the audio thread at the start of its
+    // next block. gain takes 0..1, jog takes signed encoder ticks; seek and the loop points
+    // take a position in seconds, loopEnabled takes 0 or 1. hotCue (jump, or set if empty,
+    // like the number keys) and setHotCue take the cue index, and are passed on to the
+    // message thread, which owns the cues.
+    enum class ControlAction { playPause, cue, loop, gain, jog, play, pause, stop, seek, loopIn, loopOut, loopEnabled,
+                               hotCue, setHotCue };
+
+    struct ControlEvent
+    {
+        ControlAction action = ControlAction::playPause;
+        float value = 0.0f;
+        double position = 0.0;
+    };
+
+    void pushControl(ControlAction action, float value, double position = 0.0);
+
+    // all or none of the events are queued, and they are applied in the same block;
+    // false if the queue hasn't room for them
+    bool pushControls(const ControlEvent* events, int numEvents);
+
+    // In vinyl mode the jog wheel scratches the audio in either direction instead of bending
+    // the tempo; reverse plays the track backwards. Both play from a scrub buffer decoded
+    // around the playhead in the background.
+    void setVinylMode(bool shouldBeEnabled);
+    bool isVinylMode() const { return vinylMode.load(); }
+    void setReverse(bool shouldBeEnabled);
+    bool isReverse() const { return reverse.load(); }
+
+    // gain last set by a controller, or -1 if none since the last call
+    float takeControllerGain() { return controllerGain.exchange(-1.0f); }
+
+    // clock time of this deck's next beat while it is playing, or -1
+    juce::int64 getNextBeatSampleTime() const;
+
     bool isFileLoaded() const;
+    bool isPlaying() const { return transportSource.isPlaying() && !outputGated; }
+    juce::File getLoadedFile() const { return lastLoadedFile; }
 
     void goToEnd();
 
     void setGain(float gain);
-    float getGain() const { return (float)currentVolume; }
+    float getGain() const { return (float) currentVolume.load(); }
     void toggleMute();
     bool getMuteState() const { return isMuted; }
 
@@ -31,6 +97,7 @@ public:
 
     void setPosition(double newPositionInSeconds);
     double getPosition() const;
+    double getDisplayPosition() const;
     double getLengthInSecond() const;
 
     double getTotalLength();
@@ -39,22 +106,83 @@ public:
     void setPointB(double newPositionInSecond);
     void toggleLoopAB();
     bool isLoopABEnable() const { return loopABEnabled; }
+    double getPointA() const { return pointA.load(); }
+    double getPointB() const { return pointB.load(); }
     void loopBetweenTwoPoints();
+    void keepLoopStartWarm(); // message thread, from the GUI timer
 
 
 
     void setResamplingRatio(double spede);
 
+    // 3-band EQ and bipolar filter knob, applied after the resampler
+    void setEqBandGain(DeckEq::Band band, float gainDb) { eq.setBandGain(band, gainDb); }
+    void setFilterPosition(float position) { eq.setFilter(position); }
+
+    // Tracks keep all their channels (up to DownmixMatrix::maxInputs) through decoding and
+    // resampling. With the automatic preset a track wider than stereo stays that wide on
+    // the deck's bus if the device has an output for each channel; otherwise, or with
+    // another preset, it folds to a stereo bus.
+    void setDownmixPreset(DownmixMatrix::Preset newPreset);
+    DownmixMatrix::Preset getDownmixPreset() const { return downmixPreset; }
+    int getSourceChannels() const { return sourceChannels.load(); }
+
+    // message thread: the device outputs the master can use
+    void setOutputChannels(int numOutputs);
+
+    // Channels of the bus getNextAudioBlock() fills (2 unless a track is on its own
+    // outputs), and the fold that takes that bus down to stereo. The fold is only to be
+    // used on the audio thread, after a block has been rendered.
+    int getBusChannels() const { return busChannels.load(); }
+    const DownmixMatrix& getBusFold() const { return downmix; }
+
+    // effect plugins after the EQ, delayed as needed to stay aligned with the other deck
+    InsertChain& getInserts() { return inserts; }
+
+    // post-insert output of this deck, for meters and the spectrum view
+    AudioTap& getTap() { return tap; }
+    double getResamplingRatio() const { return currentSpeed; }
+
+    // beat grid from background analysis; invalid until it arrives
+    const BeatGrid& getBeatGrid() const { return beatGrid; }
+    double getEffectiveBpm() const;
+
+    // matches this deck's tempo and beat phase to another deck; false if either has no grid
+    bool syncTo(const PlayerAudio& master);
+
+    // snaps hot cues and loop points to the nearest beat
+    void setQuantizeEnabled(bool shouldBeEnabled) { quantizeEnabled = shouldBeEnabled; }
+    bool isQuantizeEnabled() const { return quantizeEnabled; }
+
+    // RAM deck: decode the whole track in the background and play it from memory
+    void setRamDeckEnabled(bool shouldBeEnabled);
+    bool isRamDeckEnabled() const { return ramDeckEnabled; }
+    bool isPlayingFromRam() const { return playingFromRam; }
+
+    // loudness normalization to LoudnessCache's target (EBU R128 measured in the background)
+    void setNormalizationEnabled(bool shouldBeEnabled);
+    bool isNormalizationEnabled() const { return normalizationEnabled; }
+    float getNormalizationGain() const { return normalizationGain; }
+
     void setBookmark(double newPositionInSecond);
     void goToBookmark();
 
+    // numbered hot cues (0-based index), saved per file
+    void triggerHotCue(int cueIndex);
+    void setHotCue(int cueIndex);
+    void clearHotCue(int cueIndex);
+    bool hasHotCue(int cueIndex) const { return hotCues.hasCue(cueIndex); }
+    double getHotCuePosition(int cueIndex) const { return hotCues.getCuePosition(cueIndex); }
+
 
     // bonus 2
     void togglePlayPause();
 
     // === Persistence (task) ===
-    void saveLastSession(); // CHANGED: now uses PropertiesFile with unique key prefix
-    void loadLastSession(); // CHANGED: reads the same keys
+    // The deck's state goes to its SessionJournal as it changes (checked once a second);
+    // saving only queues what changed and never blocks on the disk.
+    void saveLastSession();
+    void loadLastSession();
 
 
     //+ - 10 s
@@ -62,21 +190,159 @@ public:
     void skipBackward(double second);
 
 
-    juce::String settingsKeyPrefix = "player_main_"; // ثابت دايمًا
 
 
 
+    // Memory held for this deck, for the Memory window. The RAM copy and seek index are
+    // shared with the other deck when both have the same track; waveform is the GUI's and
+    // is filled in by PlayerGUI::getMemoryUsage().
+    struct MemoryUsage
+    {
+        size_t ramTrack = 0, seekIndex = 0, hotCues = 0, scrubBuffer = 0, processing = 0, waveform = 0;
+
+        size_t getTotal() const { return ramTrack + seekIndex + hotCues + scrubBuffer + processing + waveform; }
+    };
 
+    // message thread
+    MemoryUsage getMemoryUsage() const;
 
     juce::String getTitle() const;
     juce::String getArtist() const;
     juce::String getDurationString() const;
 
 private:
-    juce::AudioFormatManager formatManager;
+    HotCueBank hotCues; // declared before readerSource: its HotCueReader refers to it
     std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
     juce::AudioTransportSource transportSource;
     juce::ResamplingAudioSource resamplingAudioSource{ &transportSource, false, 2 };
+    juce::ResamplingAudioSource surroundResamplingSource{ &transportSource, false, DownmixMatrix::maxInputs };
+    DeckEq eq;
+    InsertChain inserts;
+    AudioTap tap;
+
+    // non-owning: set when the current file is played from a memory map (owned by readerSource)
+    MappedPcmReader* mappedReader = nullptr;
+
+    bool ramDeckEnabled = false;
+    bool playingFromRam = false;
+    DecodedAudioCache::Track currentRamTrack;
+
+    bool normalizationEnabled = false;
+    std::atomic<float> normalizationGain{ 1.0f };
+    void updateNormalization();
+
+    Mp3SeekIndexStore::Index currentSeekIndex;
+    // non-owning: set while the current file plays through its seek index (owned by readerSource)
+    IndexedMp3Reader* indexedReader = nullptr;
+
+    struct ScheduledEvent
+    {
+        enum class Type { start, stop, seek };
+
+        Type type = Type::start;
+        juce::int64 sampleTime = 0;
+        double position = 0.0;
+    };
+
+    static constexpr int maxScheduledEvents = 64;
+
+    static constexpr int maxControlEvents = 256;
+
+    void pushEvent(const ScheduledEvent& event);
+    void collectDueEvents();
+    void applyEvent(const ScheduledEvent& event);
+    void applyControls(int numSamples);
+    void updateScrub(int numSamples);
+    void renderScrub(juce::AudioBuffer<float>* buffer, int startSample, int numSamples);
+    void renderSegment(juce::AudioBuffer<float>* buffer, int startSample, int numSamples);
+    void pullSource(juce::AudioBuffer<float>* buffer, int startSample, int numSamples);
+    void setResamplingRatios(double ratio);
+    void updateDownmix();
+    void applyDownmixChange();
+    void stopFromAudioThread(double positionAfter);
+    void handleAsyncUpdate() override;
+
+    const AudioClock* clock = nullptr;
+
+    // message thread -> audio thread
+    juce::AbstractFifo eventFifo{ maxScheduledEvents };
+    std::array<ScheduledEvent, maxScheduledEvents> eventQueue;
+
+    // controller threads -> audio thread; producers take turns on the lock
+    juce::SpinLock controlPushLock;
+    juce::AbstractFifo controlFifo{ maxControlEvents };
+    std::array<ControlEvent, maxControlEvents> controlQueue;
+    std::atomic<double> cuePoint{ 0.0 };
+    std::atomic<float> controllerGain{ -1.0f };
+    float jogBend = 0.0f; // audio thread: temporary speed offset from the jog wheel
+    int pendingJogTicks = 0; // audio thread: vinyl-mode ticks received this block
+
+    // scratching and reverse play. While scrubbing, the transport isn't pulled (so it keeps
+    // its position) and the deck plays from the scrub buffer instead.
+    ScrubBuffer scrub;
+    std::atomic<bool> vinylMode{ false };
+    std::atomic<bool> reverse{ false };
+    std::atomic<double> scrubSeconds{ -1.0 }; // position while scrubbing, else -1
+    bool scrubbing = false;
+    double scrubPosition = 0.0;               // source frames
+    double scrubRate = 0.0, scrubRateBefore = 0.0; // source frames per output sample
+    double transportPositionAtScrub = 0.0;
+    int jogIdleSamples = 0;
+    double sampleRate = 44100.0;
+
+    PlayheadSnapshot playhead; // published every block, read by the GUI
+
+    // Stereo and mono tracks play straight through the stereo resampler. A track on its
+    // own outputs is resampled with all its channels straight onto the bus. Anything else
+    // (or a non-default preset) is resampled with all its channels into sourceBuffer and
+    // mixed down from there.
+    DownmixMatrix::Preset downmixPreset = DownmixMatrix::Preset::automatic;
+    std::atomic<int> sourceChannels{ 0 };
+    int outputChannels = 2;                     // message thread
+    juce::SpinLock downmixLock;
+    DownmixMatrix pendingDownmix;               // message thread -> audio thread
+    int pendingBusChannels = 2;                 //   "
+    std::atomic<bool> downmixChanged{ false };
+    DownmixMatrix downmix;                      // audio thread
+    std::atomic<int> busChannels{ 2 };          // written by the audio thread
+    bool surroundResamplerActive = false;       // audio thread
+    juce::AudioBuffer<float> sourceBuffer;
+    std::atomic<size_t> processingBytes{ 0 }; // sourceBuffer as sized by prepareToPlay
+
+    // last values handed to the session journal
+    void timerCallback() override;
+    const juce::String sessionId;
+    juce::NamedValueSet journaled;
+    bool sessionRestored = false;
+
+    // audio thread only: events not yet reached, sorted by time
+    std::array<ScheduledEvent, maxScheduledEvents> dueEvents;
+    int numDueEvents = 0;
+
+    // set when the audio thread stopped the deck; output stays silent until the
+    // message thread has stopped the transport (which can't be done from the audio thread)
+    std::atomic<bool> outputGated{ false }; // read by isPlaying() on the message thread
+    std::atomic<double> positionAfterStop{ 0.0 };
+    std::atomic<bool> stopRequested{ false };
+    // controller hot cues for handleAsyncUpdate(): bit i triggers cue i, bit numCues + i sets it
+    std::atomic<juce::uint32> pendingHotCues{ 0 };
+
+    BeatGrid beatGrid;
+    bool quantizeEnabled = false;
+    double currentSpeed = 1.0;
+    void requestBeatGrid();
+    double quantize(double seconds) const;
+
+    void requestRamCopy();
+    void requestSeekIndex();
+    HotCueBank::ReaderFactory makeReaderFactory(IndexedMp3Reader::Seeking seeking) const;
+    void saveHotCues();
+    void loadHotCues();
+    void swapReader(juce::AudioFormatReader* newReader, bool seeksAreCheap);
+    void readMetadata(const juce::File& file);
+
+    // background jobs for the loaded track, cancelled when another one is loaded
+    JobScheduler::GroupId loadJobs = JobScheduler::noGroup;
 
    
     // file + metadata
@@ -87,15 +353,20 @@ private:
 
 
     double durationInSeconds = 0.0;
-    double currentVolume = 1.0;
-    double previousVolume = 1.0;
+    // Set from the message thread and by controllers on the audio thread; the audio thread
+    // folds volume, mute and normalization into the transport's gain at its next block.
+    // Muting doesn't touch the volume, so a fader moved while muted is kept for unmuting.
+    std::atomic<double> currentVolume{ 1.0 };
+    std::atomic<bool> isMuted{ false };
+    std::atomic<bool> gainChanged{ true };
+    void applyGainChange();
 
-    bool isMuted = false;
     bool isLooping = false;
 
-    double pointA = 0.0;
-    double pointB = 0.0;
-    bool loopABEnabled = false;
+    // the socket API also sets these from the audio thread
+    std::atomic<double> pointA{ 0.0 };
+    std::atomic<double> pointB{ 0.0 };
+    std::atomic<bool> loopABEnabled{ false };
 
     double pos = 0.0;
     std::vector<double> bookmarks;
@@ -103,5 +374,6 @@ private:
     // CHANGED: prefix key used to store per-player values in the common PropertiesFile
    // e.g. "player_7ffdf1234_"
 
+    JUCE_DECLARE_WEAK_REFERENCEABLE(PlayerAudio)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlayerAudio)
 };
\ No newline at end of file
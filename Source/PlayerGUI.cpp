@@ -8,9 +8,6 @@ static constexpr int kWaveformVerticalOffset = 40;
 PlayerGUI::PlayerGUI(PlayerAudio& audioRef)
     : playerAudio(audioRef)
 {
-    // register formats for thumbnail and audio reading
-    formatManager.registerBasicFormats();
-
     // Put volume/speed as vertical sliders (they will sit to the sides of the waveform)
     volumeSlider.setSliderStyle(juce::Slider::LinearVertical);
     volumeSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 48, 18);
@@ -22,12 +19,15 @@ PlayerGUI::PlayerGUI(PlayerAudio& audioRef)
     positionSlider.setSliderStyle(juce::Slider::LinearHorizontal);
     positionSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
 
-    for (auto* btn : { &loadButton, &restartButton, &stopButton, &playButton, &pauseButton, &goToStartButton, &goToEndButton, &loopButton, &beginButton, &endButton, &loopABButton, &setBookMarkButton, &goToBookMarkButton, &forwardButton, &backwardButton })
+    for (auto* btn : { &loadButton, &restartButton, &stopButton, &playButton, &pauseButton, &goToStartButton, &goToEndButton, &loopButton, &beginButton, &endButton, &loopABButton, &setBookMarkButton, &goToBookMarkButton, &forwardButton, &backwardButton, &ramDeckButton, &normalizeButton, &syncButton, &quantizeButton, &vinylButton, &reverseButton, &channelsButton })
     {
         btn->addListener(this);
         addAndMakeVisible(btn);
     }
 
+    // handles its own clicks (plugin menu)
+    addAndMakeVisible(fxButton);
+
     volumeSlider.setRange(0.0, 1.0, 0.01);
     volumeSlider.setValue(0.5);
     volumeSlider.addListener(this);
@@ -50,6 +50,41 @@ PlayerGUI::PlayerGUI(PlayerAudio& audioRef)
     speedLabel.setFont(juce::Font(14.0f));
     addAndMakeVisible(speedLabel);
 
+    // EQ / filter knobs: double-click returns a knob to neutral
+    {
+        std::array<juce::Slider*, 4> knobs = { &eqLowSlider, &eqMidSlider, &eqHighSlider, &filterSlider };
+        std::array<juce::Label*, 4> knobLabels = { &eqLowLabel, &eqMidLabel, &eqHighLabel, &filterLabel };
+        std::array<const char*, 4> names = { "Low", "Mid", "High", "Filter" };
+
+        for (size_t i = 0; i < knobs.size(); ++i)
+        {
+            knobs[i]->setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+            knobs[i]->setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+            knobs[i]->setPopupDisplayEnabled(true, true, this);
+            knobs[i]->addListener(this);
+            addAndMakeVisible(knobs[i]);
+
+            knobLabels[i]->setText(names[i], juce::dontSendNotification);
+            knobLabels[i]->setFont(juce::Font(12.0f));
+            knobLabels[i]->setJustificationType(juce::Justification::centred);
+            addAndMakeVisible(knobLabels[i]);
+        }
+
+        for (auto* eqKnob : { &eqLowSlider, &eqMidSlider, &eqHighSlider })
+        {
+            eqKnob->setRange(DeckEq::minGainDb, DeckEq::maxGainDb, 0.1);
+            eqKnob->setTextValueSuffix(" dB");
+        }
+
+        filterSlider.setRange(-1.0, 1.0, 0.01);
+
+        for (auto* knob : knobs)
+        {
+            knob->setValue(0.0, juce::dontSendNotification);
+            knob->setDoubleClickReturnValue(true, 0.0);
+        }
+    }
+
     titleLabel.setText("Title: ---", juce::dontSendNotification);
     artistLabel.setText("Artist: ---", juce::dontSendNotification);
     durationLabel.setText("Duration: ---", juce::dontSendNotification);
@@ -72,11 +107,13 @@ PlayerGUI::PlayerGUI(PlayerAudio& audioRef)
     playlistViewport.setViewedComponent(&playlist, false);
     addAndMakeVisible(playlistViewport);
 
-    // We'll move these two controls above the playlist panel in resized()
+    // We'll move these controls above the playlist panel in resized()
     addAndMakeVisible(loadPlaylistButton);
     addAndMakeVisible(playSelectedButton);
+    addAndMakeVisible(exportPlaylistButton);
     loadPlaylistButton.addListener(this);
     playSelectedButton.addListener(this);
+    exportPlaylistButton.addListener(this);
 
     positionSlider.setRange(0.0, 1.0, 0.01);
     positionSlider.addListener(this);
@@ -86,6 +123,10 @@ PlayerGUI::PlayerGUI(PlayerAudio& audioRef)
     timeLabel.setText("00:00:00", juce::dontSendNotification);
     timeLabel.setJustificationType(juce::Justification::centred);
 
+    addAndMakeVisible(bpmLabel);
+    bpmLabel.setText("BPM: ---", juce::dontSendNotification);
+    bpmLabel.setJustificationType(juce::Justification::centred);
+
     muteButton.setButtonText("Mute");
     muteButton.addListener(this);
     addAndMakeVisible(muteButton);
@@ -97,7 +138,7 @@ PlayerGUI::PlayerGUI(PlayerAudio& audioRef)
     themeDeepViolet  = juce::Colour::fromRGB(100, 0, 160);
 
     // الأزرار
-    for (auto* btn : { &loadButton, &restartButton, &stopButton, &playButton, &pauseButton, &goToStartButton, &goToEndButton, &loopButton, &beginButton, &endButton, &loopABButton, &setBookMarkButton, &goToBookMarkButton, &loadPlaylistButton, &playSelectedButton, &muteButton, &forwardButton, &backwardButton })
+    for (auto* btn : { &loadButton, &restartButton, &stopButton, &playButton, &pauseButton, &goToStartButton, &goToEndButton, &loopButton, &beginButton, &endButton, &loopABButton, &setBookMarkButton, &goToBookMarkButton, &loadPlaylistButton, &playSelectedButton, &exportPlaylistButton, &muteButton, &forwardButton, &backwardButton, &ramDeckButton, &normalizeButton, &syncButton, &quantizeButton, &vinylButton, &reverseButton, &channelsButton, &fxButton })
     {
         btn->setColour(juce::TextButton::buttonColourId, themeDeepViolet);
         btn->setColour(juce::TextButton::buttonOnColourId, themeAccentYellow);
@@ -113,6 +154,11 @@ PlayerGUI::PlayerGUI(PlayerAudio& audioRef)
     muteButton.setClickingTogglesState(true);
     loopButton.setClickingTogglesState(true);
     loopABButton.setClickingTogglesState(true);
+    ramDeckButton.setClickingTogglesState(true);
+    normalizeButton.setClickingTogglesState(true);
+    quantizeButton.setClickingTogglesState(true);
+    vinylButton.setClickingTogglesState(true);
+    reverseButton.setClickingTogglesState(true);
 
     // initialize toggle states to match PlayerAudio where a getter exists
     muteButton.setToggleState(playerAudio.getMuteState(), juce::dontSendNotification);
@@ -129,6 +175,11 @@ PlayerGUI::PlayerGUI(PlayerAudio& audioRef)
     applyToggleColour(muteButton);
     applyToggleColour(loopButton);
     applyToggleColour(loopABButton);
+    applyToggleColour(ramDeckButton);
+    applyToggleColour(normalizeButton);
+    applyToggleColour(quantizeButton);
+    applyToggleColour(vinylButton);
+    applyToggleColour(reverseButton);
 
     // السلايدر (colors only — styles set above)
     for (auto* slider : { &volumeSlider, &positionSlider, &speedSlider })
@@ -138,22 +189,87 @@ PlayerGUI::PlayerGUI(PlayerAudio& audioRef)
         slider->setColour(juce::Slider::backgroundColourId, juce::Colour::fromRGB(40, 0, 60));
     }
 
+    for (auto* knob : { &eqLowSlider, &eqMidSlider, &eqHighSlider, &filterSlider })
+    {
+        knob->setColour(juce::Slider::thumbColourId, themeAccentYellow);
+        knob->setColour(juce::Slider::rotarySliderFillColourId, themeAccentYellow);
+        knob->setColour(juce::Slider::rotarySliderOutlineColourId, juce::Colour::fromRGB(40, 0, 60));
+    }
+
+    for (auto* lbl : { &eqLowLabel, &eqMidLabel, &eqHighLabel, &filterLabel })
+        lbl->setColour(juce::Label::textColourId, themeAccentYellow);
+
+    // live output meter and spectrum
+    levelMeter.setColours(themeAccentYellow, juce::Colours::black.withAlpha(0.35f));
+    spectrumView.setColours(themeAccentYellow, juce::Colours::black.withAlpha(0.25f));
+    addAndMakeVisible(levelMeter);
+    addAndMakeVisible(spectrumView);
+
     // الليبلز
     {
-        std::array<juce::Label*, 6> lbls = { &titleLabel, &artistLabel, &durationLabel, &speedLabel, &timeLabel, &volumeLabel };
+        std::array<juce::Label*, 7> lbls = { &titleLabel, &artistLabel, &durationLabel, &speedLabel, &timeLabel, &volumeLabel, &bpmLabel };
         for (auto* lbl : lbls)
         {
             lbl->setColour(juce::Label::textColourId, themeAccentYellow);
         }
     }
 
+    // hot cue pads: click to jump (or set when empty), cmd/ctrl-click to clear
+    for (int i = 0; i < HotCueBank::numCues; ++i)
+    {
+        auto* b = hotCueButtons.add(new juce::TextButton(juce::String(i + 1)));
+        b->setColour(juce::TextButton::buttonColourId, themeDeepViolet);
+        b->setColour(juce::TextButton::textColourOffId, juce::Colours::white);
+        b->addListener(this);
+        addAndMakeVisible(b);
+    }
+    updateHotCueButtons();
+
     // make waveform taller by default (will be clamped in resized)
     waveformHeight = 180;
 
     startTimerHz(30);
 }
 
-PlayerGUI::~PlayerGUI() {}
+PlayerGUI::~PlayerGUI()
+{
+    if (auto* waveforms = BandWaveformCache::getInstanceWithoutCreating())
+        waveforms->cancelRequests(this);
+
+    if (exportWindow != nullptr)
+        delete exportWindow.getComponent();
+}
+
+// The waveform comes from the shared cache (analysed in the background the first time).
+void PlayerGUI::loadWaveform(const juce::File& file)
+{
+    auto* waveforms = BandWaveformCache::getInstance();
+    waveforms->cancelRequests(this);
+
+    waveform = nullptr;
+    waveformImage = {};
+    repaint();
+
+    waveforms->request(file, this, [this](BandWaveformCache::Waveform loaded)
+    {
+        waveform = std::move(loaded);
+        waveformImage = {};
+        repaint();
+    });
+}
+
+PlayerAudio::MemoryUsage PlayerGUI::getMemoryUsage() const
+{
+    auto usage = playerAudio.getMemoryUsage();
+
+    if (waveform != nullptr)
+        usage.waveform += waveform->getSizeInBytes();
+
+    if (waveformImage.isValid())
+        usage.waveform += (size_t) waveformImage.getWidth() * (size_t) waveformImage.getHeight() * sizeof(juce::PixelARGB);
+
+    return usage;
+}
 
 void PlayerGUI::paint(juce::Graphics& g)
 {
@@ -187,23 +303,61 @@ void PlayerGUI::paint(juce::Graphics& g)
     g.fillRoundedRectangle((float)waveformArea.getX() - 4.0f, (float)waveformArea.getY() - 4.0f,
                            (float)waveformArea.getWidth() + 8.0f, (float)waveformArea.getHeight() + 8.0f, 6.0f);
 
-    if (thumbnail.getTotalLength() > 0.0)
+    const double waveformLength = waveform != nullptr ? waveform->getLengthInSeconds() : 0.0;
+
+    if (waveformLength > 0.0)
     {
-        // Swap theme: waveform -> accent yellow, cursor -> deep violet
-        g.setColour(themeAccentYellow.withAlpha(0.95f)); // bright accent for waveform
-        // drawChannels into the smaller, centered waveform area
-        thumbnail.drawChannels(g, waveformArea.reduced(4), 0.0, thumbnail.getTotalLength(), 1.0f);
+        // the columns are only worked out again when the track or the size changes; the
+        // cursor's 60 Hz repaints just copy the image
+        auto waveformBounds = waveformArea.reduced(4);
+        if (waveformImage.getBounds() != waveformBounds.withZeroOrigin())
+        {
+            waveformImage = juce::Image(juce::Image::ARGB, juce::jmax(1, waveformBounds.getWidth()), juce::jmax(1, waveformBounds.getHeight()), true);
+            juce::Graphics imageGraphics(waveformImage);
+            waveform->draw(imageGraphics, waveformImage.getBounds());
+        }
+
+        g.drawImageAt(waveformImage, waveformBounds.getX(), waveformBounds.getY());
+
+        // beat grid ticks, skipped when zoomed out too far to tell them apart
+        const auto& grid = playerAudio.getBeatGrid();
+        double beatWidth = grid.isValid() ? grid.getBeatLength() / waveformLength * waveformArea.getWidth() : 0.0;
+        if (beatWidth >= 4.0)
+        {
+            g.setColour(juce::Colours::white.withAlpha(0.15f));
+            for (double t = grid.firstBeatSeconds; t < waveformLength; t += grid.getBeatLength())
+            {
+                int beatX = waveformArea.getX() + static_cast<int>(t / waveformLength * waveformArea.getWidth());
+                g.drawVerticalLine(beatX, (float)waveformArea.getY(), (float)waveformArea.getBottom());
+            }
+        }
+
+        // hot cue markers
+        g.setFont(12.0f);
+        for (int i = 0; i < HotCueBank::numCues; ++i)
+        {
+            if (!playerAudio.hasHotCue(i))
+                continue;
+
+            double cueProportion = playerAudio.getHotCuePosition(i) / waveformLength;
+            int cueX = waveformArea.getX() + static_cast<int>(cueProportion * waveformArea.getWidth());
+            g.setColour(juce::Colours::white.withAlpha(0.8f));
+            g.drawLine((float)cueX, (float)waveformArea.getY(), (float)cueX, (float)waveformArea.getBottom(), 1.0f);
+            g.drawText(juce::String(i + 1), cueX + 2, waveformArea.getY(), 14, 14, juce::Justification::centredLeft);
+        }
 
         // draw current position cursor relative to the centered waveformArea
-        double totalLength = thumbnail.getTotalLength();
-        double currentTime = playerAudio.getPosition();
+        double totalLength = waveformLength;
+        double currentTime = playerAudio.getDisplayPosition();
         double proportion = (totalLength > 0.0) ? (currentTime / totalLength) : 0.0;
-        int cursorX = waveformArea.getX() + static_cast<int>(proportion * waveformArea.getWidth());
+        cursorArea = waveformArea;
+        cursorX = waveformArea.getX() + static_cast<int>(proportion * waveformArea.getWidth());
         g.setColour(themeDeepViolet); // use violet for cursor
         g.drawLine((float)cursorX, (float)waveformArea.getY(), (float)cursorX, (float)waveformArea.getBottom(), 2.0f);
     }
     else
     {
+        cursorX = -1;
         g.setColour(juce::Colours::white.withAlpha(0.6f));
         g.drawFittedText("No waveform loaded", waveformArea, juce::Justification::centred, 1);
     }
@@ -213,6 +367,23 @@ void PlayerGUI::paint(juce::Graphics& g)
     g.drawRect(getLocalBounds().reduced(4), 2.0f);
 }
 
+// Repaints just the strip between where the cursor was drawn and where it is now.
+void PlayerGUI::updateCursor()
+{
+    double totalLength = waveform != nullptr ? waveform->getLengthInSeconds() : 0.0;
+    if (cursorX < 0 || totalLength <= 0.0)
+        return;
+
+    double proportion = playerAudio.getDisplayPosition() / totalLength;
+    int newX = cursorArea.getX() + static_cast<int>(proportion * cursorArea.getWidth());
+    if (newX == cursorX)
+        return;
+
+    int left = std::min(cursorX, newX) - 2;
+    int right = std::max(cursorX, newX) + 2;
+    repaint(left, cursorArea.getY(), right - left, cursorArea.getHeight());
+}
+
 void PlayerGUI::resized()
 {
     int margin = 10;
@@ -240,7 +411,15 @@ void PlayerGUI::resized()
         &setBookMarkButton,
         &goToBookMarkButton,
         &forwardButton,
-        &backwardButton
+        &backwardButton,
+        &ramDeckButton,
+        &normalizeButton,
+        &syncButton,
+        &quantizeButton,
+        &vinylButton,
+        &reverseButton,
+        &channelsButton,
+        &fxButton
     };
 
     int maxPerRow = std::max(1, (leftAreaWidth + spacing) / (smallBtnW + spacing));
@@ -302,20 +481,35 @@ void PlayerGUI::resized()
     durationLabel.setBounds(margin + 2 * (leftAreaWidth / 3), y, leftAreaWidth / 3 - 2 * margin, 20);
     y += 30;
 
+    // ===== hot cue pads, one centered row =====
+    {
+        const int cueW = 36;
+        const int cueH = 24;
+        int rowW = hotCueButtons.size() * cueW + (hotCueButtons.size() - 1) * spacing;
+        int cueX = margin + std::max(0, (leftAreaWidth - rowW) / 2);
+
+        for (auto* b : hotCueButtons)
+        {
+            b->setBounds(cueX, y, cueW, cueH);
+            cueX += cueW + spacing;
+        }
+    }
+
     // ===== playlist buttons (keep them at the top of the right panel) =====
     int rpX = getWidth() - rightPanelWidth - margin;
     int rpInnerPad = 8;
     int rpBtnW = rightPanelWidth - rpInnerPad * 2;
 
-    // place the two playlist control buttons near the top margin inside the right panel
+    // place the playlist control buttons near the top margin inside the right panel
     int rpTop = margin;
     loadPlaylistButton.setBounds(rpX + rpInnerPad, rpTop, rpBtnW, 26);
     playSelectedButton.setBounds(rpX + rpInnerPad, rpTop + 30, rpBtnW, 26);
+    exportPlaylistButton.setBounds(rpX + rpInnerPad, rpTop + 60, rpBtnW, 26);
 
-    // make playlist occupy the remaining height of the right panel (below the two buttons)
+    // make playlist occupy the remaining height of the right panel (below the buttons)
     int playlistX = rpX + rpInnerPad;
-    int playlistY = margin + 62; // push content a bit below the top buttons visually (buttons drawn on top)
-    int playlistH = getHeight() - 2 * margin - 62;
+    int playlistY = margin + 92; // push content a bit below the top buttons visually (buttons drawn on top)
+    int playlistH = getHeight() - 2 * margin - 92;
     if (playlistH < 100) playlistH = 100;
 
     // Use the computed playlistY/playlistH so the buttons do NOT overlap/hide the playlist
@@ -360,6 +554,7 @@ void PlayerGUI::resized()
     int sideH = waveformHeight;
 
     volumeSlider.setBounds(volX, sideY, sideSliderW, sideH);
+    levelMeter.setBounds(volX - 18, sideY, 12, sideH);
     speedSlider.setBounds(speedX, sideY, sideSliderW, sideH);
 
     // volume label above left-side slider
@@ -368,14 +563,71 @@ void PlayerGUI::resized()
     // speed label above right-side slider
     speedLabel.setBounds(speedX, sideY - 20, sideSliderW, 16);
 
+    // EQ / filter knobs in a 2x2 grid right of the speed slider
+    {
+        const int knobSize = 46;
+        const int knobLabelH = 14;
+        const int knobX = speedX + sideSliderW + sidePad;
+        std::array<juce::Slider*, 4> knobs = { &eqHighSlider, &eqMidSlider, &eqLowSlider, &filterSlider };
+        std::array<juce::Label*, 4> knobLabels = { &eqHighLabel, &eqMidLabel, &eqLowLabel, &filterLabel };
+
+        for (size_t i = 0; i < knobs.size(); ++i)
+        {
+            int kx = knobX + (int)(i % 2) * (knobSize + 6);
+            int ky = sideY - 20 + (int)(i / 2) * (knobSize + knobLabelH + 4);
+            knobLabels[i]->setBounds(kx, ky, knobSize, knobLabelH);
+            knobs[i]->setBounds(kx, ky + knobLabelH, knobSize, knobSize);
+        }
+    }
+
     // time label near left area but not overlapping playlist
     int timeLabelW = 100;
     timeLabel.setBounds(margin + leftAreaWidth - timeLabelW, waveformY - (posSliderH + 8), timeLabelW, posSliderH);
+    bpmLabel.setBounds(margin, waveformY - (posSliderH + 8), timeLabelW, posSliderH);
+
+    // spectrum fills the gap between the hot cue pads and the position slider
+    int spectrumTop = y + 24 + spacing;
+    int spectrumH = juce::jmin(90, waveformY - (posSliderH + 8) - spacing - spectrumTop);
+    spectrumView.setVisible(spectrumH >= 30);
+    spectrumView.setBounds(waveformX, spectrumTop, waveformTargetW, juce::jmax(0, spectrumH));
 
     // ensure waveformHeight is not too large for small windows
     waveformHeight = std::min(getHeight() / 3, 220);
 }
 
+void PlayerGUI::loadTrack(const juce::File& file)
+{
+    playerAudio.loadFile(file);
+    updateMetadataDisplay();
+    positionSlider.setRange(0.0, playerAudio.getLengthInSecond(), 0.01);
+    loadWaveform(file);
+}
+
+// Converts the playlist's tracks in a window of their own; closing it cancels the export.
+void PlayerGUI::showExportWindow()
+{
+    if (exportWindow != nullptr)
+    {
+        exportWindow->toFront(true);
+        return;
+    }
+
+    if (playlist.getFiles().isEmpty())
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::InfoIcon, "Export Playlist",
+                                               "Load some tracks into the playlist first.");
+        return;
+    }
+
+    juce::DialogWindow::LaunchOptions options;
+    options.content.setOwned(new BatchExportPanel(playlist.getFiles()));
+    options.dialogTitle = "Export Playlist";
+    options.dialogBackgroundColour = juce::Colours::darkgrey;
+    options.useNativeTitleBar = true;
+    options.resizable = false;
+    exportWindow = options.launchAsync();
+}
+
 void PlayerGUI::buttonClicked(juce::Button* button)
 {
     if (button == &loadButton)
@@ -388,13 +640,7 @@ void PlayerGUI::buttonClicked(juce::Button* button)
             {
                 auto file = fc.getResult();
                 if (file.existsAsFile())
-                {
-                    playerAudio.loadFile(file);
-                    updateMetadataDisplay();
-                    positionSlider.setRange(0.0, playerAudio.getLengthInSecond(), 0.01);
-                    thumbnail.clear();
-                    thumbnail.setSource(new juce::FileInputSource(file));
-                }
+                    loadTrack(file);
             });
     }
     else if (button == &restartButton)
@@ -402,7 +648,15 @@ void PlayerGUI::buttonClicked(juce::Button* button)
     else if (button == &stopButton)
         playerAudio.stop();
     else if (button == &playButton)
-        playerAudio.play();
+    {
+        // with Quantize on, launch exactly on the other deck's next beat
+        auto beat = quantizeButton.getToggleState() && syncMaster != nullptr ? syncMaster->getNextBeatSampleTime() : -1;
+
+        if (beat >= 0)
+            playerAudio.scheduleStart(beat);
+        else
+            playerAudio.play();
+    }
     else if (button == &pauseButton)
         playerAudio.pause();
     else if (button == &goToStartButton)
@@ -479,6 +733,8 @@ void PlayerGUI::buttonClicked(juce::Button* button)
                     playlist.addFile(file);
             });
     }
+    else if (button == &exportPlaylistButton)
+        showExportWindow();
     else if (button == &playSelectedButton)
     {
         int selected = playlist.getSelectedRow();
@@ -490,11 +746,60 @@ void PlayerGUI::buttonClicked(juce::Button* button)
                 playerAudio.loadFile(selectedFile);
                 playerAudio.play();
                 updateMetadataDisplay();
-                thumbnail.clear();
-                thumbnail.setSource(new juce::FileInputSource(selectedFile));
+                loadWaveform(selectedFile);
             }
         }
     }
+    else if (button == &ramDeckButton)
+    {
+        playerAudio.setRamDeckEnabled(ramDeckButton.getToggleState());
+
+        bool on = ramDeckButton.getToggleState();
+        ramDeckButton.setColour(juce::TextButton::buttonColourId, on ? themeAccentYellow : themeDeepViolet);
+        ramDeckButton.setColour(juce::TextButton::textColourOffId, on ? juce::Colours::black : juce::Colours::white);
+        ramDeckButton.repaint();
+    }
+    else if (button == &normalizeButton)
+    {
+        playerAudio.setNormalizationEnabled(normalizeButton.getToggleState());
+
+        bool on = normalizeButton.getToggleState();
+        normalizeButton.setColour(juce::TextButton::buttonColourId, on ? themeAccentYellow : themeDeepViolet);
+        normalizeButton.setColour(juce::TextButton::textColourOffId, on ? juce::Colours::black : juce::Colours::white);
+        normalizeButton.repaint();
+    }
+    else if (button == &syncButton)
+    {
+        if (syncMaster != nullptr && playerAudio.syncTo(*syncMaster))
+            speedSlider.setValue(playerAudio.getResamplingRatio(), juce::dontSendNotification);
+    }
+    else if (button == &quantizeButton)
+    {
+        playerAudio.setQuantizeEnabled(quantizeButton.getToggleState());
+
+        bool on = quantizeButton.getToggleState();
+        quantizeButton.setColour(juce::TextButton::buttonColourId, on ? themeAccentYellow : themeDeepViolet);
+        quantizeButton.setColour(juce::TextButton::textColourOffId, on ? juce::Colours::black : juce::Colours::white);
+        quantizeButton.repaint();
+    }
+    else if (button == &vinylButton || button == &reverseButton)
+    {
+        // vinyl: the jog wheel scratches; reverse: play backwards
+        playerAudio.setVinylMode(vinylButton.getToggleState());
+        playerAudio.setReverse(reverseButton.getToggleState());
+
+        for (auto* b : { &vinylButton, &reverseButton })
+        {
+            bool on = b->getToggleState();
+            b->setColour(juce::TextButton::buttonColourId, on ? themeAccentYellow : themeDeepViolet);
+            b->setColour(juce::TextButton::textColourOffId, on ? juce::Colours::black : juce::Colours::white);
+            b->repaint();
+        }
+    }
+    else if (button == &channelsButton)
+    {
+        showDownmixMenu();
+    }
     else if (button == &forwardButton)
     {
         playerAudio.skipForward(10.0);
@@ -503,13 +808,58 @@ void PlayerGUI::buttonClicked(juce::Button* button)
     {
         playerAudio.skipBackward(10.0);
     }
+    else
+    {
+        for (int i = 0; i < hotCueButtons.size(); ++i)
+        {
+            if (button == hotCueButtons[i])
+            {
+                if (juce::ModifierKeys::currentModifiers.isCommandDown())
+                    playerAudio.clearHotCue(i);
+                else
+                    playerAudio.triggerHotCue(i);
+
+                updateHotCueButtons();
+            }
+        }
+    }
+}
+
+void PlayerGUI::showDownmixMenu()
+{
+    using Preset = DownmixMatrix::Preset;
+
+    juce::PopupMenu menu;
+    menu.addSectionHeader("Multichannel tracks");
+
+    for (auto preset : { Preset::automatic, Preset::stemPairs, Preset::frontPair, Preset::monoSum })
+        menu.addItem(1 + (int) preset, DownmixMatrix::getPresetName(preset), true, playerAudio.getDownmixPreset() == preset);
+
+    juce::Component::SafePointer<PlayerGUI> safeThis(this);
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&channelsButton), [safeThis](int result)
+    {
+        if (safeThis != nullptr && result > 0)
+            safeThis->playerAudio.setDownmixPreset((Preset) (result - 1));
+    });
+}
+
+void PlayerGUI::updateFromPlayer()
+{
+    volumeSlider.setValue(playerAudio.getGain(), juce::dontSendNotification);
+    speedSlider.setValue(playerAudio.getResamplingRatio(), juce::dontSendNotification);
+    updateHotCueButtons();
 }
 
 void PlayerGUI::timerCallback()
 {
+    // a MIDI controller moved this deck's gain
+    auto controllerGain = playerAudio.takeControllerGain();
+    if (controllerGain >= 0.0f)
+        volumeSlider.setValue(controllerGain, juce::dontSendNotification);
+
     if (playerAudio.isFileLoaded())
     {
-        double currentTime = playerAudio.getPosition();
+        double currentTime = playerAudio.getDisplayPosition();
         int hours = static_cast<int>(currentTime) / 3600;
         int minutes = static_cast<int>(currentTime) / 60;
         int seconds = static_cast<int>(currentTime) % 60;
@@ -518,6 +868,17 @@ void PlayerGUI::timerCallback()
         timeLabel.setText(timeText, juce::dontSendNotification);
         positionSlider.setValue(currentTime, juce::dontSendNotification);
         playerAudio.loopBetweenTwoPoints();
+        playerAudio.keepLoopStartWarm();
+        updateHotCueButtons(); // cues change when a new file (and its saved cues) is loaded
+        updateMetadataDisplay(); // tags arrive from a background job after loading
+
+        channelsButton.setButtonText(DownmixMatrix::describeLayout(playerAudio.getSourceChannels()));
+        channelsButton.setTooltip(playerAudio.getBusChannels() > DownmixMatrix::numOutputs
+                                      ? "Playing on outputs 1-" + juce::String(playerAudio.getBusChannels())
+                                      : juce::String("Playing in stereo"));
+
+        auto bpm = playerAudio.getEffectiveBpm();
+        bpmLabel.setText(bpm > 0.0 ? "BPM: " + juce::String(bpm, 1) : juce::String("BPM: ---"), juce::dontSendNotification);
     }
 
     repaint();
@@ -542,7 +903,25 @@ void PlayerGUI::sliderValueChanged(juce::Slider* slider)
     }
     else if (slider == &speedSlider)
         playerAudio.setResamplingRatio(speedSlider.getValue());
+    else if (slider == &eqLowSlider)
+        playerAudio.setEqBandGain(DeckEq::low, (float)slider->getValue());
+    else if (slider == &eqMidSlider)
+        playerAudio.setEqBandGain(DeckEq::mid, (float)slider->getValue());
+    else if (slider == &eqHighSlider)
+        playerAudio.setEqBandGain(DeckEq::high, (float)slider->getValue());
+    else if (slider == &filterSlider)
+        playerAudio.setFilterPosition((float)slider->getValue());
+}
+void PlayerGUI::updateHotCueButtons()
+{
+    for (int i = 0; i < hotCueButtons.size(); ++i)
+    {
+        bool set = playerAudio.hasHotCue(i);
+        hotCueButtons[i]->setColour(juce::TextButton::buttonColourId, set ? themeAccentYellow : themeDeepViolet);
+        hotCueButtons[i]->setColour(juce::TextButton::textColourOffId, set ? juce::Colours::black : juce::Colours::white);
+    }
 }
+
 void PlayerGUI::updateMetadataDisplay()
 {
     titleLabel.setText("Title: " + playerAudio.getTitle(), juce::dontSendNotification);
@@ -592,6 +971,17 @@ bool PlayerGUI::keyPressed(const juce::KeyPress& key)
         playerAudio.skipBackward(5.0);
     else if (key == juce::KeyPress::rightKey)
 		playerAudio.skipForward(5.0);
+    else if (key.getKeyCode() >= '1' && key.getKeyCode() < '1' + HotCueBank::numCues)
+    {
+        // 1-8 trigger hot cues, cmd/ctrl + number clears one
+        int cue = key.getKeyCode() - '1';
+        if (key.getModifiers().isCommandDown())
+            playerAudio.clearHotCue(cue);
+        else
+            playerAudio.triggerHotCue(cue);
+
+        updateHotCueButtons();
+    }
 
     return true;
 }
\ No newline at end of file
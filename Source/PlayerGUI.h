@@ -2,6 +2,10 @@
 #include <JuceHeader.h>
 #include "PlayerAudio.h"
 #include "PlaylistComponent.h"
+#include "Meters.h"
+#include "InsertChainButton.h"
+#include "BandWaveform.h"
+#include "BatchExport.h"
 
 class PlayerGUI : public juce::Component,
     public juce::Button::Listener,
@@ -22,6 +26,19 @@ public:
     void setGain(float gain);
     float getGain() const;
     void updateMetadataDisplay();
+    void updateHotCueButtons();
+
+    // sliders to the player's gain and speed, e.g. after its session is restored
+    void updateFromPlayer();
+
+    // loads a track into the deck and shows its metadata and waveform
+    void loadTrack(const juce::File& file);
+
+    // the player's memory plus this deck's waveform and its drawn image
+    PlayerAudio::MemoryUsage getMemoryUsage() const;
+
+    // deck whose tempo and phase the Sync button follows
+    void setSyncMaster(PlayerAudio* masterDeck) { syncMaster = masterDeck; }
 
     void mouseDown(const juce::MouseEvent& event) override; // to seek in waveforma
 
@@ -30,6 +47,7 @@ public:
 
 private:
     PlayerAudio& playerAudio;
+    PlayerAudio* syncMaster = nullptr;
 
     juce::TextButton loadButton{ "Load File" };
     juce::TextButton restartButton{ "Restart" };
@@ -55,6 +73,18 @@ private:
     juce::TextButton backwardButton{ "<< -10s" };
     //----------------------------------------------------
 
+    juce::TextButton ramDeckButton{ "RAM Deck" };
+    juce::TextButton normalizeButton{ "Normalize" };
+    juce::TextButton syncButton{ "Sync" };
+    juce::TextButton quantizeButton{ "Quantize" };
+    juce::TextButton vinylButton{ "Vinyl" };
+    juce::TextButton reverseButton{ "Reverse" };
+    juce::TextButton channelsButton{ "-" }; // the track's layout; click for the downmix preset
+    void showDownmixMenu();
+    InsertChainButton fxButton{ playerAudio.getInserts() };
+
+    juce::OwnedArray<juce::TextButton> hotCueButtons;
+
     juce::Slider volumeSlider;
     juce::Label volumeLabel;               // <--- added (was referenced from cpp)
     juce::Slider positionSlider;
@@ -62,6 +92,14 @@ private:
     juce::Label speedLabel;         // ? ????
     juce::Label timeLabel;
 
+    // DJ EQ knobs (dB) and bipolar filter knob
+    juce::Slider eqLowSlider, eqMidSlider, eqHighSlider, filterSlider;
+    juce::Label eqLowLabel, eqMidLabel, eqHighLabel, filterLabel;
+
+    LevelMeter levelMeter{ playerAudio.getTap() };
+    SpectrumView spectrumView{ playerAudio.getTap() };
+    juce::Label bpmLabel;
+
     juce::TextButton muteButton{ "Mute" };
 
     std::unique_ptr<juce::FileChooser> fileChooser;
@@ -80,17 +118,26 @@ private:
     juce::Viewport playlistViewport;
     juce::TextButton loadPlaylistButton{ "Load Playlist" };
     juce::TextButton playSelectedButton{ "Play Selected" };
+    juce::TextButton exportPlaylistButton{ "Export Playlist..." };
+    juce::Component::SafePointer<juce::DialogWindow> exportWindow;
+    void showExportWindow();
 
     juce::Label titleLabel;
     juce::Label artistLabel;
     juce::Label durationLabel;
 
-    // Waveform / thumbnail
-    juce::AudioFormatManager formatManager;
-    juce::AudioThumbnailCache thumbnailCache{ 5 };
-    juce::AudioThumbnail thumbnail{ 512, formatManager, thumbnailCache };
+    // RGB waveform, drawn into an image whenever it or the waveform area changes
+    BandWaveformCache::Waveform waveform;
+    juce::Image waveformImage;
+    void loadWaveform(const juce::File& file);
     int waveformHeight = 120; // height of waveform area
 
+    // the cursor is redrawn every display frame, between the 30 Hz full repaints
+    void updateCursor();
+    juce::Rectangle<int> cursorArea; // waveform area as of the last paint
+    int cursorX = -1;
+    juce::VBlankAttachment cursorVBlank{ this, [this] { updateCursor(); } };
+
     // Theme colours used by PlayerGUI.cpp (declare here so cpp can reference them)
     juce::Colour themeAccentYellow { juce::Colour::fromRGB(255, 215, 0) };
     juce::Colour themeDeepViolet  { juce::Colour::fromRGB(100, 0, 160) };
@@ -0,0 +1,74 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+
+// A deck's playhead as of its last audio block: position, when that block started and how
+// fast the position moved through it. The audio thread publishes it (seqlock, no waiting)
+// and the GUI extrapolates to the current time, so cursors move smoothly between blocks
+// without going near the transport.
+class PlayheadSnapshot
+{
+public:
+    // Audio thread, once per block. Callback start times are smoothed so scheduling jitter
+    // doesn't show up as cursor jitter.
+    void publish(double startSeconds, double endSeconds, int numSamples, double sampleRate, double callbackTimeMs)
+    {
+        const double blockMs = 1000.0 * numSamples / sampleRate;
+
+        double blockTimeMs = callbackTimeMs;
+        if (nextBlockTimeMs > 0.0 && std::abs(callbackTimeMs - nextBlockTimeMs) < 50.0)
+            blockTimeMs = nextBlockTimeMs + 0.05 * (callbackTimeMs - nextBlockTimeMs);
+
+        nextBlockTimeMs = blockTimeMs + blockMs;
+
+        // a seek inside the block isn't motion: restart from where it landed
+        double rate = blockMs > 0.0 ? (endSeconds - startSeconds) * 1000.0 / blockMs : 0.0;
+        if (std::abs(rate) > 16.0)
+        {
+            startSeconds = endSeconds;
+            rate = 0.0;
+        }
+
+        const auto seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        position.store(startSeconds, std::memory_order_relaxed);
+        timeMs.store(blockTimeMs, std::memory_order_relaxed);
+        secondsPerSecond.store(rate, std::memory_order_relaxed);
+
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    bool hasValue() const { return sequence.load(std::memory_order_acquire) != 0; }
+
+    // any thread: the playhead extrapolated to now (not beyond a short way past the last
+    // block, in case the audio stops)
+    double getPositionNow() const
+    {
+        double p, t, rate;
+
+        for (;;)
+        {
+            const auto before = sequence.load(std::memory_order_acquire);
+            p = position.load(std::memory_order_relaxed);
+            t = timeMs.load(std::memory_order_relaxed);
+            rate = secondsPerSecond.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if ((before & 1) == 0 && sequence.load(std::memory_order_relaxed) == before)
+                break;
+        }
+
+        const double elapsedMs = juce::jlimit(0.0, 250.0, juce::Time::getMillisecondCounterHiRes() - t);
+        return juce::jmax(0.0, p + rate * elapsedMs / 1000.0);
+    }
+
+private:
+    std::atomic<juce::uint32> sequence{ 0 };
+    std::atomic<double> position{ 0.0 };
+    std::atomic<double> timeMs{ 0.0 };
+    std::atomic<double> secondsPerSecond{ 0.0 };
+
+    double nextBlockTimeMs = 0.0; // audio thread only
+};
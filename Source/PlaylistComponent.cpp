@@ -1,16 +1,23 @@
 #include "PlaylistComponent.h"
+#include "Loudness.h"
 
 PlaylistComponent::PlaylistComponent()
 {
     addAndMakeVisible(tableComponent);
     tableComponent.setModel(this);
     tableComponent.getHeader().addColumn("track", 1, 400);
+    tableComponent.getHeader().addColumn("LUFS", 2, 56, 56, 56);
+    tableComponent.getHeader().setStretchToFitActive(true);
 
     // Apply default theme (PlayerGUI will call setTheme(...) to override)
     setTheme(themeDeepViolet, themeAccentYellow);
 }
 
-PlaylistComponent::~PlaylistComponent() {}
+PlaylistComponent::~PlaylistComponent()
+{
+    if (auto* loudness = LoudnessCache::getInstanceWithoutCreating())
+        loudness->cancelRequests(this);
+}
 
 void PlaylistComponent::setTheme(const juce::Colour& deepViolet, const juce::Colour& accentYellow)
 {
@@ -62,6 +69,22 @@ void PlaylistComponent::paintCell(juce::Graphics& g, int rowNumber, int columnId
     {
         g.setColour(rowIsSelected ? juce::Colours::black : themeAccentYellow);
         g.setFont(14.0f);
+        if (columnId == 2)
+        {
+            auto& loudness = rowLoudness.getReference(rowNumber);
+
+            // rows on screen are analysed before the rest of the library
+            if (loudness.text.isEmpty() && !loudness.promoted)
+            {
+                loudness.promoted = true;
+                LoudnessCache::getInstance()->request(playlistFiles[rowNumber], this, nullptr, JobScheduler::Priority::visibleRow);
+            }
+
+            g.drawText(loudness.text.isNotEmpty() ? loudness.text : juce::String("..."),
+                       4, 0, width - 8, height, juce::Justification::centredRight);
+            return;
+        }
+
         g.drawText(playlistFiles[rowNumber].getFileName(),
                    4, 0, width - 8, height, juce::Justification::centredLeft);
     }
@@ -69,8 +92,18 @@ void PlaylistComponent::paintCell(juce::Graphics& g, int rowNumber, int columnId
 
 void PlaylistComponent::addFile(const juce::File& audioFile)
 {
+    const int row = playlistFiles.size();
     playlistFiles.add(audioFile);
+    rowLoudness.add({});
     tableComponent.updateContent();
+
+    // measure loudness in the background so decks can normalize on load; a file that was
+    // analysed before calls back straight away
+    LoudnessCache::getInstance()->request(audioFile, this, [this, row](const LoudnessResult& result)
+    {
+        rowLoudness.getReference(row).text = juce::String(result.integratedLufs, 1);
+        tableComponent.repaintRow(row);
+    });
 }
 
 juce::File PlaylistComponent::getFile(int index) const
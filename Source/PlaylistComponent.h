@@ -17,6 +17,7 @@ public:
 
     void addFile(const juce::File& audioFile);
     juce::File getFile(int index) const;
+    const juce::Array<juce::File>& getFiles() const { return playlistFiles; }
     int getSelectedRow() const;
 
     // Theme API  PlayerGUI calls this so playlist matches the same colors
@@ -26,6 +27,15 @@ private:
     juce::TableListBox tableComponent;
     juce::Array<juce::File> playlistFiles;
 
+    // LUFS column per row, filled in when the row's analysis is known, so painting a cell
+    // never has to look the file up
+    struct RowLoudness
+    {
+        juce::String text;
+        bool promoted = false; // asked for ahead of the library once it was on screen
+    };
+    juce::Array<RowLoudness> rowLoudness;
+
     // theme defaults (will be overridden by setTheme)
     juce::Colour themeDeepViolet  { juce::Colour::fromRGB(100, 0, 160) };
     juce::Colour themeAccentYellow{ juce::Colour::fromRGB(255, 215, 0) };
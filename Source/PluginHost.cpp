@@ -0,0 +1,115 @@
+#include "PluginHost.h"
+#include "AppLog.h"
+
+JUCE_IMPLEMENT_SINGLETON(PluginHost)
+
+PluginHost::PluginHost()
+{
+    formatManager.addDefaultFormats();
+
+    juce::PropertiesFile::Options options;
+    options.applicationName = "SimpleAudioPlayer";
+    options.filenameSuffix = "plugins";
+    options.folderName = "SimpleAudioPlayer";
+    options.osxLibrarySubFolder = "Application Support";
+    options.storageFormat = juce::PropertiesFile::storeAsXML;
+
+    store = std::make_unique<juce::PropertiesFile>(options);
+    deadMansPedal = store->getFile().getSiblingFile("plugin-scan-in-progress.txt");
+
+    if (auto xml = store->getXmlValue("knownPlugins"))
+        knownPlugins.recreateFromXml(*xml);
+
+    jobs = JobScheduler::getInstance()->createGroup();
+}
+
+PluginHost::~PluginHost()
+{
+    if (auto* scheduler = JobScheduler::getInstanceWithoutCreating())
+        scheduler->cancelGroup(jobs, true);
+
+    clearSingletonInstance();
+}
+
+juce::Array<juce::PluginDescription> PluginHost::getEffects() const
+{
+    juce::Array<juce::PluginDescription> effects;
+
+    for (auto& d : knownPlugins.getTypes())
+        if (!d.isInstrument)
+            effects.add(d);
+
+    return effects;
+}
+
+void PluginHost::startScan()
+{
+    if (scanning)
+        return;
+
+    scanning = true;
+    sendChangeMessage();
+
+    juce::WeakReference<PluginHost> weakThis(this);
+    JobScheduler::getInstance()->schedule("Plugin scan", JobScheduler::Priority::library, jobs,
+        [weakThis, this, pedal = deadMansPedal](const JobScheduler::Context& context)
+        {
+            // the formats and the list outlive the job: the destructor waits for it
+            scan(weakThis, formatManager, knownPlugins, pedal, context);
+        });
+}
+
+// First run, or the last scan never finished (the dead-man's pedal skips whatever crashed it).
+void PluginHost::startScanIfNeverScanned()
+{
+    if (!store->containsKey("knownPlugins"))
+        startScan();
+}
+
+// Worker thread. KnownPluginList locks internally, so the UI can read it meanwhile.
+void PluginHost::scan(juce::WeakReference<PluginHost> host, juce::AudioPluginFormatManager& formats,
+                      juce::KnownPluginList& list, const juce::File& deadMansPedal,
+                      const JobScheduler::Context& context)
+{
+    for (auto* format : formats.getFormats())
+    {
+        if (!format->canScanForPlugins())
+            continue;
+
+        juce::PluginDirectoryScanner scanner(list, *format, format->getDefaultLocationsToSearch(),
+                                             true, deadMansPedal, false);
+        juce::String pluginName;
+
+        while (!context.shouldStop() && scanner.scanNextFile(true, pluginName))
+            APP_LOG(plugins, debug, "Scanned {}", pluginName);
+
+        for (auto& failed : scanner.getFailedFiles())
+            APP_LOG(plugins, warning, "Couldn't load {}", failed);
+    }
+
+    juce::MessageManager::callAsync([host]
+    {
+        if (auto* h = host.get())
+            h->scanFinished();
+    });
+}
+
+void PluginHost::scanFinished()
+{
+    scanning = false;
+    APP_LOG(plugins, info, "Plugin scan finished: {} plugins known", knownPlugins.getNumTypes());
+
+    if (auto xml = knownPlugins.createXml())
+    {
+        store->setValue("knownPlugins", xml.get());
+        store->saveIfNeeded();
+    }
+
+    sendChangeMessage();
+}
+
+void PluginHost::createInstance(const juce::PluginDescription& description, double sampleRate, int blockSize,
+                                InstanceCallback callback)
+{
+    formatManager.createPluginInstanceAsync(description, sampleRate, blockSize, std::move(callback));
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <JuceHeader.h>
+#include "JobScheduler.h"
+
+// Knows which effect plugins (VST3 / LV2, whatever formats JUCE was built with) are
+// installed and creates instances of them. Scanning runs as a scheduler job, never on
+// the message thread; a dead-man's-pedal file records the plugin being scanned, so one
+// that crashes the app is skipped by every later scan instead of crashing it again.
+// Sends a change message when the list changes.
+class PluginHost : public juce::DeletedAtShutdown,
+                   public juce::ChangeBroadcaster
+{
+public:
+    using InstanceCallback = std::function<void(std::unique_ptr<juce::AudioPluginInstance>, const juce::String& error)>;
+
+    PluginHost();
+    ~PluginHost() override;
+
+    const juce::KnownPluginList& getKnownPlugins() const { return knownPlugins; }
+    juce::Array<juce::PluginDescription> getEffects() const;
+
+    void startScan();
+    void startScanIfNeverScanned();
+    bool isScanning() const { return scanning; }
+
+    // message thread; the callback also runs on the message thread
+    void createInstance(const juce::PluginDescription& description, double sampleRate, int blockSize,
+                        InstanceCallback callback);
+
+    JUCE_DECLARE_SINGLETON(PluginHost, false)
+
+private:
+    static void scan(juce::WeakReference<PluginHost> host, juce::AudioPluginFormatManager& formats,
+                     juce::KnownPluginList& list, const juce::File& deadMansPedal,
+                     const JobScheduler::Context& context);
+    void scanFinished();
+
+    juce::AudioPluginFormatManager formatManager;
+    juce::KnownPluginList knownPlugins;
+    std::unique_ptr<juce::PropertiesFile> store;
+    juce::File deadMansPedal;
+    bool scanning = false;
+    JobScheduler::GroupId jobs = JobScheduler::noGroup;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(PluginHost)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginHost)
+};
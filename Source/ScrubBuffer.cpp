@@ -0,0 +1,215 @@
+#include "ScrubBuffer.h"
+
+ScrubBuffer::ScrubBuffer()
+    : juce::Thread("Scrub buffer")
+{
+    ring.setSize(numChannels, capacity);
+    ring.clear();
+    chunk.setSize(numChannels, chunkSize);
+    sourceChunk.setSize(DownmixMatrix::maxInputs, chunkSize);
+
+    startThread(juce::Thread::Priority::high);
+}
+
+ScrubBuffer::~ScrubBuffer()
+{
+    stopThread(4000);
+}
+
+void ScrubBuffer::setSource(HotCueBank::ReaderFactory newFactory)
+{
+    {
+        const juce::ScopedLock sl(sourceLock);
+        factory = std::move(newFactory);
+        ++sourceVersion;
+    }
+
+    notify();
+}
+
+void ScrubBuffer::setDownmix(const DownmixMatrix& newDownmix)
+{
+    {
+        const juce::ScopedLock sl(sourceLock);
+        downmix = newDownmix;
+        ++sourceVersion;
+    }
+
+    notify();
+}
+
+void ScrubBuffer::run()
+{
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    DownmixMatrix matrix;
+    int loadedVersion = -1;
+
+    while (!threadShouldExit())
+    {
+        HotCueBank::ReaderFactory newFactory;
+        bool changed = false;
+        {
+            const juce::ScopedLock sl(sourceLock);
+            if (sourceVersion != loadedVersion)
+            {
+                newFactory = factory;
+                matrix = downmix;
+                loadedVersion = sourceVersion;
+                changed = true;
+            }
+        }
+
+        if (changed)
+        {
+            validEnd = validStart.load(); // empty while the new reader opens
+
+            reader = newFactory != nullptr ? newFactory() : nullptr;
+            sourceSampleRate = reader != nullptr ? reader->sampleRate : 0.0;
+            sourceLength = reader != nullptr ? reader->lengthInSamples : 0;
+
+            const auto start = juce::jlimit<juce::int64>(0, sourceLength.load(), playhead.load());
+            validStart = start;
+            validEnd = start;
+        }
+
+        // keep going while there is work, otherwise look again shortly
+        if (active.load() && reader != nullptr && fillStep(*reader, matrix))
+            continue;
+
+        wait(5);
+    }
+}
+
+// Decodes one chunk on whichever side of the playhead has less in hand. False when the
+// window around the playhead is complete.
+bool ScrubBuffer::fillStep(juce::AudioFormatReader& reader, const DownmixMatrix& matrix)
+{
+    const juce::int64 length = sourceLength.load();
+    const juce::int64 half = (capacity - 4 * chunkSize) / 2;
+    const juce::int64 p = juce::jlimit<juce::int64>(0, length, playhead.load());
+    const juce::int64 wantStart = juce::jmax<juce::int64>(0, p - half);
+    const juce::int64 wantEnd = juce::jmin(length, p + half);
+
+    auto start = validStart.load();
+    auto end = validEnd.load();
+
+    // the playhead jumped out of what we have: start again from there
+    if (p < start - chunkSize || p > end + chunkSize)
+    {
+        validEnd = start;
+        validStart = p;
+        validEnd = p;
+        return true;
+    }
+
+    auto fillForwards = [&]
+    {
+        if (end >= wantEnd)
+            return false;
+
+        const int n = (int) juce::jmin<juce::int64>(chunkSize, wantEnd - end);
+
+        // give up the oldest frames before their slots are overwritten; they are at least
+        // half a window behind the playhead, so the audio thread isn't reading them
+        if (end + n - start > capacity)
+            validStart = end + n - capacity;
+
+        readIntoRing(reader, matrix, end, n);
+        validEnd = end + n;
+        return true;
+    };
+
+    auto fillBackwards = [&]
+    {
+        if (start <= wantStart)
+            return false;
+
+        const int n = (int) juce::jmin<juce::int64>(chunkSize, start - wantStart);
+        const juce::int64 newStart = start - n;
+
+        if (end - newStart > capacity)
+            validEnd = newStart + capacity;
+
+        readIntoRing(reader, matrix, newStart, n);
+        validStart = newStart;
+        return true;
+    };
+
+    if (end - p <= p - start)
+        return fillForwards() || fillBackwards();
+
+    return fillBackwards() || fillForwards();
+}
+
+void ScrubBuffer::readIntoRing(juce::AudioFormatReader& reader, const DownmixMatrix& matrix, juce::int64 start, int numFrames)
+{
+    // a mono reader is copied to both channels; anything else is mixed down like the deck's
+    if (matrix.isPassThrough())
+    {
+        reader.read(&chunk, 0, numFrames, start, true, true);
+    }
+    else
+    {
+        reader.read(&sourceChunk, 0, numFrames, start, true, true);
+        matrix.process(sourceChunk, 0, chunk, 0, numFrames);
+    }
+
+    const int index = (int) (start % capacity);
+    const int first = juce::jmin(numFrames, capacity - index);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        ring.copyFrom(ch, index, chunk, ch, 0, first);
+
+        if (first < numFrames)
+            ring.copyFrom(ch, 0, chunk, ch, first, numFrames - first);
+    }
+}
+
+float ScrubBuffer::sampleAt(int channel, juce::int64 frame) const
+{
+    return ring.getSample(channel, (int) (frame % capacity));
+}
+
+void ScrubBuffer::render(juce::AudioBuffer<float>& buffer, int startSample, int numSamples,
+                         double& position, double startRate, double endRate) const
+{
+    const auto start = validStart.load();
+    const auto end = validEnd.load();
+    const int outChannels = juce::jmin(numChannels, buffer.getNumChannels());
+    const double rateStep = numSamples > 0 ? (endRate - startRate) / numSamples : 0.0;
+    double rate = startRate;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto frame = (juce::int64) std::floor(position);
+        const float t = (float) (position - (double) frame);
+
+        // 4-point Hermite; anything not decoded (yet) is silence
+        if (frame - 1 >= start && frame + 2 < end)
+        {
+            for (int ch = 0; ch < outChannels; ++ch)
+            {
+                const float y0 = sampleAt(ch, frame - 1), y1 = sampleAt(ch, frame);
+                const float y2 = sampleAt(ch, frame + 1), y3 = sampleAt(ch, frame + 2);
+
+                const float c1 = 0.5f * (y2 - y0);
+                const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+                const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+
+                buffer.setSample(ch, startSample + i, ((c3 * t + c2) * t + c1) * t + y1);
+            }
+        }
+        else
+        {
+            for (int ch = 0; ch < outChannels; ++ch)
+                buffer.setSample(ch, startSample + i, 0.0f);
+        }
+
+        position += rate;
+        rate += rateStep;
+    }
+
+    for (int ch = outChannels; ch < buffer.getNumChannels(); ++ch)
+        buffer.copyFrom(ch, startSample, buffer, 0, startSample, numSamples);
+}
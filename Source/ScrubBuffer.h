@@ -0,0 +1,72 @@
+#pragma once
+#include <JuceHeader.h>
+#include "HotCues.h"
+#include "DownmixMatrix.h"
+#include <atomic>
+
+// Decoded audio around the playhead, in both directions, for scratching and reverse play
+// (AudioTransportSource only goes forwards). A background thread keeps the window centred
+// on wherever the audio thread last said the playhead is, decoding with its own reader,
+// so the audio thread only ever reads memory. Frames that haven't arrived yet play as
+// silence rather than blocking.
+class ScrubBuffer : private juce::Thread
+{
+public:
+    ScrubBuffer();
+    ~ScrubBuffer() override;
+
+    // message thread: a new track (or none); the reader is created on the fill thread
+    void setSource(HotCueBank::ReaderFactory newFactory);
+
+    // message thread: how the source's channels fold to stereo; refills the window
+    void setDownmix(const DownmixMatrix& newDownmix);
+
+    double getSourceSampleRate() const { return sourceSampleRate.load(); }
+    juce::int64 getSourceLength() const { return sourceLength.load(); }
+
+    // the window and the fill thread's scratch, all allocated up front
+    static constexpr size_t getSizeInBytes()
+    {
+        return ((size_t) numChannels * capacity + (size_t) numChannels * chunkSize
+                + (size_t) DownmixMatrix::maxInputs * chunkSize) * sizeof(float);
+    }
+
+    // the fill thread only decodes while active (a deck in vinyl or reverse mode)
+    void setActive(bool shouldBeActive) { active = shouldBeActive; notify(); }
+
+    // audio thread: where the window should be centred, in source frames
+    void setPlayhead(juce::int64 frame) { playhead = frame; }
+
+    // Audio thread: renders numSamples starting at position (source frames, advanced on
+    // return), with the step per output sample gliding from startRate to endRate.
+    // Negative rates play backwards.
+    void render(juce::AudioBuffer<float>& buffer, int startSample, int numSamples,
+                double& position, double startRate, double endRate) const;
+
+private:
+    static constexpr int capacity = 1 << 19;   // frames
+    static constexpr int chunkSize = 4096;
+    static constexpr int numChannels = 2;
+
+    void run() override;
+    bool fillStep(juce::AudioFormatReader& reader, const DownmixMatrix& matrix);
+    void readIntoRing(juce::AudioFormatReader& reader, const DownmixMatrix& matrix, juce::int64 start, int numFrames);
+    float sampleAt(int channel, juce::int64 frame) const;
+
+    juce::AudioBuffer<float> ring;      // frame f lives at f % capacity
+    juce::AudioBuffer<float> chunk;     // fill thread scratch
+    juce::AudioBuffer<float> sourceChunk; // fill thread scratch, all of a multichannel source's channels
+
+    std::atomic<juce::int64> validStart{ 0 }, validEnd{ 0 };
+    std::atomic<juce::int64> playhead{ 0 };
+    std::atomic<bool> active{ false };
+    std::atomic<double> sourceSampleRate{ 0.0 };
+    std::atomic<juce::int64> sourceLength{ 0 };
+
+    juce::CriticalSection sourceLock;
+    HotCueBank::ReaderFactory factory;
+    DownmixMatrix downmix;
+    int sourceVersion = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScrubBuffer)
+};
@@ -0,0 +1,180 @@
+#include "SessionJournal.h"
+#include "AppLog.h"
+
+JUCE_IMPLEMENT_SINGLETON(SessionJournal)
+
+SessionJournal::SessionJournal()
+    : juce::Thread("Session journal")
+{
+    getCheckpointFile({}).getParentDirectory().createDirectory();
+    startThread(juce::Thread::Priority::low);
+}
+
+SessionJournal::~SessionJournal()
+{
+    // run() writes what is still queued and checkpoints every deck on the way out
+    stopThread(10000);
+    clearSingletonInstance();
+}
+
+juce::File SessionJournal::getCheckpointFile(const juce::String& deckId)
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("SimpleAudioPlayer")
+        .getChildFile("Sessions")
+        .getChildFile(deckId + ".json");
+}
+
+juce::File SessionJournal::getJournalFile(const juce::String& deckId)
+{
+    return getCheckpointFile(deckId).withFileExtension("journal");
+}
+
+void SessionJournal::apply(juce::NamedValueSet& state, const juce::var& json)
+{
+    if (auto* object = json.getDynamicObject())
+        for (auto& property : object->getProperties())
+            state.set(property.name, property.value);
+}
+
+juce::NamedValueSet SessionJournal::load(const juce::String& deckId)
+{
+    juce::NamedValueSet state;
+    apply(state, juce::JSON::parse(getCheckpointFile(deckId)));
+
+    // a line torn by a crash doesn't parse and is skipped
+    juce::StringArray lines;
+    lines.addLines(getJournalFile(deckId).loadFileAsString());
+    lines.removeEmptyStrings();
+
+    for (auto& line : lines)
+        apply(state, juce::JSON::parse(line));
+
+    const juce::ScopedLock sl(decksLock);
+    auto& deck = decks[deckId];
+    deck.state = state;
+    deck.entriesSinceCheckpoint = lines.size();
+
+    return state;
+}
+
+void SessionJournal::set(const juce::String& deckId, const juce::Identifier& key, const juce::var& value)
+{
+    {
+        const juce::ScopedLock sl(pendingLock);
+        pending.push_back({ deckId, key, value });
+    }
+
+    notify();
+}
+
+void SessionJournal::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+        writeChanges();
+    }
+
+    writeChanges();
+
+    const juce::ScopedLock sl(decksLock);
+    for (auto& [deckId, deck] : decks)
+        if (deck.entriesSinceCheckpoint > 0)
+            checkpoint(deckId, deck);
+}
+
+void SessionJournal::writeChanges()
+{
+    std::vector<Change> changes;
+    {
+        const juce::ScopedLock sl(pendingLock);
+        changes.swap(pending);
+    }
+
+    if (changes.empty())
+        return;
+
+    const juce::ScopedLock sl(decksLock);
+
+    for (auto& change : changes)
+    {
+        auto& deck = decks[change.deckId];
+        deck.state.set(change.key, change.value);
+
+        // FileOutputStream appends to an existing file
+        if (deck.journal == nullptr)
+        {
+            deck.journal = std::make_unique<juce::FileOutputStream>(getJournalFile(change.deckId));
+            if (!deck.journal->openedOk())
+                deck.journal = nullptr;
+        }
+
+        if (deck.journal != nullptr)
+        {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty(change.key, change.value);
+            *deck.journal << juce::JSON::toString(juce::var(entry), true) << "\n";
+            deck.needsFlush = true;
+        }
+
+        ++deck.entriesSinceCheckpoint;
+    }
+
+    for (auto& [deckId, deck] : decks)
+    {
+        if (deck.needsFlush)
+        {
+            deck.journal->flush();
+            deck.needsFlush = false;
+        }
+
+        if (deck.entriesSinceCheckpoint >= checkpointInterval)
+            checkpoint(deckId, deck);
+    }
+}
+
+void SessionJournal::checkpoint(const juce::String& deckId, Deck& deck)
+{
+    auto* object = new juce::DynamicObject();
+    for (auto& value : deck.state)
+        object->setProperty(value.name, value.value);
+
+    // written beside the old one and swapped in, so there is always a whole checkpoint
+    juce::TemporaryFile temp(getCheckpointFile(deckId));
+
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (out.openedOk())
+        {
+            out << juce::JSON::toString(juce::var(object));
+            out.flush();
+        }
+
+        if (!out.openedOk() || out.getStatus().failed())
+        {
+            APP_LOG(session, warning, "Couldn't write the {} checkpoint: {}", deckId, out.getStatus().getErrorMessage());
+            return;
+        }
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary())
+    {
+        APP_LOG(session, warning, "Couldn't replace the {} checkpoint", deckId);
+        return;
+    }
+
+    // everything in the journal is in the checkpoint now (replaying it again would be
+    // harmless, so a crash before this point loses nothing)
+    if (deck.journal != nullptr)
+    {
+        deck.journal->setPosition(0);
+        deck.journal->truncate();
+    }
+    else
+    {
+        getJournalFile(deckId).deleteFile();
+    }
+
+    deck.entriesSinceCheckpoint = 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <JuceHeader.h>
+#include <map>
+
+// Remembers each deck's state (file, position, loops, cues, gain, speed) across runs,
+// including runs that end in a crash. Changes are appended to a per-deck journal by a
+// background thread, one JSON object per line, so a torn last line is the most a crash
+// can cost. Every so often the whole state is checkpointed to a file that is swapped in
+// atomically, and the journal starts again. Loading reads the checkpoint and replays the
+// journal over it.
+class SessionJournal : public juce::DeletedAtShutdown,
+                       private juce::Thread
+{
+public:
+    SessionJournal();
+    ~SessionJournal() override;
+
+    // message thread, once per deck before its first set(); deckId becomes a file name
+    juce::NamedValueSet load(const juce::String& deckId);
+
+    // any thread but the audio thread; queues the change and never touches the disk
+    void set(const juce::String& deckId, const juce::Identifier& key, const juce::var& value);
+
+    JUCE_DECLARE_SINGLETON(SessionJournal, false)
+
+private:
+    struct Change
+    {
+        juce::String deckId;
+        juce::Identifier key;
+        juce::var value;
+    };
+
+    struct Deck
+    {
+        juce::NamedValueSet state; // everything up to the end of the journal
+        std::unique_ptr<juce::FileOutputStream> journal;
+        int entriesSinceCheckpoint = 0;
+        bool needsFlush = false;
+    };
+
+    static constexpr int checkpointInterval = 256; // journal entries
+
+    void run() override;
+    void writeChanges();
+    void checkpoint(const juce::String& deckId, Deck& deck);
+
+    static juce::File getCheckpointFile(const juce::String& deckId);
+    static juce::File getJournalFile(const juce::String& deckId);
+    static void apply(juce::NamedValueSet& state, const juce::var& json);
+
+    juce::CriticalSection pendingLock;
+    std::vector<Change> pending;
+
+    juce::CriticalSection decksLock;
+    std::map<juce::String, Deck> decks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SessionJournal)
+};